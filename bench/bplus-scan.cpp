@@ -0,0 +1,169 @@
+/*
+ * Scans and lookups in bplus_tree, whose leaves are linked, against tree234, btree and std::map.
+ *
+ * Build: make bench (or g++ -std=c++2a -O2 -DNDEBUG -pthread -Iinclude -o bplus-scan bench/bplus-scan.cpp)
+ * Usage: bplus-scan [tree size] [scan length]
+ *
+ * Inserts random 64-bit keys, with 64-bit values, into each container, then times a full in-order iteration (ns per key), 100,000 range scans
+ * of [scan length] keys (default 100) from random keys (ns per key scanned) and as many random finds of present keys (ns per find). Each scan
+ * covers [first, last), last being the key scan length places after first. btree has no way to start an iteration at a key, so it is not
+ * scanned. The btree and the bplus_tree both have nodes of four cache lines.
+ */
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "bplus-tree.h"
+#include "btree.h"
+#include "tree234.h"
+
+using namespace std;
+
+volatile uint64_t sink;
+
+using btree_type = btree<uint64_t, uint64_t, btree_order<uint64_t, uint64_t>(4)>;
+using bplus_type = bplus_tree<uint64_t, uint64_t, 16, 14>;
+
+template<typename F> double ns_per(F f, uint64_t count)
+{
+   auto start = chrono::steady_clock::now();
+   f();
+   auto stop = chrono::steady_clock::now();
+
+   return chrono::duration<double, nano>(stop - start).count() / count;
+}
+
+// Each container's range scan: the sum of the values of the keys in [first, last).
+uint64_t scan(const tree234<uint64_t, uint64_t>& tree, uint64_t first, uint64_t last)
+{
+   uint64_t sum = 0;
+
+   tree.rangeTraverse(first, last, [&](const auto& pair) { sum += pair.second; });
+
+   return sum;
+}
+
+uint64_t scan(const bplus_type& tree, uint64_t first, uint64_t last)
+{
+   uint64_t sum = 0;
+
+   tree.rangeTraverse(first, last, [&](const auto&, const auto& value) { sum += value; });
+
+   return sum;
+}
+
+uint64_t scan(const map<uint64_t, uint64_t>& m, uint64_t first, uint64_t last)
+{
+   uint64_t sum = 0;
+
+   for (auto iter = m.lower_bound(first); iter != m.end() && iter->first < last; ++iter) sum += iter->second;
+
+   return sum;
+}
+
+template<typename Tree> bool contains(const Tree& tree, uint64_t key) { return tree.find(key); }
+
+bool contains(const map<uint64_t, uint64_t>& m, uint64_t key) { return m.find(key) != m.end(); }
+
+template<typename Tree> void insert(Tree& tree, uint64_t key) { tree.insert(key, key); }
+
+void insert(map<uint64_t, uint64_t>& m, uint64_t key) { m.emplace(key, key); }
+
+template<typename Container> void run(const string& name, const vector<uint64_t>& keys, const vector<pair<uint64_t, uint64_t>>& ranges, uint64_t length)
+{
+   Container c;
+
+   for (auto key : keys) insert(c, key);
+
+   auto iterate = ns_per([&] {
+      uint64_t sum = 0;
+      for (const auto& pair : c) sum += pair.second;
+      sink = sum;
+   }, keys.size());
+
+   cout << setw(12) << left << name << right << fixed << setprecision(1) << setw(12) << iterate;
+
+   if constexpr (is_same_v<Container, btree_type>) {
+
+       cout << setw(12) << "-";
+
+   } else {
+
+       cout << setw(12) << ns_per([&] {
+          uint64_t sum = 0;
+          for (auto [first, last] : ranges) sum += scan(c, first, last);
+          sink = sum;
+       }, ranges.size() * length);
+   }
+
+   auto find = ns_per([&] {
+      uint64_t found = 0;
+      for (auto [first, last] : ranges) found += contains(c, first);
+      sink = found;
+   }, ranges.size());
+
+   cout << setw(12) << find << '\n';
+}
+
+// A positive count from the command line, or 0 if arg is not one.
+size_t count_arg(const char *arg)
+{
+   char *end;
+
+   auto count = strtoull(arg, &end, 10);
+
+   return isdigit(static_cast<unsigned char>(arg[0])) && *end == '\0' ? count : 0;
+}
+
+int main(int argc, char** argv)
+{
+   size_t size = argc > 1 ? count_arg(argv[1]) : 10'000'000;
+   uint64_t length = argc > 2 ? count_arg(argv[2]) : 100;
+
+   // A scan covers [first, last) between two keys, so it needs two.
+   if (argc > 3 || size < 2 || length == 0) {
+       cerr << "usage: " << argv[0] << " [tree size, at least 2] [scan length]\n";
+       return 1;
+   }
+
+   mt19937_64 rng{12345};
+
+   vector<uint64_t> keys(size);
+
+   for (auto& key : keys) key = rng();
+
+   vector<uint64_t> sorted{keys};
+
+   sort(sorted.begin(), sorted.end());
+
+   if (length >= size) length = size - 1;
+
+   vector<pair<uint64_t, uint64_t>> ranges(100'000);
+
+   for (auto& range : ranges) {
+
+       auto i = rng() % (size - length);
+
+       range = {sorted[i], sorted[i + length]};
+   }
+
+   cout << size << " keys, scans of " << length << " keys; bplus_tree internal nodes " << bplus_type::internal_node_bytes() << " bytes, leaves "
+        << bplus_type::leaf_node_bytes() << " bytes\n\n"
+        << setw(12) << left << "container" << right << setw(12) << "iterate" << setw(12) << "scan" << setw(12) << "find" << '\n';
+
+   run<tree234<uint64_t, uint64_t>>("tree234", keys, ranges, length);
+   run<btree_type>("btree", keys, ranges, length);
+   run<bplus_type>("bplus_tree", keys, ranges, length);
+   run<map<uint64_t, uint64_t>>("std::map", keys, ranges, length);
+
+   return 0;
+}
@@ -0,0 +1,143 @@
+/*
+ * Lookup depth and speed of btree for node sizes from a 2-3-4 node to several cache lines, against tree234 and std::map.
+ *
+ * Build: make bench (or g++ -std=c++2a -O2 -DNDEBUG -pthread -Iinclude -o btree-order bench/btree-order.cpp)
+ * Usage: btree-order [tree size] [lookups]
+ *
+ * Inserts shuffled 64-bit keys, with 64-bit values, into each container, then times random finds of present keys, a full in-order iteration
+ * and the removal of every key, in nanoseconds per operation (per key for iteration). btree<..., btree_order(n)> has the largest order whose
+ * nodes fit in n cache lines.
+ */
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include "btree.h"
+#include "tree234.h"
+
+using namespace std;
+
+volatile uint64_t sink;
+
+template<typename F> double ns_per(F f, uint64_t count)
+{
+   auto start = chrono::steady_clock::now();
+   f();
+   auto stop = chrono::steady_clock::now();
+
+   return chrono::duration<double, nano>(stop - start).count() / count;
+}
+
+struct row {
+   string name;
+   int order;
+   size_t node_bytes;
+   int height;
+   double insert, find, iterate, remove;
+};
+
+template<typename Tree> int tree_height(const Tree& tree) { return tree.height(); }
+
+template<typename K, typename V> int tree_height(const map<K, V>&) { return 0; }
+
+template<typename Tree> bool contains(const Tree& tree, uint64_t key) { return tree.find(key); }
+
+template<typename K, typename V> bool contains(const map<K, V>& m, uint64_t key) { return m.find(key) != m.end(); }
+
+template<typename Tree> void insert(Tree& tree, uint64_t key) { tree.insert(key, key); }
+
+template<typename K, typename V> void insert(map<K, V>& m, uint64_t key) { m.emplace(key, key); }
+
+template<typename Tree> void remove(Tree& tree, uint64_t key) { tree.remove(key); }
+
+template<typename K, typename V> void remove(map<K, V>& m, uint64_t key) { m.erase(key); }
+
+template<typename Container> row run(const string& name, int order, size_t node_bytes, const vector<uint64_t>& keys, const vector<uint64_t>& lookups)
+{
+   row r{name, order, node_bytes, 0, 0, 0, 0, 0};
+
+   Container c;
+
+   r.insert = ns_per([&] { for (auto key : keys) insert(c, key); }, keys.size());
+
+   r.height = tree_height(c);
+
+   r.find = ns_per([&] {
+      uint64_t found = 0;
+      for (auto key : lookups) found += contains(c, key);
+      sink = found;
+   }, lookups.size());
+
+   r.iterate = ns_per([&] {
+      uint64_t sum = 0;
+      for (const auto& pair : c) sum += pair.second;
+      sink = sum;
+   }, keys.size());
+
+   r.remove = ns_per([&] { for (auto key : keys) remove(c, key); }, keys.size());
+
+   return r;
+}
+
+// A positive count from the command line, or 0 if arg is not one.
+size_t count_arg(const char *arg)
+{
+   char *end;
+
+   auto count = strtoull(arg, &end, 10);
+
+   return isdigit(static_cast<unsigned char>(arg[0])) && *end == '\0' ? count : 0;
+}
+
+int main(int argc, char** argv)
+{
+   size_t size = argc > 1 ? count_arg(argv[1]) : 10'000'000;
+   size_t lookup_count = argc > 2 ? count_arg(argv[2]) : 10'000'000;
+
+   if (argc > 3 || size == 0 || lookup_count == 0) {
+       cerr << "usage: " << argv[0] << " [tree size] [lookups]\n";
+       return 1;
+   }
+
+   mt19937_64 rng{12345};
+
+   vector<uint64_t> keys(size);
+
+   for (size_t i = 0; i < size; ++i) keys[i] = rng();
+
+   vector<uint64_t> lookups(lookup_count);
+
+   for (auto& key : lookups) key = keys[rng() % size];
+
+   constexpr int order_2 = btree_order<uint64_t, uint64_t>(2);
+   constexpr int order_4 = btree_order<uint64_t, uint64_t>(4);
+   constexpr int order_8 = btree_order<uint64_t, uint64_t>(8);
+   constexpr int order_16 = btree_order<uint64_t, uint64_t>(16);
+
+   vector<row> rows;
+
+   rows.push_back(run<tree234<uint64_t, uint64_t>>("tree234", 4, sizeof(tree234<uint64_t, uint64_t>::node_type), keys, lookups));
+   rows.push_back(run<btree<uint64_t, uint64_t, 4>>("btree", 4, btree<uint64_t, uint64_t, 4>::node_bytes(), keys, lookups));
+   rows.push_back(run<btree<uint64_t, uint64_t, order_2>>("btree 2 lines", order_2, btree<uint64_t, uint64_t, order_2>::node_bytes(), keys, lookups));
+   rows.push_back(run<btree<uint64_t, uint64_t, order_4>>("btree 4 lines", order_4, btree<uint64_t, uint64_t, order_4>::node_bytes(), keys, lookups));
+   rows.push_back(run<btree<uint64_t, uint64_t, order_8>>("btree 8 lines", order_8, btree<uint64_t, uint64_t, order_8>::node_bytes(), keys, lookups));
+   rows.push_back(run<btree<uint64_t, uint64_t, order_16>>("btree 16 lines", order_16, btree<uint64_t, uint64_t, order_16>::node_bytes(), keys, lookups));
+   rows.push_back(run<map<uint64_t, uint64_t>>("std::map", 2, 0, keys, lookups));
+
+   cout << size << " keys, " << lookup_count << " lookups; ns per operation\n\n"
+        << setw(16) << left << "container" << right << setw(7) << "order" << setw(12) << "node bytes" << setw(8) << "height" << setw(10) << "insert"
+        << setw(10) << "find" << setw(10) << "iterate" << setw(10) << "remove" << '\n';
+
+   for (auto& r : rows)
+       cout << setw(16) << left << r.name << right << setw(7) << r.order << setw(12) << r.node_bytes << setw(8) << r.height << fixed << setprecision(1)
+            << setw(10) << r.insert << setw(10) << r.find << setw(10) << r.iterate << setw(10) << r.remove << '\n';
+
+   return 0;
+}
@@ -0,0 +1,99 @@
+/*
+ * tree234::find_batch() against a loop of find() over the same keys.
+ *
+ * Build: make bench (or g++ -std=c++2a -O2 -DNDEBUG -pthread -Iinclude -o find-batch bench/find-batch.cpp)
+ * Usage: find-batch [tree size] [lookups] [batch size]
+ *
+ * Inserts random 64-bit keys, with 64-bit values, into a tree234 and looks up [lookups] keys, half of them present, in batches of [batch size]
+ * keys (default 1,000): once with find() on each key, once with find_batch() on each batch. Reports nanoseconds per key for tree sizes up to
+ * [tree size], growing by factors of 10 from 10,000, so the gain can be seen as the tree outgrows the caches.
+ */
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <span>
+#include <vector>
+#include "tree234.h"
+
+using namespace std;
+
+volatile uint64_t sink;
+
+template<typename F> double ns_per(F f, uint64_t count)
+{
+   auto start = chrono::steady_clock::now();
+   f();
+   auto stop = chrono::steady_clock::now();
+
+   return chrono::duration<double, nano>(stop - start).count() / count;
+}
+
+// A positive count from the command line, or 0 if arg is not one.
+size_t count_arg(const char *arg)
+{
+   char *end;
+
+   auto count = strtoull(arg, &end, 10);
+
+   return isdigit(static_cast<unsigned char>(arg[0])) && *end == '\0' ? count : 0;
+}
+
+int main(int argc, char** argv)
+{
+   size_t max_size = argc > 1 ? count_arg(argv[1]) : 10'000'000;
+   size_t lookup_count = argc > 2 ? count_arg(argv[2]) : 10'000'000;
+   size_t batch_size = argc > 3 ? count_arg(argv[3]) : 1'000;
+
+   if (argc > 4 || max_size == 0 || lookup_count == 0 || batch_size == 0) {
+       cerr << "usage: " << argv[0] << " [tree size] [lookups] [batch size]\n";
+       return 1;
+   }
+
+   cout << lookup_count << " lookups, half of present keys, in batches of " << batch_size << "; find_batch_width "
+        << tree234<uint64_t, uint64_t>::find_batch_width << "; ns per key\n\n"
+        << setw(12) << "tree size" << setw(8) << "height" << setw(12) << "find" << setw(12) << "find_batch" << setw(10) << "speedup" << '\n';
+
+   for (size_t size = 10'000; size <= max_size; size *= 10) {
+
+       mt19937_64 rng{12345};
+
+       vector<uint64_t> keys(size);
+
+       for (auto& key : keys) key = rng();
+
+       tree234<uint64_t, uint64_t> tree;
+
+       for (auto key : keys) tree.insert(key, key);
+
+       vector<uint64_t> lookups(lookup_count);
+
+       for (auto& key : lookups) key = rng() % 2 ? keys[rng() % size] : rng();
+
+       auto loop = ns_per([&] {
+          uint64_t found = 0;
+          for (auto key : lookups) found += tree.find(key);
+          sink = found;
+       }, lookup_count);
+
+       vector<const uint64_t *> results(batch_size);
+
+       auto batch = ns_per([&] {
+          uint64_t found = 0;
+          for (size_t first = 0; first < lookup_count; first += batch_size) {
+              auto batch_keys = span<const uint64_t>(lookups).subspan(first, min(batch_size, lookup_count - first));
+              found += tree.find_batch(batch_keys, results);
+          }
+          sink = found;
+       }, lookup_count);
+
+       cout << setw(12) << size << setw(8) << tree.height() << fixed << setprecision(1) << setw(12) << loop << setw(12) << batch
+            << setprecision(2) << setw(10) << loop / batch << '\n';
+   }
+
+   return 0;
+}
@@ -0,0 +1,159 @@
+/*
+ * Lookups in a frozen_tree234, with and without prefetching and with 3-key blocks, against the tree234 it was frozen from and a binary search
+ * of a sorted array.
+ *
+ * Build: make bench (or g++ -std=c++2a -O2 -DNDEBUG -pthread -Iinclude -o frozen-lookup bench/frozen-lookup.cpp)
+ * Usage: frozen-lookup [tree size] [lookups]
+ *
+ * Inserts random 64-bit keys, with 64-bit values, into a tree234 and freezes it, timing freeze() and thaw() in nanoseconds per key. Then times
+ * random finds of present keys, lower_bound() of random keys and a full in-order iteration in each container, in nanoseconds per operation
+ * (per key for iteration). tree234 has no lower_bound(), so it is not probed.
+ */
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "frozen-tree234.h"
+#include "tree234.h"
+
+using namespace std;
+
+volatile uint64_t sink;
+
+template<typename F> double ns_per(F f, uint64_t count)
+{
+   auto start = chrono::steady_clock::now();
+   f();
+   auto stop = chrono::steady_clock::now();
+
+   return chrono::duration<double, nano>(stop - start).count() / count;
+}
+
+// Each container's find and lower_bound; lower_bound() returns the key found, or ~0 if there is none.
+bool contains(const tree234<uint64_t, uint64_t>& tree, uint64_t key) { return tree.find(key); }
+
+template<bool Prefetch, size_t BlockKeys> bool contains(const frozen_tree234<uint64_t, uint64_t, Prefetch, BlockKeys>& tree, uint64_t key) { return tree.find(key); }
+
+bool contains(const vector<uint64_t>& v, uint64_t key) { return binary_search(v.begin(), v.end(), key); }
+
+template<bool Prefetch, size_t BlockKeys> uint64_t lower_bound(const frozen_tree234<uint64_t, uint64_t, Prefetch, BlockKeys>& tree, uint64_t key)
+{
+   auto iter = tree.lower_bound(key);
+
+   return iter == tree.end() ? ~uint64_t{0} : iter.key();
+}
+
+uint64_t lower_bound(const vector<uint64_t>& v, uint64_t key)
+{
+   auto iter = std::lower_bound(v.begin(), v.end(), key);
+
+   return iter == v.end() ? ~uint64_t{0} : *iter;
+}
+
+template<typename Container> void run(const string& name, const Container& c, const vector<uint64_t>& lookups, const vector<uint64_t>& probes, size_t size)
+{
+   auto find = ns_per([&] {
+      uint64_t found = 0;
+      for (auto key : lookups) found += contains(c, key);
+      sink = found;
+   }, lookups.size());
+
+   auto iterate = ns_per([&] {
+      uint64_t sum = 0;
+      if constexpr (is_same_v<Container, vector<uint64_t>>)
+          for (auto key : c) sum += key;
+      else
+          for (const auto& pair : c) sum += pair.second;
+      sink = sum;
+   }, size);
+
+   cout << setw(24) << left << name << right << fixed << setprecision(1) << setw(12) << find;
+
+   if constexpr (is_same_v<Container, tree234<uint64_t, uint64_t>>) {
+
+       cout << setw(14) << "-";
+
+   } else {
+
+       cout << setw(14) << ns_per([&] {
+          uint64_t sum = 0;
+          for (auto key : probes) sum += lower_bound(c, key);
+          sink = sum;
+       }, probes.size());
+   }
+
+   cout << setw(12) << iterate << '\n';
+}
+
+// A positive count from the command line, or 0 if arg is not one.
+size_t count_arg(const char *arg)
+{
+   char *end;
+
+   auto count = strtoull(arg, &end, 10);
+
+   return isdigit(static_cast<unsigned char>(arg[0])) && *end == '\0' ? count : 0;
+}
+
+int main(int argc, char** argv)
+{
+   size_t size = argc > 1 ? count_arg(argv[1]) : 10'000'000;
+   size_t lookup_count = argc > 2 ? count_arg(argv[2]) : 10'000'000;
+
+   if (argc > 3 || size == 0 || lookup_count == 0) {
+       cerr << "usage: " << argv[0] << " [tree size] [lookups]\n";
+       return 1;
+   }
+
+   mt19937_64 rng{12345};
+
+   vector<uint64_t> keys(size);
+
+   for (auto& key : keys) key = rng();
+
+   vector<uint64_t> lookups(lookup_count);
+
+   for (auto& key : lookups) key = keys[rng() % size];
+
+   // lower_bound() is probed with random keys, which are almost never present.
+   vector<uint64_t> probes(lookup_count);
+
+   for (auto& key : probes) key = rng();
+
+   tree234<uint64_t, uint64_t> tree;
+
+   for (auto key : keys) tree.insert(key, key);
+
+   frozen_tree234<uint64_t, uint64_t> frozen;
+
+   auto freeze_time = ns_per([&] { frozen = freeze(tree); }, tree.size());
+
+   auto unprefetched = freeze<false>(tree);
+   auto small_blocks = freeze<true, 3>(tree);
+
+   auto thaw_time = ns_per([&] { sink = frozen.thaw().size(); }, frozen.size());
+
+   vector<uint64_t> sorted(frozen.size());
+
+   transform(frozen.begin(), frozen.end(), sorted.begin(), [](const auto& pair) { return pair.first; });
+
+   cout << frozen.size() << " keys, " << lookup_count << " lookups; tree234 height " << tree.height()
+        << ", frozen height " << frozen.height() << " (" << frozen.block_keys << "-key blocks), " << small_blocks.height() << " (3-key blocks)"
+        << "\nfreeze " << fixed << setprecision(1) << freeze_time << " ns per key, thaw " << thaw_time
+        << " ns per key\n\n" << setw(24) << left << "container" << right << setw(12) << "find" << setw(14) << "lower_bound" << setw(12) << "iterate" << '\n';
+
+   run("tree234", tree, lookups, probes, frozen.size());
+   run("frozen", frozen, lookups, probes, frozen.size());
+   run("frozen, no prefetch", unprefetched, lookups, probes, frozen.size());
+   run("frozen, 3-key blocks", small_blocks, lookups, probes, frozen.size());
+   run("sorted array", sorted, lookups, probes, frozen.size());
+
+   return 0;
+}
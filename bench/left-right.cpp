@@ -0,0 +1,181 @@
+/*
+ * Read latency of left_right_tree234 against a tree234 guarded by std::shared_mutex, under a read-dominated mix (99.9% find by default).
+ *
+ * Build: g++ -std=c++2a -O2 -DNDEBUG -pthread -Iinclude -o left-right bench/left-right.cpp
+ * Usage: left-right [tree size] [reader threads] [ops per reader] [writes per 1000 ops]
+ *
+ * Reader threads time every find() with steady_clock. One writer thread inserts and removes keys at the requested rate relative to the reads.
+ * The report gives throughput and the p50, p99, p99.9 and maximum find latency for each wrapper.
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "left-right-tree234.h"
+
+using namespace std;
+
+template<typename Key, typename Value> class shared_mutex_tree234 {
+
+      tree234<Key, Value> tree;
+      mutable shared_mutex mutex;
+
+   public:
+
+      explicit shared_mutex_tree234(const tree234<Key, Value>& lhs) : tree{lhs} {}
+
+      bool find(const Key& key) const
+      {
+         shared_lock<shared_mutex> lock{mutex};
+         return tree.find(key);
+      }
+
+      void insert(const Key& key, const Value& value)
+      {
+         unique_lock<shared_mutex> lock{mutex};
+         tree.insert(key, value);
+      }
+
+      bool remove(const Key& key)
+      {
+         unique_lock<shared_mutex> lock{mutex};
+         return tree.remove(key);
+      }
+};
+
+struct result {
+   double seconds;
+   long reads;
+   vector<long> latencies_ns; // sorted
+};
+
+template<typename Wrapper> result run(Wrapper& wrapper, long size, unsigned readers, long ops, int writes_per_1000)
+{
+   atomic<bool> stop{false};
+   atomic<long> reads_done{0};
+
+   vector<vector<long>> latencies(readers);
+
+   auto start = chrono::steady_clock::now();
+
+   thread writer([&] {
+      mt19937_64 rng{99};
+      long key = size;
+
+      // Pace the writer by the readers' progress so that writes are the requested fraction of all operations.
+      long writes = 0;
+
+      while (!stop.load()) {
+
+         if (writes * (1000 - writes_per_1000) >= reads_done.load() * writes_per_1000) {
+             this_thread::yield();
+             continue;
+         }
+
+         if (writes % 2 == 0) {
+             ++key;
+             wrapper.insert(key, key);
+
+         } else 
+             wrapper.remove(static_cast<long>(rng() % size));
+
+         ++writes;
+      }
+   });
+
+   vector<thread> threads;
+
+   for (unsigned t = 0; t < readers; ++t) {
+
+      threads.emplace_back([&, t] {
+         mt19937_64 rng{t + 1};
+         auto& lat = latencies[t];
+         lat.reserve(ops);
+
+         for (long i = 0; i < ops; ++i) {
+
+            long key = static_cast<long>(rng() % size);
+
+            auto s = chrono::steady_clock::now();
+            volatile bool found = wrapper.find(key);
+            auto e = chrono::steady_clock::now();
+            (void) found;
+
+            lat.push_back(chrono::duration_cast<chrono::nanoseconds>(e - s).count());
+
+            if ((i & 255) == 255) reads_done += 256;
+         }
+      });
+   }
+
+   for (auto& thread : threads) thread.join();
+
+   auto stop_time = chrono::steady_clock::now();
+
+   stop = true;
+   writer.join();
+
+   result r{chrono::duration<double>(stop_time - start).count(), static_cast<long>(readers) * ops, {}};
+
+   for (auto& lat : latencies) r.latencies_ns.insert(r.latencies_ns.end(), lat.begin(), lat.end());
+
+   sort(r.latencies_ns.begin(), r.latencies_ns.end());
+   return r;
+}
+
+long percentile(const vector<long>& sorted, double p)
+{
+   if (sorted.empty()) return 0;
+
+   auto index = static_cast<size_t>(p / 100.0 * (sorted.size() - 1));
+   return sorted[index];
+}
+
+void report(const string& name, const result& r)
+{
+   cout << setw(22) << left << name << right
+        << setw(12) << fixed << setprecision(2) << r.reads / r.seconds / 1e6
+        << setw(10) << percentile(r.latencies_ns, 50)
+        << setw(10) << percentile(r.latencies_ns, 99)
+        << setw(10) << percentile(r.latencies_ns, 99.9)
+        << setw(12) << r.latencies_ns.back() << '\n';
+}
+
+int main(int argc, char** argv)
+{
+   long size = argc > 1 ? atol(argv[1]) : 1'000'000;
+   unsigned readers = argc > 2 ? atoi(argv[2]) : max(1u, thread::hardware_concurrency() - 1);
+   long ops = argc > 3 ? atol(argv[3]) : 1'000'000;
+   int writes_per_1000 = argc > 4 ? atoi(argv[4]) : 1;
+
+   vector<pair<long, long>> pairs;
+
+   for (long i = 0; i < size; ++i) pairs.emplace_back(i, i);
+
+   tree234<long, long> tree;
+   tree.insert_batch(pairs);
+
+   cout << "tree size " << size << ", " << readers << " reader threads, " << ops << " finds each, " << writes_per_1000 << " writes per 1000 ops\n\n";
+
+   cout << setw(22) << left << "wrapper" << right << setw(12) << "Mfinds/s" << setw(10) << "p50 ns" << setw(10) << "p99 ns" << setw(10) << "p99.9 ns" << setw(12) << "max ns" << '\n';
+
+   {
+      shared_mutex_tree234<long, long> wrapper{tree};
+      report("std::shared_mutex", run(wrapper, size, readers, ops, writes_per_1000));
+   }
+   {
+      left_right_tree234<long, long> wrapper{tree};
+      report("left_right_tree234", run(wrapper, size, readers, ops, writes_per_1000));
+   }
+
+   return 0;
+}
@@ -0,0 +1,90 @@
+/*
+ * Buffer pool behaviour of paged_tree234 as the tree outgrows the pool.
+ *
+ * Build: g++ -std=c++2a -O2 -DNDEBUG -Iinclude -o paged-tree bench/paged-tree.cpp
+ * Usage: paged-tree [tree size] [ops per run] [file]
+ *
+ * Builds a tree of 4 KB pages in file, then for pools holding from all of the tree's pages down to 1% of them runs a mix of 90% find and 10%
+ * insert on uniformly random keys. The report gives throughput, buffer pool faults (pins that had to read a page from the file) and dirty
+ * page write-backs per operation. The file is read through the OS page cache, so the fault cost measured is that of a pread() and copy.
+ */
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include "paged-tree234.h"
+
+using namespace std;
+
+using tree_type = paged_tree234<uint64_t, uint64_t, 4096>;
+
+int main(int argc, char** argv)
+{
+   long size = argc > 1 ? atol(argv[1]) : 2'000'000;
+   long ops = argc > 2 ? atol(argv[2]) : 1'000'000;
+   string path = argc > 3 ? argv[3] : "paged-tree.db";
+
+   std::remove(path.c_str());
+
+   uint64_t pages;
+   int height;
+   {
+      tree_type tree{path, static_cast<size_t>(size / 64)};
+
+      mt19937_64 rng{1};
+
+      for (long i = 0; i < size; ++i) tree.insert(rng() % (4 * size), i);
+
+      tree.get_store().flush();
+
+      pages = tree.get_store().page_count();
+      height = tree.height();
+
+      cout << "tree size " << tree.size() << ", height " << height << ", " << pages << " pages of 4 KB, " << tree_type::max_keys << " keys per page\n\n";
+   }
+
+   cout << setw(10) << "pool %" << setw(10) << "frames" << setw(12) << "Kops/s" << setw(14) << "faults/op" << setw(14) << "writes/op" << setw(12) << "hit rate" << '\n';
+
+   for (double percent : {100.0, 50.0, 25.0, 10.0, 5.0, 1.0}) {
+
+       auto frames = static_cast<size_t>(pages * percent / 100.0);
+
+       tree_type tree{path, frames};
+
+       // A new seed for each run, as the inserts of earlier runs are in the file.
+       mt19937_64 rng{static_cast<uint64_t>(frames) + 2};
+
+       // Warm the pool before measuring.
+       for (long i = 0; i < ops / 10; ++i) (void) tree.find(rng() % (4 * size));
+
+       tree.get_store().reset_statistics();
+
+       auto start = chrono::steady_clock::now();
+
+       for (long i = 0; i < ops; ++i) {
+
+           uint64_t key = rng() % (4 * size);
+
+           if (i % 10 == 0) tree.insert(key, i);
+           else (void) tree.find(key);
+       }
+
+       auto seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+       auto& stats = tree.get_store().get_statistics();
+
+       cout << setw(10) << fixed << setprecision(0) << percent << setw(10) << tree.get_store().frame_count()
+            << setw(12) << setprecision(1) << ops / seconds / 1e3
+            << setw(14) << setprecision(3) << double(stats.faults) / ops
+            << setw(14) << double(stats.writes) / ops
+            << setw(11) << setprecision(1) << 100.0 * stats.hits / (stats.hits + stats.faults) << "%\n";
+   }
+
+   std::remove(path.c_str());
+
+   return 0;
+}
@@ -0,0 +1,115 @@
+/*
+ * Scaling benchmark for tree234::parallel_for_each() and tree234::parallel_reduce().
+ *
+ * Build: g++ -std=c++2a -O2 -DNDEBUG -pthread -Iinclude -o parallel-traverse bench/parallel-traverse.cpp
+ * Usage: parallel-traverse [tree size] [max threads]
+ *
+ * Times a serial inOrderTraverse() sum, then the parallel reduction and for_each, with pools of 1, 2, 4, ... up to max threads, and reports the
+ * speedup over the one-thread pool.
+ */
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+#include "tree234.h"
+
+using namespace std;
+
+template<typename F> double time_ms(F f, int repeats = 3)
+{
+   double best = 1e300;
+
+   for (auto i = 0; i < repeats; ++i) {
+
+      auto start = chrono::steady_clock::now();
+      f();
+      auto stop = chrono::steady_clock::now();
+
+      best = min(best, chrono::duration<double, milli>(stop - start).count());
+   }
+   return best;
+}
+
+int main(int argc, char** argv)
+{
+  long size = argc > 1 ? atol(argv[1]) : 2'000'000;
+  unsigned max_threads = argc > 2 ? atoi(argv[2]) : thread::hardware_concurrency();
+
+  vector<int64_t> keys(size);
+
+  for (long i = 0; i < size; ++i) keys[i] = i;
+
+  shuffle(keys.begin(), keys.end(), mt19937_64{12345});
+
+  tree234<int64_t, int64_t> tree;
+
+  for (auto key : keys) tree.insert(key, key * 3);
+
+  cout << "tree size = " << tree.size() << ", height = " << tree.height() << "\n\n";
+
+  int64_t serial_sum = 0;
+
+  auto serial_ms = time_ms([&] {
+      serial_sum = 0;
+      tree.inOrderTraverse([&](const auto& pr) { serial_sum += pr.second; });
+  });
+
+  cout << "serial inOrderTraverse sum: " << fixed << setprecision(2) << serial_ms << " ms\n\n";
+
+  cout << setw(8) << "threads" << setw(14) << "reduce ms" << setw(10) << "speedup" << setw(16) << "for_each ms" << setw(10) << "speedup" << '\n';
+
+  double reduce_base = 0, for_each_base = 0;
+
+  for (unsigned threads = 1; threads <= max_threads; threads = (threads == max_threads) ? threads + 1 : min(threads * 2, max_threads)) {
+
+      work_stealing_pool pool{threads};
+
+      int64_t sum = 0;
+
+      auto reduce_ms = time_ms([&] {
+          sum = tree.parallel_reduce(int64_t{0}, [](int64_t acc, const auto& pr) { return acc + pr.second; }, std::plus<>{}, pool);
+      });
+
+      if (sum != serial_sum) {
+          cerr << "parallel_reduce returned " << sum << ", expected " << serial_sum << endl;
+          return 1;
+      }
+
+      atomic<int64_t> total{0};
+
+      auto for_each_ms = time_ms([&] {
+          total = 0;
+          tree.parallel_for_each([&](const auto& pr) {
+              thread_local int64_t local = 0;
+              local += pr.second;
+              if ((pr.first & 0xfff) == 0) { total += local; local = 0; }
+          }, pool);
+      });
+
+      if (threads == 1) {
+          reduce_base = reduce_ms;
+          for_each_base = for_each_ms;
+      }
+
+      cout << setw(8) << threads << setw(14) << reduce_ms << setw(10) << reduce_base / reduce_ms
+           << setw(16) << for_each_ms << setw(10) << for_each_base / for_each_ms << '\n';
+  }
+
+  // Ordered reduction: concatenating keys in order must reproduce the sorted sequence.
+  work_stealing_pool pool{max_threads};
+
+  auto ordered = tree.parallel_reduce(vector<int64_t>{},
+                                      [](vector<int64_t> v, const auto& pr) { v.push_back(pr.first); return v; },
+                                      [](vector<int64_t> lhs, vector<int64_t> rhs) { lhs.insert(lhs.end(), rhs.begin(), rhs.end()); return lhs; },
+                                      pool);
+
+  cout << "\nordered reduction preserves key order: " << (is_sorted(ordered.begin(), ordered.end()) && ordered.size() == static_cast<size_t>(size) ? "yes" : "NO") << endl;
+
+  return 0;
+}
@@ -0,0 +1,116 @@
+#ifndef perf_counters_h_7716204
+#define perf_counters_h_7716204
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+/*
+ * Hardware performance counters for the calling thread, read through Linux perf_event_open(2). Each event is opened on its own rather than as a
+ * group, so an event the processor (or a virtual machine) lacks is simply unavailable, and the kernel may multiplex events that do not fit
+ * on the PMU at once; stop() scales such counts by time enabled / time running. User-space events only, so perf_event_paranoid must be 2 or
+ * less.
+ */
+class perf_counters {
+
+   public:
+
+      enum event { cycles, instructions, l1d_misses, llc_misses, dtlb_misses, branch_misses, event_count };
+
+      static constexpr std::array<const char *, event_count> names{"cycles", "instructions", "l1d_misses", "llc_misses", "dtlb_misses", "branch_misses"};
+
+   private:
+
+      std::array<int, event_count> fds;
+
+      static constexpr std::uint64_t cache_event(std::uint64_t cache, std::uint64_t op, std::uint64_t result) noexcept
+      {
+         return cache | (op << 8) | (result << 16);
+      }
+
+      static int open(std::uint32_t type, std::uint64_t config) noexcept
+      {
+         perf_event_attr attr;
+
+         std::memset(&attr, 0, sizeof(attr));
+
+         attr.size = sizeof(attr);
+         attr.type = type;
+         attr.config = config;
+         attr.disabled = 1;
+         attr.exclude_kernel = 1;
+         attr.exclude_hv = 1;
+         attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+         return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+      }
+
+   public:
+
+      perf_counters() noexcept
+      {
+         fds[cycles] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+         fds[instructions] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+         fds[l1d_misses] = open(PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS));
+         fds[llc_misses] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+         fds[dtlb_misses] = open(PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS));
+         fds[branch_misses] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+      }
+
+      perf_counters(const perf_counters&) = delete;
+      perf_counters& operator=(const perf_counters&) = delete;
+
+     ~perf_counters()
+      {
+         for (int fd : fds) if (fd >= 0) ::close(fd);
+      }
+
+      bool available(event e) const noexcept { return fds[e] >= 0; }
+
+      bool any_available() const noexcept
+      {
+         for (int fd : fds) if (fd >= 0) return true;
+
+         return false;
+      }
+
+      void start() noexcept
+      {
+         for (int fd : fds) {
+
+             if (fd < 0) continue;
+
+             ::ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+             ::ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+         }
+      }
+
+      // The counts since start(). An unavailable event, or one that never got on the PMU, reads NaN.
+      std::array<double, event_count> stop() noexcept
+      {
+         std::array<double, event_count> counts;
+
+         for (int fd : fds) if (fd >= 0) ::ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+
+         for (int e = 0; e < event_count; ++e) {
+
+             struct { std::uint64_t value, enabled, running; } reading;
+
+             if (fds[e] < 0 || ::read(fds[e], &reading, sizeof(reading)) != sizeof(reading) || reading.running == 0) {
+
+                 counts[e] = NAN;
+                 continue;
+             }
+
+             counts[e] = double(reading.value) * (double(reading.enabled) / double(reading.running));
+         }
+
+         return counts;
+      }
+};
+#endif
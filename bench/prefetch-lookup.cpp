@@ -0,0 +1,139 @@
+/*
+ * The effect of tree234's Prefetch policy (see tree234-prefetch.h) on lookups, inserts and scans of a large tree.
+ *
+ * Build: make bench (or g++ -std=c++2a -O2 -DNDEBUG -pthread -Iinclude -o prefetch-lookup bench/prefetch-lookup.cpp)
+ * Usage: prefetch-lookup [tree size] [lookups]
+ *
+ * Builds a tree234<uint64_t, uint64_t, no_stats, Policy> of random keys for Policy no_prefetch and prefetch_nodes, timing the inserts, then
+ * times random finds of present keys, a full iteration with an iterator, an inOrderTraverse() and 100,000 rangeTraverse() scans of about 100
+ * keys. Times are in nanoseconds per operation (per key for the scans); the last column is the no_prefetch time over the prefetch_nodes time.
+ */
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "tree234.h"
+
+using namespace std;
+
+volatile uint64_t sink;
+
+template<typename F> double ns_per(F f, uint64_t count)
+{
+   auto start = chrono::steady_clock::now();
+   f();
+   auto stop = chrono::steady_clock::now();
+
+   return chrono::duration<double, nano>(stop - start).count() / count;
+}
+
+struct times {
+   double insert, find, iterate, traverse, scan;
+};
+
+template<typename Policy> times run(const vector<uint64_t>& keys, const vector<uint64_t>& lookups, const vector<pair<uint64_t, uint64_t>>& ranges)
+{
+   times t;
+
+   tree234<uint64_t, uint64_t, no_stats, Policy> tree;
+
+   t.insert = ns_per([&] { for (auto key : keys) tree.insert(key, key); }, keys.size());
+
+   t.find = ns_per([&] {
+      uint64_t found = 0;
+      for (auto key : lookups) found += tree.find(key);
+      sink = found;
+   }, lookups.size());
+
+   t.iterate = ns_per([&] {
+      uint64_t sum = 0;
+      for (const auto& pair : tree) sum += pair.second;
+      sink = sum;
+   }, tree.size());
+
+   t.traverse = ns_per([&] {
+      uint64_t sum = 0;
+      tree.inOrderTraverse([&](const auto& pair) { sum += pair.second; });
+      sink = sum;
+   }, tree.size());
+
+   uint64_t scanned = 0;
+
+   t.scan = ns_per([&] {
+      uint64_t sum = 0;
+      for (auto [first, last] : ranges) tree.rangeTraverse(first, last, [&](const auto& pair) { sum += pair.second; ++scanned; });
+      sink = sum;
+   }, 1);
+
+   t.scan /= max<uint64_t>(scanned, 1);
+
+   return t;
+}
+
+// A positive count from the command line, or 0 if arg is not one.
+size_t count_arg(const char *arg)
+{
+   char *end;
+
+   auto count = strtoull(arg, &end, 10);
+
+   return isdigit(static_cast<unsigned char>(arg[0])) && *end == '\0' ? count : 0;
+}
+
+int main(int argc, char** argv)
+{
+   size_t size = argc > 1 ? count_arg(argv[1]) : 10'000'000;
+   size_t lookup_count = argc > 2 ? count_arg(argv[2]) : 10'000'000;
+
+   if (argc > 3 || size == 0 || lookup_count == 0) {
+       cerr << "usage: " << argv[0] << " [tree size] [lookups]\n";
+       return 1;
+   }
+
+   mt19937_64 rng{12345};
+
+   vector<uint64_t> keys(size);
+
+   for (auto& key : keys) key = rng();
+
+   vector<uint64_t> lookups(lookup_count);
+
+   for (auto& key : lookups) key = keys[rng() % size];
+
+   // Keys are uniform, so a range of 100 * 2^64 / size covers about 100 of them.
+   uint64_t width = ~uint64_t{0} / size * 100;
+
+   vector<pair<uint64_t, uint64_t>> ranges(100'000);
+
+   for (auto& range : ranges) {
+
+       auto first = rng() % (~uint64_t{0} - width);
+
+       range = {first, first + width};
+   }
+
+   auto off = run<no_prefetch>(keys, lookups, ranges);
+   auto on = run<prefetch_nodes>(keys, lookups, ranges);
+
+   cout << size << " keys, " << lookup_count << " finds; ns per operation\n\n"
+        << setw(16) << left << "operation" << right << setw(14) << "no_prefetch" << setw(16) << "prefetch_nodes" << setw(10) << "speedup" << '\n';
+
+   auto row = [](const string& name, double off, double on) {
+      cout << setw(16) << left << name << right << fixed << setprecision(1) << setw(14) << off << setw(16) << on << setprecision(2) << setw(10)
+           << off / on << '\n';
+   };
+
+   row("insert", off.insert, on.insert);
+   row("find", off.find, on.find);
+   row("iterate", off.iterate, on.iterate);
+   row("inOrderTraverse", off.traverse, on.traverse);
+   row("rangeTraverse", off.scan, on.scan);
+
+   return 0;
+}
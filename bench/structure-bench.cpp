@@ -0,0 +1,174 @@
+/*
+ * Copy and destruction strategies for tree234's nodes.
+ *
+ * Build: make bench (or g++ -std=c++2a -O2 -DNDEBUG -pthread -Iinclude -o structure-bench bench/structure-bench.cpp)
+ * Usage: structure-bench [--max-size N] [--threads N]
+ *
+ * For trees of 1K keys and each power of ten up to --max-size (default 10M; 100M takes about 12 GB), built from shuffled int64_t keys, times
+ *
+ *    copy    recursive     tree234(tree, copy_algorithm::recursive): Node(const Node&) recursing once per level
+ *            preorder      tree234(tree, copy_algorithm::preorder): copy_subtree(), a loop over a fixed stack (the default)
+ *            level-order   breadth-first into a pool, one array of exactly as many nodes as the tree has, with plain pointers
+ *            parallel      tree234(tree, pool): subtrees copied as tasks on a work-stealing pool of --threads threads
+ *
+ *    destroy recursive     clear(destroy_algorithm::recursive): destroy_subtree()
+ *            iterative     clear(destroy_algorithm::iterative): destroy_subtree_iterative(), a loop over a fixed stack (the default)
+ *            pool reset    freeing the level-order pool's array
+ *
+ * and reports the best of three runs in milliseconds and nanoseconds per node. The pool is not a tree234: it shows what copying and freeing
+ * cost when nodes are not allocated one at a time, which tree234, whose nodes are each owned by a unique_ptr and freed by remove(), cannot do.
+ */
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "tree234.h"
+
+using namespace std;
+
+using tree_type = tree234<int64_t, int64_t>;
+using node_type = tree_type::node_type;
+
+volatile int64_t sink; // keeps the copies observable
+
+// A node of the level-order pool: tree234's Node with plain pointers.
+struct pool_node {
+   int totalItems;
+   pool_node *parent;
+   array<pair<int64_t, int64_t>, 3> keys_values;
+   array<pool_node *, 4> children;
+};
+
+void copy_node(pool_node& to, const node_type *from, pool_node *parent) noexcept
+{
+   to.totalItems = from->getTotalItems();
+   to.parent = parent;
+
+   for (auto i = 0; i < to.totalItems; ++i) to.keys_values[i] = {from->key(i), from->value(i)};
+
+   to.children = {};
+}
+
+/*
+ * Copies the tree breadth first into nodes, which must hold exactly as many nodes as the tree has. sources doubles as the queue: nodes[i] is
+ * the copy of sources[i], so the nodes still to be expanded are those past the cursor.
+ */
+void level_order_copy(const tree_type& tree, vector<pool_node>& nodes)
+{
+   if (nodes.empty()) return;
+
+   unique_ptr<const node_type *[]> sources{new const node_type *[nodes.size()]};
+
+   sources[0] = tree.getRoot();
+   copy_node(nodes[0], sources[0], nullptr);
+
+   size_t filled = 1;
+
+   for (size_t cursor = 0; cursor < filled; ++cursor) {
+
+       const node_type *from = sources[cursor];
+
+       if (from->isLeaf()) continue;
+
+       for (auto i = 0; i < from->getChildCount(); ++i) {
+
+           sources[filled] = from->getChild(i);
+           copy_node(nodes[filled], sources[filled], &nodes[cursor]);
+           nodes[cursor].children[i] = &nodes[filled];
+           ++filled;
+       }
+   }
+}
+
+template<typename Setup, typename Timed> double best_ms(Setup setup, Timed timed, int repeats = 3)
+{
+   double best = 1e300;
+
+   for (auto i = 0; i < repeats; ++i) {
+
+       setup();
+
+       auto start = chrono::steady_clock::now();
+       timed();
+       auto stop = chrono::steady_clock::now();
+
+       best = min(best, chrono::duration<double, milli>(stop - start).count());
+   }
+
+   return best;
+}
+
+void print(const char *operation, const char *strategy, double ms, size_t nodes)
+{
+   cout << setw(9) << operation << setw(14) << strategy << fixed << setprecision(2) << setw(12) << ms << setw(12) << ms * 1e6 / nodes << '\n';
+}
+
+void run(int64_t n, work_stealing_pool& pool)
+{
+   vector<int64_t> keys(n);
+
+   for (int64_t i = 0; i < n; ++i) keys[i] = i;
+
+   shuffle(keys.begin(), keys.end(), mt19937_64{12345});
+
+   tree_type tree;
+
+   for (auto key : keys) tree.insert(key, key);
+
+   keys = {};
+
+   auto nodes = tree.memory_report().nodes;
+
+   cout << n << " keys, " << nodes << " nodes, height " << tree.height() << '\n'
+        << setw(9) << "operation" << setw(14) << "strategy" << setw(12) << "ms" << setw(12) << "ns/node" << '\n';
+
+   tree_type copy;
+   vector<pool_node> pool_copy;
+
+   auto free_copies = [&] { copy.clear(); pool_copy = {}; };
+
+   print("copy", "recursive", best_ms(free_copies, [&] { copy = tree_type{tree, tree_type::copy_algorithm::recursive}; }), nodes);
+   print("copy", "preorder", best_ms(free_copies, [&] { copy = tree_type{tree, tree_type::copy_algorithm::preorder}; }), nodes);
+   print("copy", "level-order", best_ms(free_copies, [&] { pool_copy = vector<pool_node>(nodes); level_order_copy(tree, pool_copy); }), nodes);
+   print("copy", "parallel", best_ms(free_copies, [&] { copy = tree_type{tree, pool}; }), nodes);
+
+   sink = copy.size() + pool_copy.size();
+
+   print("destroy", "recursive", best_ms([&] { copy = tree; }, [&] { copy.clear(tree_type::destroy_algorithm::recursive); }), nodes);
+   print("destroy", "iterative", best_ms([&] { copy = tree; }, [&] { copy.clear(tree_type::destroy_algorithm::iterative); }), nodes);
+   print("destroy", "pool reset", best_ms([&] { pool_copy = vector<pool_node>(nodes); level_order_copy(tree, pool_copy); }, [&] { pool_copy = {}; }), nodes);
+
+   cout << '\n';
+}
+
+int main(int argc, char** argv)
+{
+   int64_t max_size = 10'000'000;
+   unsigned threads = thread::hardware_concurrency();
+
+   for (int i = 1; i < argc; ++i) {
+
+       string arg = argv[i];
+
+       if (arg == "--max-size" && i + 1 < argc) max_size = atoll(argv[++i]);
+       else if (arg == "--threads" && i + 1 < argc) threads = max(1, atoi(argv[++i]));
+       else {
+           cerr << "usage: " << argv[0] << " [--max-size N] [--threads N]\n";
+           return 1;
+       }
+   }
+
+   work_stealing_pool pool{threads};
+
+   for (int64_t n = 1000; n <= max_size; n *= 10) run(n, pool);
+
+   return 0;
+}
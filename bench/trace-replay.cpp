@@ -0,0 +1,261 @@
+/*
+ * Replays an operation trace recorded by traced_tree234 (see traced-tree234.h) against tree234 and std::map.
+ *
+ * Build: make bench (or g++ -std=c++2a -O2 -DNDEBUG -pthread -Iinclude -o trace-replay bench/trace-replay.cpp)
+ * Usage: trace-replay <trace> [--threads N]
+ *        trace-replay --generate <ops> <trace>
+ *
+ * The trace's load records, which hold the tree's contents when recording started, are inserted first, untimed. The other records are then
+ * replayed as fast as possible, each one timed, and the report gives the throughput and, per operation, the p50/p99/p999 and maximum latency
+ * in nanoseconds. Inserted values are the keys themselves.
+ *
+ * With one thread (the default) the records are replayed in order, so a replay is deterministic. With N threads, thread t replays records t,
+ * t + N, t + 2N, ... under a std::shared_mutex, shared for find and scan and exclusive for insert and remove; the interleaving of the threads
+ * then varies from run to run.
+ *
+ * Traces of 32- and 64-bit integer keys can be replayed. --generate records a synthetic trace of that many operations on 64-bit keys (80% find,
+ * 10% insert, 5% remove, 5% scans of up to 100 keys, after 100,000 initial inserts) for trying the tool out.
+ */
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "traced-tree234.h"
+
+using namespace std;
+
+volatile uint64_t sink; // keeps the results of finds and scans observable
+
+template<typename Key> struct tree_adapter {
+
+   using container = tree234<Key, uint64_t>;
+
+   static constexpr const char *name = "tree234";
+
+   static uint64_t apply(container& c, const trace_record<Key>& r)
+   {
+      switch (r.op) {
+
+         case trace_op::find: return c.find(r.key);
+
+         case trace_op::insert:
+         case trace_op::load: c.insert(r.key, static_cast<uint64_t>(r.key)); return 0;
+
+         case trace_op::remove: return c.remove(r.key);
+
+         case trace_op::scan: {
+
+            uint64_t count = 0;
+            c.rangeTraverse(r.key, r.last, [&](const auto&) { ++count; });
+            return count;
+         }
+      }
+      return 0;
+   }
+};
+
+template<typename Key> struct map_adapter {
+
+   using container = map<Key, uint64_t>;
+
+   static constexpr const char *name = "std::map";
+
+   static uint64_t apply(container& c, const trace_record<Key>& r)
+   {
+      switch (r.op) {
+
+         case trace_op::find: return c.find(r.key) != c.end();
+
+         case trace_op::insert:
+         case trace_op::load: c.emplace(r.key, static_cast<uint64_t>(r.key)); return 0;
+
+         case trace_op::remove: return c.erase(r.key);
+
+         case trace_op::scan: {
+
+            uint64_t count = 0;
+            for (auto iter = c.lower_bound(r.key); iter != c.end() && iter->first < r.last; ++iter) ++count;
+            return count;
+         }
+      }
+      return 0;
+   }
+};
+
+constexpr int op_kinds = 4; // find, insert, remove, scan
+constexpr const char *op_names[op_kinds] = {"find", "insert", "remove", "scan"};
+
+using histograms = vector<latency_histogram>;
+
+inline bool is_write(trace_op op) noexcept { return op == trace_op::insert || op == trace_op::remove; }
+
+template<typename Adapter, typename Key> void replay(const vector<trace_record<Key>>& records, unsigned threads)
+{
+   typename Adapter::container c;
+
+   vector<const trace_record<Key> *> timed;
+
+   for (auto& r : records) {
+
+       if (r.op == trace_op::load) Adapter::apply(c, r);
+       else timed.push_back(&r);
+   }
+
+   vector<histograms> per_thread(threads, histograms(op_kinds));
+
+   shared_mutex mutex;
+
+   auto run = [&](unsigned t) {
+
+      auto& latency = per_thread[t];
+      uint64_t result = 0;
+
+      for (size_t i = t; i < timed.size(); i += threads) {
+
+          auto& r = *timed[i];
+          auto start = chrono::steady_clock::now();
+
+          if (threads == 1) {
+
+              result += Adapter::apply(c, r);
+
+          } else if (is_write(r.op)) {
+
+              unique_lock lock{mutex};
+              result += Adapter::apply(c, r);
+
+          } else {
+
+              shared_lock lock{mutex};
+              result += Adapter::apply(c, r);
+          }
+
+          latency[static_cast<int>(r.op) - 1].record(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+      }
+
+      sink = result;
+   };
+
+   auto start = chrono::steady_clock::now();
+
+   if (threads == 1) {
+
+       run(0);
+
+   } else {
+
+       vector<thread> workers;
+
+       for (unsigned t = 0; t < threads; ++t) workers.emplace_back(run, t);
+
+       for (auto& worker : workers) worker.join();
+   }
+
+   auto seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+   histograms total(op_kinds);
+
+   for (auto& h : per_thread)
+       for (int k = 0; k < op_kinds; ++k) total[k] += h[k];
+
+   cout << Adapter::name << ", " << threads << (threads == 1 ? " thread: " : " threads: ") << timed.size() << " operations in " << fixed << setprecision(3)
+        << seconds << " s, " << setprecision(2) << timed.size() / seconds / 1e6 << " Mops/s\n";
+
+   cout << setw(10) << "op" << setw(12) << "count" << setw(10) << "p50 ns" << setw(10) << "p99 ns" << setw(10) << "p999 ns" << setw(12) << "max ns" << '\n';
+
+   for (int k = 0; k < op_kinds; ++k) {
+
+       if (total[k].count() == 0) continue;
+
+       cout << setw(10) << op_names[k] << setw(12) << total[k].count() << setw(10) << total[k].percentile(50) << setw(10) << total[k].percentile(99)
+            << setw(10) << total[k].percentile(99.9) << setw(12) << total[k].max() << '\n';
+   }
+
+   cout << '\n';
+}
+
+template<typename Key> void replay_trace(const string& path, unsigned threads)
+{
+   auto records = read_trace<Key>(path);
+
+   cout << path << ": " << records.size() << " records\n\n";
+
+   replay<tree_adapter<Key>>(records, threads);
+   replay<map_adapter<Key>>(records, threads);
+}
+
+void generate(uint64_t ops, const string& path)
+{
+   traced_tree234<uint64_t, uint64_t> tree;
+
+   mt19937_64 rng{1};
+
+   const uint64_t key_space = 1'000'000;
+
+   for (int i = 0; i < 100'000; ++i) tree.insert(rng() % key_space, i);
+
+   tree.start_trace(path);
+
+   for (uint64_t i = 0; i < ops; ++i) {
+
+       uint64_t key = rng() % key_space;
+       auto dice = rng() % 100;
+
+       if (dice < 80) (void) tree.find(key);
+       else if (dice < 90) tree.insert(key, i);
+       else if (dice < 95) tree.remove(key);
+       else tree.scan(key, key + 1 + rng() % 1000, [](const auto&) {});
+   }
+
+   tree.stop_trace();
+}
+
+int main(int argc, char** argv)
+{
+   try {
+
+      if (argc == 4 && string(argv[1]) == "--generate") {
+
+          generate(strtoull(argv[2], nullptr, 10), argv[3]);
+          return 0;
+      }
+
+      if (argc != 2 && !(argc == 4 && string(argv[2]) == "--threads")) {
+
+          cerr << "usage: " << argv[0] << " <trace> [--threads N]\n       " << argv[0] << " --generate <ops> <trace>\n";
+          return 1;
+      }
+
+      string path = argv[1];
+      unsigned threads = argc == 4 ? max(1, atoi(argv[3])) : 1;
+
+      ifstream ifstr{path, ios::binary};
+
+      trace_header header{};
+
+      if (!ifstr.read(reinterpret_cast<char *>(&header), sizeof(header)) || header.magic != trace_magic)
+          throw runtime_error(path + " is not a trace");
+
+      if (header.key_kind == 1 && header.key_size == 4) replay_trace<int32_t>(path, threads);
+      else if (header.key_kind == 1 && header.key_size == 8) replay_trace<int64_t>(path, threads);
+      else if (header.key_kind == 0 && header.key_size == 4) replay_trace<uint32_t>(path, threads);
+      else if (header.key_kind == 0 && header.key_size == 8) replay_trace<uint64_t>(path, threads);
+      else throw runtime_error(path + ": only traces of 32- and 64-bit integer keys can be replayed");
+
+   } catch (const exception& e) {
+
+      cerr << e.what() << '\n';
+      return 1;
+   }
+
+   return 0;
+}
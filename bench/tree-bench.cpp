@@ -0,0 +1,631 @@
+/*
+ * Benchmark suite for tree234 against std::map.
+ *
+ * Build: make bench (or g++ -std=c++2a -O2 -DNDEBUG -pthread -Iinclude -o tree-bench bench/tree-bench.cpp)
+ * Usage: tree-bench [--max-size N] [--types int,string,wide] [--orders sequential,uniform,zipfian,adversarial] [--perf] [--csv]
+ *        tree-bench --alloc-audit [--types int,string,wide]
+ *
+ * For each key type, each size from 1K by powers of ten up to --max-size (default 1M; 100M needs tens of GB for the string type), and each key
+ * ordering, both containers are timed on:
+ *
+ *    insert    n inserts into an empty container, in the ordering's key sequence
+ *    find      n finds of the same sequence
+ *    iterate   one in-order pass over all pairs (reported per pair)
+ *    copy      copy construction (per pair)
+ *    destroy   destruction of the copy (per pair)
+ *    remove    n removes of the same sequence
+ *
+ * Key types: int -> int; std::string (16 characters, so every key is heap-allocated) -> int; and int -> a 128-byte "wide" value.
+ *
+ * Orderings of the n keys 0..n-1:
+ *
+ *    sequential    ascending
+ *    uniform       a random permutation
+ *    zipfian       n draws from a Zipf distribution (theta 0.99) over the keys, so hot keys repeat and inserts include duplicates
+ *    adversarial   zig-zag from both ends inwards (0, n-1, 1, n-2, ...), which splits nodes on both edges of the tree and, on removal,
+ *                  keeps draining 2-nodes at both edges
+ *
+ * Every operator new is counted, so each row also reports allocations per operation, and bytes/entry gives the heap bytes (as reported by
+ * malloc_usable_size()) held by the container after the inserts, divided by its size.
+ *
+ * --perf also reads hardware counters around each measured phase (see perf-counters.h) and reports cycles, instructions, IPC, L1d, LLC and
+ * dTLB load misses and branch misses per operation. Events the machine does not offer print as nan.
+ *
+ * tree234's find, iterate, destroy and remove must not allocate; if one of their rows shows an allocation, the benchmark reports it and exits
+ * with status 2. --alloc-audit instead calls each public tree234 operation on a tree of 10,000 keys and reports the allocations and bytes
+ * attributed to each call, failing in the same way if an operation listed as allocation-free allocates.
+ */
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <new>
+#include <random>
+#include <span>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <malloc.h>
+#include "tree234.h"
+#include "perf-counters.h"
+
+using namespace std;
+
+namespace {
+
+atomic<uint64_t> allocations{0};
+atomic<uint64_t> allocated_bytes{0}; // every byte ever allocated
+atomic<int64_t> heap_bytes{0};       // bytes currently allocated
+
+void *counted_alloc(size_t size)
+{
+   void *p = malloc(size ? size : 1);
+
+   if (!p) throw bad_alloc();
+
+   auto bytes = malloc_usable_size(p);
+
+   allocations.fetch_add(1, memory_order_relaxed);
+   allocated_bytes.fetch_add(bytes, memory_order_relaxed);
+   heap_bytes.fetch_add(bytes, memory_order_relaxed);
+   return p;
+}
+
+void *counted_aligned_alloc(size_t size, align_val_t align)
+{
+   void *p = nullptr;
+
+   if (posix_memalign(&p, static_cast<size_t>(align), size ? size : 1) != 0) throw bad_alloc();
+
+   auto bytes = malloc_usable_size(p);
+
+   allocations.fetch_add(1, memory_order_relaxed);
+   allocated_bytes.fetch_add(bytes, memory_order_relaxed);
+   heap_bytes.fetch_add(bytes, memory_order_relaxed);
+   return p;
+}
+
+void counted_free(void *p) noexcept
+{
+   if (!p) return;
+
+   heap_bytes.fetch_sub(malloc_usable_size(p), memory_order_relaxed);
+   free(p);
+}
+
+} // namespace
+
+void *operator new(size_t size) { return counted_alloc(size); }
+void *operator new[](size_t size) { return counted_alloc(size); }
+void *operator new(size_t size, align_val_t align) { return counted_aligned_alloc(size, align); }
+void *operator new[](size_t size, align_val_t align) { return counted_aligned_alloc(size, align); }
+void operator delete(void *p) noexcept { counted_free(p); }
+void operator delete[](void *p) noexcept { counted_free(p); }
+void operator delete(void *p, size_t) noexcept { counted_free(p); }
+void operator delete[](void *p, size_t) noexcept { counted_free(p); }
+void operator delete(void *p, align_val_t) noexcept { counted_free(p); }
+void operator delete[](void *p, align_val_t) noexcept { counted_free(p); }
+void operator delete(void *p, size_t, align_val_t) noexcept { counted_free(p); }
+void operator delete[](void *p, size_t, align_val_t) noexcept { counted_free(p); }
+
+struct wide {
+   array<uint64_t, 16> data{};
+
+   wide() = default;
+   explicit wide(uint64_t x) { data.fill(x); }
+};
+
+ostream& operator<<(ostream& ostr, const wide& w) { return ostr << w.data[0]; }
+
+template<typename T> struct key_traits;
+
+template<> struct key_traits<int> {
+   static int make(uint64_t i) { return static_cast<int>(i); }
+};
+
+template<> struct key_traits<string> {
+   static string make(uint64_t i)
+   {
+      char buffer[32];
+      snprintf(buffer, sizeof(buffer), "key:%012llu", static_cast<unsigned long long>(i));
+      return buffer;
+   }
+};
+
+/*
+ * Zipf-distributed ranks in [0, n), as generated by YCSB (Gray et al., "Quickly generating billion-record synthetic databases"). Rank r is
+ * mapped to a key by a multiplication modulo n, so the hot keys are spread over the key space.
+ */
+class zipf_generator {
+
+      uint64_t n;
+      double theta, alpha, zetan, eta;
+
+      static double zeta(uint64_t n, double theta)
+      {
+         double sum = 0;
+
+         for (uint64_t i = 1; i <= n; ++i) sum += 1.0 / pow(static_cast<double>(i), theta);
+
+         return sum;
+      }
+
+   public:
+
+      zipf_generator(uint64_t n_in, double theta_in = 0.99) : n{n_in}, theta{theta_in}
+      {
+         double zeta2 = zeta(2, theta);
+
+         zetan = zeta(n, theta);
+         alpha = 1.0 / (1.0 - theta);
+         eta = (1.0 - pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta2 / zetan);
+      }
+
+      template<typename Rng> uint64_t operator()(Rng& rng)
+      {
+         double u = uniform_real_distribution<double>(0.0, 1.0)(rng);
+         double uz = u * zetan;
+
+         uint64_t rank;
+
+         if (uz < 1.0) rank = 0;
+         else if (uz < 1.0 + pow(0.5, theta)) rank = 1;
+         else rank = static_cast<uint64_t>(n * pow(eta * u - eta + 1.0, alpha));
+
+         rank = min(rank, n - 1);
+
+         return (rank * 2654435761ull) % n; // 2654435761 is prime, so this permutes [0, n) unless n is a multiple of it
+      }
+};
+
+vector<uint64_t> key_sequence(const string& order, uint64_t n)
+{
+   vector<uint64_t> seq(n);
+
+   mt19937_64 rng{n};
+
+   if (order == "sequential" || order == "uniform") {
+
+       for (uint64_t i = 0; i < n; ++i) seq[i] = i;
+
+       if (order == "uniform") shuffle(seq.begin(), seq.end(), rng);
+
+   } else if (order == "zipfian") {
+
+       zipf_generator zipf{n};
+
+       for (auto& key : seq) key = zipf(rng);
+
+   } else if (order == "adversarial") {
+
+       for (uint64_t i = 0, lo = 0, hi = n; i < n; ++i) seq[i] = (i % 2 == 0) ? lo++ : --hi;
+
+   } else {
+
+       throw invalid_argument("unknown ordering " + order);
+   }
+
+   return seq;
+}
+
+// Uniform interface over the two containers.
+template<typename Key, typename Value> struct tree_adapter {
+
+   using container = tree234<Key, Value>;
+
+   static constexpr const char *name = "tree234";
+
+   static void insert(container& c, const Key& key, const Value& value) { c.insert(key, value); }
+   static bool find(const container& c, const Key& key) { return c.find(key); }
+   static void remove(container& c, const Key& key) { c.remove(key); }
+   static size_t size(const container& c) { return static_cast<size_t>(c.size()); }
+};
+
+template<typename Key, typename Value> struct map_adapter {
+
+   using container = map<Key, Value>;
+
+   static constexpr const char *name = "std::map";
+
+   static void insert(container& c, const Key& key, const Value& value) { c.emplace(key, value); }
+   static bool find(const container& c, const Key& key) { return c.find(key) != c.end(); }
+   static void remove(container& c, const Key& key) { c.erase(key); }
+   static size_t size(const container& c) { return c.size(); }
+};
+
+using event_counts = array<double, perf_counters::event_count>;
+
+struct measurement {
+   double ns_per_op;
+   double allocs_per_op;
+   event_counts events_per_op; // nan unless --perf
+};
+
+struct row {
+   string type, order, op, container;
+   uint64_t size;
+   measurement m;
+   double bytes_per_entry;
+};
+
+vector<row> results;
+
+unique_ptr<perf_counters> hardware_counters; // set by --perf
+
+template<typename F> measurement measure(uint64_t ops, F f)
+{
+   event_counts events;
+
+   events.fill(NAN);
+
+   auto allocs_before = allocations.load();
+
+   if (hardware_counters) hardware_counters->start();
+
+   auto start = chrono::steady_clock::now();
+
+   f();
+
+   auto seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+   if (hardware_counters) events = hardware_counters->stop();
+
+   auto divisor = double(max<uint64_t>(ops, 1));
+
+   for (auto& count : events) count /= divisor;
+
+   return {seconds * 1e9 / divisor, double(allocations.load() - allocs_before) / divisor, events};
+}
+
+volatile uint64_t sink; // keeps results of finds and iteration observable
+
+template<typename Adapter, typename Key, typename Value> void run_container(const string& type, const string& order, uint64_t n, const vector<Key>& keys, const vector<Value>& values)
+{
+   using container = typename Adapter::container;
+
+   auto record = [&](const string& op, measurement m, double bytes = 0) { results.push_back({type, order, op, Adapter::name, n, m, bytes}); };
+
+   auto base_bytes = heap_bytes.load();
+
+   auto c = make_unique<container>();
+
+   auto m = measure(n, [&] { for (uint64_t i = 0; i < n; ++i) Adapter::insert(*c, keys[i], values[i]); });
+
+   auto entries = Adapter::size(*c);
+
+   record("insert", m, double(heap_bytes.load() - base_bytes) / max<size_t>(entries, 1));
+
+   record("find", measure(n, [&] {
+      uint64_t found = 0;
+      for (uint64_t i = 0; i < n; ++i) found += Adapter::find(*c, keys[i]);
+      sink = found;
+   }));
+
+   record("iterate", measure(entries, [&] {
+      uint64_t count = 0;
+      for (const auto& pair : *c) count += sizeof(pair.first);
+      sink = count;
+   }));
+
+   unique_ptr<container> copy;
+
+   record("copy", measure(entries, [&] { copy = make_unique<container>(*c); }));
+
+   record("destroy", measure(entries, [&] { copy.reset(); }));
+
+   record("remove", measure(n, [&] { for (uint64_t i = 0; i < n; ++i) Adapter::remove(*c, keys[i]); }));
+}
+
+template<typename Key, typename Value> void run_type(const string& type, uint64_t n, const vector<string>& orders)
+{
+   for (const auto& order : orders) {
+
+       auto seq = key_sequence(order, n);
+
+       vector<Key> keys;
+       vector<Value> values;
+
+       keys.reserve(n);
+       values.reserve(n);
+
+       for (auto i : seq) {
+
+           keys.push_back(key_traits<Key>::make(i));
+           values.push_back(Value(i));
+       }
+
+       run_container<tree_adapter<Key, Value>>(type, order, n, keys, values);
+       run_container<map_adapter<Key, Value>>(type, order, n, keys, values);
+   }
+}
+
+// The hardware counters per operation of an ordering's six tree234 rows and six std::map rows, interleaved.
+void print_counters(vector<row>::const_iterator rows)
+{
+   cout << setw(21) << "" << setw(10) << left << "counters" << right << setw(10) << "cycles" << setw(10) << "instr" << setw(6) << "IPC"
+        << setw(10) << "L1d miss" << setw(10) << "LLC miss" << setw(10) << "dTLB miss" << setw(10) << "br miss" << '\n';
+
+   for (int j = 0; j < 6; ++j) {
+
+       for (auto& r : {rows[j], rows[6 + j]}) {
+
+           auto& e = r.m.events_per_op;
+
+           cout << setw(12) << "" << setw(9) << left << r.op << setw(10) << r.container << right << fixed << setprecision(1)
+                << setw(10) << e[perf_counters::cycles] << setw(10) << e[perf_counters::instructions]
+                << setw(6) << setprecision(2) << e[perf_counters::instructions] / e[perf_counters::cycles] << setprecision(3)
+                << setw(10) << e[perf_counters::l1d_misses] << setw(10) << e[perf_counters::llc_misses]
+                << setw(10) << e[perf_counters::dtlb_misses] << setw(10) << e[perf_counters::branch_misses] << '\n';
+       }
+   }
+}
+
+void print_table(bool csv)
+{
+   if (csv) {
+
+       cout << "type,size,order,op,container,ns_per_op,allocs_per_op,bytes_per_entry";
+
+       if (hardware_counters) for (auto name : perf_counters::names) cout << ',' << name << "_per_op";
+
+       cout << '\n';
+
+       for (auto& r : results) {
+
+           cout << r.type << ',' << r.size << ',' << r.order << ',' << r.op << ',' << r.container << ',' << r.m.ns_per_op << ',' << r.m.allocs_per_op << ','
+                << r.bytes_per_entry;
+
+           if (hardware_counters) for (auto count : r.m.events_per_op) cout << ',' << count;
+
+           cout << '\n';
+       }
+       return;
+   }
+
+   string heading;
+
+   for (size_t i = 0; i + 12 <= results.size(); ) {
+
+       auto& t = results[i];
+
+       ostringstream title;
+       title << t.type << ", " << t.size << " keys";
+
+       if (title.str() != heading) {
+
+           heading = title.str();
+
+           cout << '\n' << heading << '\n'
+                << setw(12) << left << "order" << setw(9) << "op" << right
+                << setw(12) << "tree234 ns" << setw(12) << "map ns" << setw(8) << "ratio"
+                << setw(13) << "tree allocs" << setw(12) << "map allocs"
+                << setw(12) << "tree B/key" << setw(11) << "map B/key" << '\n';
+       }
+
+       // The six tree234 rows of an ordering are followed by its six std::map rows.
+       for (int j = 0; j < 6; ++j) {
+
+           auto& a = results[i + j];
+           auto& b = results[i + 6 + j];
+
+           cout << setw(12) << left << a.order << setw(9) << a.op << right << fixed
+                << setw(12) << setprecision(1) << a.m.ns_per_op << setw(12) << b.m.ns_per_op
+                << setw(8) << setprecision(2) << a.m.ns_per_op / b.m.ns_per_op
+                << setw(13) << setprecision(3) << a.m.allocs_per_op << setw(12) << b.m.allocs_per_op;
+
+           if (a.op == "insert") cout << setw(12) << setprecision(1) << a.bytes_per_entry << setw(11) << b.bytes_per_entry;
+
+           cout << '\n';
+       }
+
+       if (hardware_counters) print_counters(results.begin() + i);
+
+       i += 12;
+   }
+}
+
+// tree234 rows whose operation must not allocate. Returns false, after listing them, if any did.
+bool check_allocation_free(const vector<row>& rows)
+{
+   bool ok = true;
+
+   for (auto& r : rows) {
+
+       if (string(r.container) != "tree234" || r.m.allocs_per_op == 0) continue;
+
+       if (r.op == "find" || r.op == "iterate" || r.op == "destroy" || r.op == "remove") {
+
+           cerr << "allocation check failed: tree234 " << r.op << " (" << r.type << ", " << r.order << ", " << r.size << " keys) made "
+                << r.m.allocs_per_op << " allocations per operation\n";
+           ok = false;
+       }
+   }
+
+   return ok;
+}
+
+/*
+ * The allocations attributed to each public tree234 operation. Each operation is called 'calls' times (whole-tree operations fewer),
+ * round-robin over the keys, and must not allocate if allocation_free is set.
+ */
+template<typename Key, typename Value> bool audit_allocations(const string& type)
+{
+   using tree_type = tree234<Key, Value>;
+
+   constexpr uint64_t n = 10'000;
+   constexpr uint64_t calls = 1'000;
+   constexpr uint64_t whole_tree_calls = 10;
+
+   vector<Key> keys, absent;
+   vector<Value> values;
+
+   for (uint64_t i = 0; i < n; ++i) {
+
+       keys.push_back(key_traits<Key>::make(2 * i));
+       absent.push_back(key_traits<Key>::make(2 * i + 1));
+       values.push_back(Value(i));
+   }
+
+   tree_type tree;
+
+   for (uint64_t i = 0; i < n; ++i) tree.insert(keys[i], values[i]);
+
+   vector<Key> key_column(n);
+   vector<Value> value_column(n);
+
+   struct operation {
+      const char *name;
+      bool allocation_free;
+      uint64_t count;
+      function<void(uint64_t)> call;
+   };
+
+   uint64_t result = 0;
+
+   // insert() splits the 4-nodes on its path even when the key is present, and isBalanced() and levelOrderTraverse() queue the nodes.
+   vector<operation> operations{
+      {"find (present)",       true,  calls,             [&](uint64_t i) { result += tree.find(keys[i % n]); }},
+      {"find (absent)",        true,  calls,             [&](uint64_t i) { result += tree.find(absent[i % n]); }},
+      {"insert (present)",     false, calls,             [&](uint64_t i) { tree.insert(keys[i % n], values[i % n]); }},
+      {"remove (absent)",      true,  calls,             [&](uint64_t i) { result += tree.remove(absent[i % n]); }},
+      {"begin/end",            true,  calls,             [&](uint64_t)   { result += tree.begin() != tree.end(); }},
+      {"iterate",              true,  whole_tree_calls,  [&](uint64_t)   { for (auto& pair : tree) result += sizeof(pair.first); }},
+      {"reverse iterate",      true,  whole_tree_calls,  [&](uint64_t)   { for (auto iter = tree.rbegin(); iter != tree.rend(); ++iter) ++result; }},
+      {"inOrderTraverse",      true,  whole_tree_calls,  [&](uint64_t)   { tree.inOrderTraverse([&](const auto&) { ++result; }); }},
+      {"rangeTraverse",        true,  calls,             [&](uint64_t i) { tree.rangeTraverse(keys[i % (n - 100)], keys[i % (n - 100) + 100], [&](const auto&) { ++result; }); }},
+      {"export_columns",       true,  whole_tree_calls,  [&](uint64_t)   { result += tree.export_columns(span<Key>(key_column), span<Value>(value_column)); }},
+      {"height",               true,  calls,             [&](uint64_t)   { result += tree.height(); }},
+      {"isBalanced",           false, whole_tree_calls,  [&](uint64_t)   { result += tree.isBalanced(); }},
+      {"stats",                true,  calls,             [&](uint64_t)   { result += tree.stats().split; }},
+      {"remove+insert",        false, calls,             [&](uint64_t i) { tree.remove(keys[i % n]); tree.insert(keys[i % n], values[i % n]); }},
+      {"levelOrderTraverse",   false, whole_tree_calls,  [&](uint64_t)   { tree.levelOrderTraverse([&](const auto *, int) { ++result; }); }},
+      {"memory_report",        false, whole_tree_calls,  [&](uint64_t)   { result += tree.memory_report().nodes; }},
+      {"copy",                 false, whole_tree_calls,  [&](uint64_t)   { tree_type copy{tree}; result += copy.size(); }},
+   };
+
+   // Once untimed, so that one-time allocations (e.g. of the std::function) are not attributed to the operation.
+   for (auto& op : operations) op.call(0);
+
+   cout << '\n' << type << ", " << n << " keys\n"
+        << setw(20) << left << "operation" << right << setw(14) << "allocs/call" << setw(14) << "bytes/call" << setw(16) << "must be free" << '\n';
+
+   bool ok = true;
+
+   for (auto& op : operations) {
+
+       auto allocs_before = allocations.load();
+       auto bytes_before = allocated_bytes.load();
+
+       for (uint64_t i = 0; i < op.count; ++i) op.call(i);
+
+       auto allocs = double(allocations.load() - allocs_before) / op.count;
+       auto bytes = double(allocated_bytes.load() - bytes_before) / op.count;
+
+       bool failed = op.allocation_free && allocs > 0;
+
+       cout << setw(20) << left << op.name << right << fixed << setprecision(3) << setw(14) << allocs << setw(14) << setprecision(1) << bytes
+            << setw(16) << (op.allocation_free ? "yes" : "no") << (failed ? "   FAILED" : "") << '\n';
+
+       ok = ok && !failed;
+   }
+
+   sink = result;
+
+   return ok;
+}
+
+vector<string> split(const string& list)
+{
+   vector<string> items;
+   stringstream sstr{list};
+
+   for (string item; getline(sstr, item, ','); ) items.push_back(item);
+
+   return items;
+}
+
+int main(int argc, char** argv)
+{
+   uint64_t max_size = 1'000'000;
+   vector<string> types{"int", "string", "wide"};
+   vector<string> orders{"sequential", "uniform", "zipfian", "adversarial"};
+   bool csv = false;
+   bool alloc_audit = false;
+
+   for (int i = 1; i < argc; ++i) {
+
+       string arg = argv[i];
+
+       if (arg == "--max-size" && i + 1 < argc) max_size = strtoull(argv[++i], nullptr, 10);
+       else if (arg == "--types" && i + 1 < argc) types = split(argv[++i]);
+       else if (arg == "--orders" && i + 1 < argc) orders = split(argv[++i]);
+       else if (arg == "--perf") hardware_counters = make_unique<perf_counters>();
+       else if (arg == "--csv") csv = true;
+       else if (arg == "--alloc-audit") alloc_audit = true;
+       else {
+           cerr << "usage: " << argv[0] << " [--max-size N] [--types int,string,wide] [--orders sequential,uniform,zipfian,adversarial] [--perf] [--csv]\n"
+                << "       " << argv[0] << " --alloc-audit [--types int,string,wide]\n";
+           return 1;
+       }
+   }
+
+   if (hardware_counters && !hardware_counters->any_available())
+       cerr << "--perf: perf_event_open is not permitted here (see /proc/sys/kernel/perf_event_paranoid); counters will read nan\n";
+
+   bool allocation_free = true;
+
+   try {
+
+      if (alloc_audit) {
+
+          for (const auto& type : types) {
+
+              if (type == "int") allocation_free &= audit_allocations<int, int>(type);
+              else if (type == "string") allocation_free &= audit_allocations<string, int>(type);
+              else if (type == "wide") allocation_free &= audit_allocations<int, wide>(type);
+              else throw invalid_argument("unknown type " + type);
+          }
+
+          return allocation_free ? 0 : 2;
+      }
+
+      for (uint64_t n = 1000; n <= max_size; n *= 10) {
+
+          for (const auto& type : types) {
+
+              if (type == "int") run_type<int, int>(type, n, orders);
+              else if (type == "string") run_type<string, int>(type, n, orders);
+              else if (type == "wide") run_type<int, wide>(type, n, orders);
+              else throw invalid_argument("unknown type " + type);
+
+              if (!csv) {
+                  allocation_free &= check_allocation_free(results);
+                  print_table(false);
+                  results.clear();
+              }
+          }
+      }
+
+   } catch (const exception& e) {
+
+      cerr << e.what() << '\n';
+      return 1;
+   }
+
+   if (csv) {
+       allocation_free &= check_allocation_free(results);
+       print_table(true);
+   }
+
+   return allocation_free ? 0 : 2;
+}
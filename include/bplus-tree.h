@@ -0,0 +1,721 @@
+#ifndef bplus_tree_h_8125036
+#define bplus_tree_h_8125036
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <utility>
+#include "btree.h"
+#include "btree-node.h"
+
+/*
+ * bplus_tree<Key, Value, Order, LeafCapacity> is the B+tree counterpart of btree, for scan-heavy workloads. Internal nodes hold only routing
+ * keys and up to Order children; every key and value lives in a leaf of up to LeafCapacity pairs, and the leaves form a doubly linked list in
+ * key order. Iteration and range scans walk that list, visiting each leaf once and internal nodes not at all, and a search reads routing keys
+ * only, so the internal levels are small enough to stay in cache.
+ *
+ * The algorithms are btree's top-down ones, and internal nodes are split, fused and rotated by the same btree_nodes operations (btree-node.h).
+ * insert() splits every full node on its way down; a leaf splits into two halves and the first key of the right half is copied up as the
+ * parent's routing key. remove() gives every node it descends into more than the minimum number of entries, by moving one over from an
+ * adjacent sibling or by fusing the node with a sibling, so the leaf reached can lose a key. A routing key of child i is a lower bound of the
+ * keys in children i + 1 and up and an upper bound (exclusive) of those in children 0 to i; it need not itself be in the tree, so removals
+ * never have to update routing keys other than those of the nodes they rebalance.
+ *
+ * Key and Value must be default constructible and assignable.
+ */
+template<typename Key, typename Value, int Order, int LeafCapacity = Order - 1> class bplus_tree {
+
+      static_assert(Order >= 4 && Order % 2 == 0, "top-down splitting needs an even Order of at least 4");
+      static_assert(LeafCapacity >= 2, "a leaf must hold at least two pairs");
+
+   public:
+
+      static constexpr int max_keys = Order - 1;         // routing keys of an internal node
+      static constexpr int min_keys = Order / 2 - 1;
+      static constexpr int leaf_capacity = LeafCapacity;
+      static constexpr int min_leaf_items = LeafCapacity / 2;
+
+   private:
+
+      struct node_base {
+         int totalItems;
+         bool leaf;
+      };
+
+      struct alignas(cache_line_size) leaf_node : node_base {
+
+         std::array<Key, LeafCapacity> keys;
+         std::array<Value, LeafCapacity> values;
+
+         leaf_node *prev;
+         leaf_node *next;
+
+         leaf_node() noexcept : node_base{0, true}, prev{nullptr}, next{nullptr} {}
+
+         // Index of the first key not less than key.
+         int lower_bound(const Key& key) const noexcept
+         {
+            return static_cast<int>(std::lower_bound(keys.begin(), keys.begin() + this->totalItems, key) - keys.begin());
+         }
+      };
+
+      struct node_deleter {
+         void operator()(node_base *pnode) const noexcept;
+      };
+
+      using node_ptr = std::unique_ptr<node_base, node_deleter>;
+
+      struct alignas(cache_line_size) internal_node : node_base {
+
+         std::array<Key, max_keys> keys;
+         std::array<node_ptr, Order> children;
+
+         internal_node() noexcept : node_base{0, false} {}
+
+         // The child whose keys include key: the number of routing keys not greater than key.
+         int child_index(const Key& key) const noexcept
+         {
+            return static_cast<int>(std::upper_bound(keys.begin(), keys.begin() + this->totalItems, key) - keys.begin());
+         }
+      };
+
+      static internal_node *as_internal(node_base *pnode) noexcept { return static_cast<internal_node *>(pnode); }
+      static const internal_node *as_internal(const node_base *pnode) noexcept { return static_cast<const internal_node *>(pnode); }
+      static leaf_node *as_leaf(node_base *pnode) noexcept { return static_cast<leaf_node *>(pnode); }
+      static const leaf_node *as_leaf(const node_base *pnode) noexcept { return static_cast<const leaf_node *>(pnode); }
+
+      static bool isFull(const node_base *pnode) noexcept { return pnode->totalItems == (pnode->leaf ? LeafCapacity : max_keys); }
+      static bool isMinimal(const node_base *pnode) noexcept { return pnode->totalItems <= (pnode->leaf ? min_leaf_items : min_keys); }
+
+      // True if pkey points at one of pnode's key slots, as the key of insert(iter->first, ...) or remove(iter->first) does.
+      static bool stores(const node_base *pnode, const Key *pkey) noexcept
+      {
+         const Key *first = pnode->leaf ? as_leaf(pnode)->keys.data() : as_internal(pnode)->keys.data();
+         const Key *last = first + (pnode->leaf ? LeafCapacity : max_keys);
+
+         return std::less_equal<const Key *>{}(first, pkey) && std::less<const Key *>{}(pkey, last);
+      }
+
+      node_ptr root;
+      leaf_node *first_leaf;
+      leaf_node *last_leaf;
+      int tree_size;
+
+      void split_child(internal_node *parent, int i);
+      void merge_children(internal_node *parent, int i);
+
+      static void rotate_right(internal_node *parent, int i); // moves an entry from parent->children[i - 1] into parent->children[i]
+      static void rotate_left(internal_node *parent, int i);  // moves an entry from parent->children[i + 1] into parent->children[i]
+
+      const leaf_node *find_leaf(const Key& key) const noexcept;
+
+      // Copies the subtree; prev is the copy of the last leaf before it, and is left at the copy of its last leaf.
+      static node_ptr copy_subtree(const node_base *src, leaf_node *& prev);
+
+      bool DoIsBalanced(const node_base *pnode, int depth, int& leaf_depth, const Key *lower, const Key *upper) const noexcept;
+
+   public:
+
+      using key_type = Key;
+      using mapped_type = Value;
+
+      class const_iterator {
+
+            friend class bplus_tree<Key, Value, Order, LeafCapacity>;
+
+            const bplus_tree *tree;
+            const leaf_node *leaf;  // nullptr at end()
+            int index;
+
+            const_iterator(const bplus_tree *tree_in, const leaf_node *leaf_in, int index_in) noexcept : tree{tree_in}, leaf{leaf_in}, index{index_in} {}
+
+         public:
+
+            using iterator_category = std::bidirectional_iterator_tag;
+            using value_type = std::pair<const Key&, const Value&>;
+            using difference_type = std::ptrdiff_t;
+            using reference = value_type;
+
+            const_iterator() noexcept : tree{nullptr}, leaf{nullptr}, index{0} {}
+
+            std::pair<const Key&, const Value&> operator*() const noexcept { return {leaf->keys[index], leaf->values[index]}; }
+
+            const Key& key() const noexcept { return leaf->keys[index]; }
+            const Value& value() const noexcept { return leaf->values[index]; }
+
+            const_iterator& operator++() noexcept
+            {
+               if (++index == leaf->totalItems) {
+
+                   leaf = leaf->next;
+                   index = 0;
+               }
+               return *this;
+            }
+
+            const_iterator& operator--() noexcept
+            {
+               if (!leaf) {
+
+                   leaf = tree->last_leaf;
+                   index = leaf->totalItems - 1;
+
+               } else if (index-- == 0) {
+
+                   leaf = leaf->prev;
+                   index = leaf->totalItems - 1;
+               }
+               return *this;
+            }
+
+            const_iterator operator++(int) noexcept { auto copy = *this; ++*this; return copy; }
+            const_iterator operator--(int) noexcept { auto copy = *this; --*this; return copy; }
+
+            friend bool operator==(const const_iterator& lhs, const const_iterator& rhs) noexcept
+            {
+               return lhs.leaf == rhs.leaf && lhs.index == rhs.index;
+            }
+      };
+
+      using iterator = const_iterator;
+
+      bplus_tree() noexcept : root{}, first_leaf{nullptr}, last_leaf{nullptr}, tree_size{0} {}
+
+      bplus_tree(std::initializer_list<std::pair<Key, Value>> list) : bplus_tree()
+      {
+         for (auto& [key, value] : list) insert(key, value);
+      }
+
+      bplus_tree(const bplus_tree& lhs) : bplus_tree()
+      {
+         if (!lhs.root) return;
+
+         leaf_node *prev = nullptr;
+
+         root = copy_subtree(lhs.root.get(), prev);
+
+         for (first_leaf = prev; first_leaf->prev; first_leaf = first_leaf->prev);
+
+         last_leaf = prev;
+         tree_size = lhs.tree_size;
+      }
+
+      bplus_tree(bplus_tree&& lhs) noexcept : root{std::move(lhs.root)}, first_leaf{lhs.first_leaf}, last_leaf{lhs.last_leaf}, tree_size{lhs.tree_size}
+      {
+         lhs.first_leaf = lhs.last_leaf = nullptr;
+         lhs.tree_size = 0;
+      }
+
+      bplus_tree& operator=(const bplus_tree& lhs)
+      {
+         if (this != &lhs) {
+
+             bplus_tree copy{lhs};
+             *this = std::move(copy);
+         }
+         return *this;
+      }
+
+      bplus_tree& operator=(bplus_tree&& lhs) noexcept
+      {
+         if (this != &lhs) {
+
+             root = std::move(lhs.root);
+             first_leaf = lhs.first_leaf;
+             last_leaf = lhs.last_leaf;
+             tree_size = lhs.tree_size;
+
+             lhs.first_leaf = lhs.last_leaf = nullptr;
+             lhs.tree_size = 0;
+         }
+         return *this;
+      }
+
+      void clear() noexcept
+      {
+         root.reset();
+         first_leaf = last_leaf = nullptr;
+         tree_size = 0;
+      }
+
+      int size() const noexcept { return tree_size; }
+
+      bool isEmpty() const noexcept { return tree_size == 0; }
+
+      bool find(const Key& key) const noexcept { return lookup(key) != nullptr; }
+
+      std::optional<Value> get(const Key& key) const
+      {
+         auto pvalue = lookup(key);
+
+         return pvalue ? std::optional<Value>{*pvalue} : std::nullopt;
+      }
+
+      // The value stored under key, or nullptr. Valid until the tree is next modified.
+      const Value *lookup(const Key& key) const noexcept;
+
+      // As with tree234::insert(), an existing key keeps its value. Returns true if key was inserted.
+      bool insert(const Key& key, const Value& value);
+
+      // As with tree234::remove(), key may be a key stored in the tree, as in remove(iter->first); it is copied before it could be moved.
+      bool remove(const Key& key);
+
+      const_iterator begin() const noexcept { return {this, first_leaf, 0}; }
+
+      const_iterator end() const noexcept { return {this, nullptr, 0}; }
+
+      // The first pair whose key is not less than key, or end().
+      const_iterator lower_bound(const Key& key) const noexcept;
+
+      // Calls f(const Key&, const Value&) in key order.
+      template<typename Functor> void inOrderTraverse(Functor f) const
+      {
+         for (const leaf_node *leaf = first_leaf; leaf; leaf = leaf->next)
+             for (auto i = 0; i < leaf->totalItems; ++i) f(leaf->keys[i], leaf->values[i]);
+      }
+
+      // Calls f(const Key&, const Value&) in key order on the pairs whose keys are in [first, last).
+      template<typename Functor> void rangeTraverse(const Key& first, const Key& last, Functor f) const
+      {
+         if (!root) return;
+
+         const leaf_node *leaf = find_leaf(first);
+
+         for (auto i = leaf->lower_bound(first); leaf; leaf = leaf->next, i = 0) {
+
+             for (; i < leaf->totalItems; ++i) {
+
+                 if (!(leaf->keys[i] < last)) return;
+
+                 f(leaf->keys[i], leaf->values[i]);
+             }
+         }
+      }
+
+      int height() const noexcept;
+
+      // True if every leaf is at the same depth, every node but the root is at least half full, the keys are in order and the leaf list
+      // links every leaf in order.
+      bool isBalanced() const noexcept;
+
+      static constexpr std::size_t internal_node_bytes() noexcept { return sizeof(internal_node); }
+      static constexpr std::size_t leaf_node_bytes() noexcept { return sizeof(leaf_node); }
+
+      friend std::ostream& operator<<(std::ostream& ostr, const bplus_tree& tree)
+      {
+         for (auto [key, value] : tree) ostr << key << ' ';
+
+         return ostr;
+      }
+};
+
+template<typename Key, typename Value, int Order, int LeafCapacity> void bplus_tree<Key, Value, Order, LeafCapacity>::node_deleter::operator()(node_base *pnode) const noexcept
+{
+   if (pnode->leaf) delete as_leaf(pnode);
+   else delete as_internal(pnode);
+}
+
+template<typename Key, typename Value, int Order, int LeafCapacity> auto bplus_tree<Key, Value, Order, LeafCapacity>::find_leaf(const Key& key) const noexcept -> const leaf_node *
+{
+   const node_base *current = root.get();
+
+   while (!current->leaf) {
+
+       auto parent = as_internal(current);
+
+       current = parent->children[parent->child_index(key)].get();
+   }
+
+   return as_leaf(current);
+}
+
+template<typename Key, typename Value, int Order, int LeafCapacity> const Value *bplus_tree<Key, Value, Order, LeafCapacity>::lookup(const Key& key) const noexcept
+{
+   if (!root) return nullptr;
+
+   const leaf_node *leaf = find_leaf(key);
+
+   auto i = leaf->lower_bound(key);
+
+   return i < leaf->totalItems && !(key < leaf->keys[i]) ? &leaf->values[i] : nullptr;
+}
+
+template<typename Key, typename Value, int Order, int LeafCapacity> auto bplus_tree<Key, Value, Order, LeafCapacity>::lower_bound(const Key& key) const noexcept -> const_iterator
+{
+   if (!root) return end();
+
+   const leaf_node *leaf = find_leaf(key);
+
+   auto i = leaf->lower_bound(key);
+
+   if (i == leaf->totalItems) return {this, leaf->next, 0};
+
+   return {this, leaf, i};
+}
+
+/*
+ * Splits the full parent->children[i]. An internal child splits as in btree, its middle routing key moving up into parent->keys[i]. A leaf
+ * keeps its lower half, the upper half moves to a new leaf linked in after it, and the new leaf's first key is copied up. parent is not full.
+ */
+template<typename Key, typename Value, int Order, int LeafCapacity> void bplus_tree<Key, Value, Order, LeafCapacity>::split_child(internal_node *parent, int i)
+{
+   node_base *child = parent->children[i].get();
+
+   if (!child->leaf) {
+
+       auto right = new internal_node;
+
+       btree_nodes::split_child(*parent, i, *as_internal(child), *right, node_ptr{right});
+       return;
+   }
+
+   auto left = as_leaf(child);
+   auto right = new leaf_node;
+
+   node_ptr sibling{right};
+
+   constexpr int keep = LeafCapacity / 2;
+
+   btree_nodes::move_entries(*left, keep, LeafCapacity, *right, 0);
+
+   right->totalItems = LeafCapacity - keep;
+   left->totalItems = keep;
+
+   right->prev = left;
+   right->next = left->next;
+
+   if (left->next) left->next->prev = right;
+   else last_leaf = right;
+
+   left->next = right;
+
+   btree_nodes::open_gap(*parent, i);
+
+   parent->keys[i] = right->keys[0];
+   parent->children[i + 1] = std::move(sibling);
+}
+
+/*
+ * Fuses parent->children[i + 1] into parent->children[i] and removes routing key i from parent. Internal children take the routing key down
+ * between them, as in btree; leaves are simply concatenated, and the right one is unlinked from the leaf list.
+ */
+template<typename Key, typename Value, int Order, int LeafCapacity> void bplus_tree<Key, Value, Order, LeafCapacity>::merge_children(internal_node *parent, int i)
+{
+   node_ptr right_ptr = std::move(parent->children[i + 1]);
+
+   if (!right_ptr->leaf) {
+
+       btree_nodes::merge_children(*parent, i, *as_internal(parent->children[i].get()), *as_internal(right_ptr.get()));
+       return;
+   }
+
+   auto left = as_leaf(parent->children[i].get());
+   auto right = as_leaf(right_ptr.get());
+
+   btree_nodes::move_entries(*right, 0, right->totalItems, *left, left->totalItems);
+
+   left->totalItems += right->totalItems;
+
+   left->next = right->next;
+
+   if (right->next) right->next->prev = left;
+   else last_leaf = left;
+
+   btree_nodes::close_gap(*parent, i);
+}
+
+template<typename Key, typename Value, int Order, int LeafCapacity> void bplus_tree<Key, Value, Order, LeafCapacity>::rotate_right(internal_node *parent, int i)
+{
+   node_base *pchild = parent->children[i].get();
+   node_base *pleft = parent->children[i - 1].get();
+
+   if (!pchild->leaf) {
+
+       btree_nodes::rotate_right(*parent, i, *as_internal(pchild), *as_internal(pleft));
+       return;
+   }
+
+   // The left leaf's last pair moves over, and becomes the child's lower bound.
+   auto child = as_leaf(pchild);
+   auto left = as_leaf(pleft);
+
+   auto ln = left->totalItems;
+
+   btree_nodes::open_gap(*child, 0);
+
+   child->keys[0] = std::move(left->keys[ln - 1]);
+   child->values[0] = std::move(left->values[ln - 1]);
+
+   --left->totalItems;
+
+   parent->keys[i - 1] = child->keys[0];
+}
+
+template<typename Key, typename Value, int Order, int LeafCapacity> void bplus_tree<Key, Value, Order, LeafCapacity>::rotate_left(internal_node *parent, int i)
+{
+   node_base *pchild = parent->children[i].get();
+   node_base *pright = parent->children[i + 1].get();
+
+   if (!pchild->leaf) {
+
+       btree_nodes::rotate_left(*parent, i, *as_internal(pchild), *as_internal(pright));
+       return;
+   }
+
+   // The right leaf's first pair moves over, and the right leaf's new first key becomes its lower bound.
+   auto child = as_leaf(pchild);
+   auto right = as_leaf(pright);
+
+   auto cn = child->totalItems;
+
+   child->keys[cn] = std::move(right->keys[0]);
+   child->values[cn] = std::move(right->values[0]);
+
+   ++child->totalItems;
+
+   btree_nodes::close_gap(*right, 0);
+
+   parent->keys[i] = right->keys[0];
+}
+
+/*
+ * Top-down insertion: every full node met on the way down, the root included, is split before it is entered, so the leaf reached has room.
+ */
+template<typename Key, typename Value, int Order, int LeafCapacity> bool bplus_tree<Key, Value, Order, LeafCapacity>::insert(const Key& key, const Value& value)
+{
+   if (!root) {
+
+       auto leaf = new leaf_node;
+
+       root.reset(leaf);
+       first_leaf = last_leaf = leaf;
+   }
+
+   // A key stored in the tree is present, and splitting its node would move it.
+   if (stores(root.get(), &key)) return false;
+
+   if (isFull(root.get())) {
+
+       auto new_root = new internal_node;
+
+       new_root->children[0] = std::move(root);
+       root.reset(new_root);
+
+       split_child(new_root, 0);
+   }
+
+   node_base *current = root.get();
+
+   while (!current->leaf) {
+
+       auto parent = as_internal(current);
+
+       auto i = parent->child_index(key);
+
+       if (stores(parent->children[i].get(), &key)) return false;
+
+       if (isFull(parent->children[i].get())) {
+
+           split_child(parent, i);
+
+           if (!(key < parent->keys[i])) ++i;
+       }
+
+       current = parent->children[i].get();
+   }
+
+   auto leaf = as_leaf(current);
+
+   auto i = leaf->lower_bound(key);
+
+   if (i < leaf->totalItems && !(key < leaf->keys[i])) return false;
+
+   btree_nodes::open_gap(*leaf, i);
+
+   leaf->keys[i] = key;
+   leaf->values[i] = value;
+
+   ++tree_size;
+   return true;
+}
+
+/*
+ * Top-down removal: before descending into a child at its minimum, the child takes an entry from an adjacent sibling that can spare one or
+ * else is fused with a sibling. The leaf reached can then lose a key without becoming less than half full.
+ */
+template<typename Key, typename Value, int Order, int LeafCapacity> bool bplus_tree<Key, Value, Order, LeafCapacity>::remove(const Key& key_in)
+{
+   if (!root) return false;
+
+   const Key *pkey = &key_in;
+   std::optional<Key> key_copy;
+
+   node_base *current = root.get();
+
+   while (!current->leaf) {
+
+       auto parent = as_internal(current);
+
+       const Key& key = *pkey;
+
+       auto i = parent->child_index(key);
+       auto n = parent->totalItems;
+
+       if (isMinimal(parent->children[i].get())) {
+
+           // A key_in stored in the tree is in the subtree of child i, and the rotation or fusion moves only that child's own keys of it.
+           if (!key_copy && stores(parent->children[i].get(), pkey)) pkey = &key_copy.emplace(key_in);
+
+           if (i > 0 && !isMinimal(parent->children[i - 1].get())) rotate_right(parent, i);
+           else if (i < n && !isMinimal(parent->children[i + 1].get())) rotate_left(parent, i);
+           else if (i < n) merge_children(parent, i);
+           else merge_children(parent, --i);
+       }
+
+       current = parent->children[i].get();
+   }
+
+   auto leaf = as_leaf(current);
+
+   const Key& key = *pkey;
+
+   auto i = leaf->lower_bound(key);
+   auto n = leaf->totalItems;
+
+   bool removed = i < n && !(key < leaf->keys[i]);
+
+   if (removed) {
+
+       btree_nodes::close_gap(*leaf, i);
+       --tree_size;
+   }
+
+   // A fusion of the root's last routing key leaves the root with one child, which becomes the root; an empty root leaf empties the tree.
+   if (!root->leaf && root->totalItems == 0) {
+
+       node_ptr child = std::move(as_internal(root.get())->children[0]);
+       root = std::move(child);
+   }
+
+   if (root->leaf && root->totalItems == 0) clear();
+
+   return removed;
+}
+
+template<typename Key, typename Value, int Order, int LeafCapacity> int bplus_tree<Key, Value, Order, LeafCapacity>::height() const noexcept
+{
+   int height = 0;
+
+   for (const node_base *current = root.get(); current; ++height) current = current->leaf ? nullptr : as_internal(current)->children[0].get();
+
+   return height;
+}
+
+template<typename Key, typename Value, int Order, int LeafCapacity> auto bplus_tree<Key, Value, Order, LeafCapacity>::copy_subtree(const node_base *src, leaf_node *& prev) -> node_ptr
+{
+   if (src->leaf) {
+
+       auto from = as_leaf(src);
+       auto to = new leaf_node;
+
+       node_ptr copy{to};
+
+       to->totalItems = from->totalItems;
+       std::copy_n(from->keys.begin(), from->totalItems, to->keys.begin());
+       std::copy_n(from->values.begin(), from->totalItems, to->values.begin());
+
+       to->prev = prev;
+
+       if (prev) prev->next = to;
+
+       prev = to;
+       return copy;
+   }
+
+   auto from = as_internal(src);
+   auto to = new internal_node;
+
+   node_ptr copy{to};
+
+   to->totalItems = from->totalItems;
+   std::copy_n(from->keys.begin(), from->totalItems, to->keys.begin());
+
+   for (auto i = 0; i <= from->totalItems; ++i) to->children[i] = copy_subtree(from->children[i].get(), prev);
+
+   return copy;
+}
+
+template<typename Key, typename Value, int Order, int LeafCapacity> bool bplus_tree<Key, Value, Order, LeafCapacity>::isBalanced() const noexcept
+{
+   if (!root) return first_leaf == nullptr && last_leaf == nullptr && tree_size == 0;
+
+   int leaf_depth = -1;
+
+   if (!DoIsBalanced(root.get(), 0, leaf_depth, nullptr, nullptr)) return false;
+
+   // The leaf list must hold every key, in order, and be linked both ways.
+   int count = 0;
+   const leaf_node *prev = nullptr;
+
+   for (const leaf_node *leaf = first_leaf; leaf; prev = leaf, leaf = leaf->next) {
+
+       if (leaf->prev != prev) return false;
+
+       if (prev && !(prev->keys[prev->totalItems - 1] < leaf->keys[0])) return false;
+
+       count += leaf->totalItems;
+   }
+
+   return prev == last_leaf && count == tree_size;
+}
+
+template<typename Key, typename Value, int Order, int LeafCapacity> bool bplus_tree<Key, Value, Order, LeafCapacity>::DoIsBalanced(const node_base *pnode, int depth, int& leaf_depth, const Key *lower, const Key *upper) const noexcept
+{
+   bool is_root = pnode == root.get();
+
+   if (pnode->leaf) {
+
+       auto leaf = as_leaf(pnode);
+
+       if (leaf->totalItems > LeafCapacity || leaf->totalItems < (is_root ? 1 : min_leaf_items)) return false;
+
+       for (auto i = 0; i < leaf->totalItems; ++i) {
+
+           const Key& key = leaf->keys[i];
+
+           if ((lower && key < *lower) || (upper && !(key < *upper)) || (i > 0 && !(leaf->keys[i - 1] < key))) return false;
+       }
+
+       if (leaf_depth < 0) leaf_depth = depth;
+
+       return depth == leaf_depth;
+   }
+
+   auto node = as_internal(pnode);
+
+   if (node->totalItems > max_keys || node->totalItems < (is_root ? 1 : min_keys)) return false;
+
+   for (auto i = 0; i < node->totalItems; ++i) {
+
+       const Key& key = node->keys[i];
+
+       if ((lower && key < *lower) || (upper && !(key < *upper)) || (i > 0 && !(node->keys[i - 1] < key))) return false;
+   }
+
+   for (auto i = 0; i <= node->totalItems; ++i) {
+
+       const Key *child_lower = i > 0 ? &node->keys[i - 1] : lower;
+       const Key *child_upper = i < node->totalItems ? &node->keys[i] : upper;
+
+       if (!node->children[i] || !DoIsBalanced(node->children[i].get(), depth + 1, leaf_depth, child_lower, child_upper)) return false;
+   }
+
+   return true;
+}
+#endif
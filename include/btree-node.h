@@ -0,0 +1,159 @@
+#ifndef btree_node_h_2281937
+#define btree_node_h_2281937
+
+#include <algorithm>
+#include <utility>
+
+/*
+ * The node operations shared by btree, bplus_tree and paged_tree234: the shifts, splits, fusions and rotations their top-down insert() and
+ * remove() are built from. A node is any type with std::array members keys and, optionally, values and children, an item count totalItems
+ * and, if it has children, a leaf flag. A node without values, a bplus_tree internal node, moves only keys and children; a leaf, or a node
+ * without children, moves no children. Children may be any movable link, a std::unique_ptr or a page id.
+ *
+ * The operations only move entries between nodes that are already in memory. Allocating and freeing nodes, pinning and dirtying pages and
+ * linking leaves stay with the trees.
+ */
+struct btree_nodes {
+
+   template<typename Node> static constexpr bool has_values = requires(Node& node) { node.values; };
+   template<typename Node> static constexpr bool has_children = requires(Node& node) { node.children; };
+
+   // Moves keys [first, last), with their values, to key slots at and up of to, and in an internal node the children [first, last] too.
+   template<typename Node> static void move_entries(Node& from, int first, int last, Node& to, int at)
+   {
+      std::move(from.keys.begin() + first, from.keys.begin() + last, to.keys.begin() + at);
+
+      if constexpr (has_values<Node>) std::move(from.values.begin() + first, from.values.begin() + last, to.values.begin() + at);
+
+      if constexpr (has_children<Node>) {
+
+          if (!from.leaf) std::move(from.children.begin() + first, from.children.begin() + last + 1, to.children.begin() + at);
+      }
+   }
+
+   // Opens key slot i, and child slot child_slot (i or i + 1), by shifting the entries after them one place right. The caller fills them.
+   template<typename Node> static void open_gap(Node& node, int i, int child_slot)
+   {
+      int n = node.totalItems;
+
+      std::move_backward(node.keys.begin() + i, node.keys.begin() + n, node.keys.begin() + n + 1);
+
+      if constexpr (has_values<Node>) std::move_backward(node.values.begin() + i, node.values.begin() + n, node.values.begin() + n + 1);
+
+      if constexpr (has_children<Node>) {
+
+          if (!node.leaf) std::move_backward(node.children.begin() + child_slot, node.children.begin() + n + 1, node.children.begin() + n + 2);
+      }
+
+      ++node.totalItems;
+   }
+
+   template<typename Node> static void open_gap(Node& node, int i) { open_gap(node, i, i + 1); }
+
+   // Removes key i, and child child_slot (i or i + 1), by shifting the entries after them one place left.
+   template<typename Node> static void close_gap(Node& node, int i, int child_slot)
+   {
+      int n = node.totalItems;
+
+      std::move(node.keys.begin() + i + 1, node.keys.begin() + n, node.keys.begin() + i);
+
+      if constexpr (has_values<Node>) std::move(node.values.begin() + i + 1, node.values.begin() + n, node.values.begin() + i);
+
+      if constexpr (has_children<Node>) {
+
+          if (!node.leaf) std::move(node.children.begin() + child_slot + 1, node.children.begin() + n + 1, node.children.begin() + child_slot);
+      }
+
+      --node.totalItems;
+   }
+
+   template<typename Node> static void close_gap(Node& node, int i) { close_gap(node, i, i + 1); }
+
+   /*
+    * Splits the full child, which is parent.children[i], around its middle key: the keys above it (and their children) move to the empty
+    * sibling, which becomes parent.children[i + 1] through link, and the middle key moves up into parent.keys[i]. parent is not full.
+    */
+   template<typename Node, typename Link> static void split_child(Node& parent, int i, Node& child, Node& sibling, Link&& link)
+   {
+      int middle = child.totalItems / 2;
+
+      move_entries(child, middle + 1, child.totalItems, sibling, 0);
+
+      sibling.totalItems = child.totalItems - middle - 1;
+      child.totalItems = middle;
+
+      open_gap(parent, i);
+
+      parent.keys[i] = std::move(child.keys[middle]);
+
+      if constexpr (has_values<Node>) parent.values[i] = std::move(child.values[middle]);
+
+      parent.children[i + 1] = std::forward<Link>(link);
+   }
+
+   /*
+    * Fuses parent.keys[i] and right, which is parent.children[i + 1], into left, which is parent.children[i], and closes the gap in parent.
+    * The caller frees right, and, if parent's children own their nodes, must take right out of parent first.
+    */
+   template<typename Node> static void merge_children(Node& parent, int i, Node& left, Node& right)
+   {
+      int n = left.totalItems;
+
+      left.keys[n] = std::move(parent.keys[i]);
+
+      if constexpr (has_values<Node>) left.values[n] = std::move(parent.values[i]);
+
+      move_entries(right, 0, right.totalItems, left, n + 1);
+
+      left.totalItems = n + 1 + right.totalItems;
+
+      close_gap(parent, i);
+   }
+
+   // parent.keys[i - 1] moves down to the front of child, which is parent.children[i], and the largest key of left, its left sibling, moves up.
+   template<typename Node> static void rotate_right(Node& parent, int i, Node& child, Node& left)
+   {
+      int ln = left.totalItems;
+
+      open_gap(child, 0, 0);
+
+      child.keys[0] = std::move(parent.keys[i - 1]);
+
+      if constexpr (has_values<Node>) child.values[0] = std::move(parent.values[i - 1]);
+
+      if constexpr (has_children<Node>) {
+
+          if (!child.leaf) child.children[0] = std::move(left.children[ln]);
+      }
+
+      parent.keys[i - 1] = std::move(left.keys[ln - 1]);
+
+      if constexpr (has_values<Node>) parent.values[i - 1] = std::move(left.values[ln - 1]);
+
+      --left.totalItems;
+   }
+
+   // parent.keys[i] moves down to the end of child, which is parent.children[i], and the smallest key of right, its right sibling, moves up.
+   template<typename Node> static void rotate_left(Node& parent, int i, Node& child, Node& right)
+   {
+      int cn = child.totalItems;
+
+      child.keys[cn] = std::move(parent.keys[i]);
+
+      if constexpr (has_values<Node>) child.values[cn] = std::move(parent.values[i]);
+
+      if constexpr (has_children<Node>) {
+
+          if (!child.leaf) child.children[cn + 1] = std::move(right.children[0]);
+      }
+
+      ++child.totalItems;
+
+      parent.keys[i] = std::move(right.keys[0]);
+
+      if constexpr (has_values<Node>) parent.values[i] = std::move(right.values[0]);
+
+      close_gap(right, 0, 0);
+   }
+};
+#endif
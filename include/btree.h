@@ -0,0 +1,611 @@
+#ifndef btree_h_3390571
+#define btree_h_3390571
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <utility>
+#include "btree-node.h"
+
+/*
+ * btree<Key, Value, Order> is tree234 with nodes of up to Order children and Order - 1 keys, for trees too deep to search quickly as 2-3-4
+ * trees: a node that fills a few cache lines costs about one miss more than a 2-3-4 node but replaces several levels of them. The algorithms
+ * are tree234's generalized to any even Order: insert() splits every full node on its way down (find_insert_node() and split()), and
+ * remove() gives every node it descends into more than the minimum of Order / 2 - 1 keys, by rotating a key through the parent from an
+ * adjacent sibling or, if both siblings are minimal, by fusing the node, a parent key and a sibling (convert2Node() with its rotations,
+ * make3Node() and make4Node()). Neither ever has to walk back up the tree. The splits, fusions and rotations themselves are btree_nodes'
+ * (btree-node.h), which bplus_tree and paged_tree234 share. btree<Key, Value, 4> is a 2-3-4 tree and builds the same shape as tree234 for
+ * the same inserts of distinct keys (tree234 also splits the 4-nodes on the path to a key already present).
+ *
+ * Each node keeps its keys apart from its values, so a search reads only keys, and is aligned to a cache line. btree_order() picks the
+ * largest Order whose nodes fit in a given number of cache lines. Key and Value must be default constructible and assignable.
+ *
+ * tree234 stays the 2-3-4 tree with the full interface (stats, parallel traversal, batches, serialization, deferred destruction); btree has
+ * the core of it: find/get, insert, remove, in-order traversal and iteration, height and isBalanced.
+ */
+inline constexpr std::size_t cache_line_size = 64;
+
+template<typename Key, typename Value, int Order> class btree {
+
+      static_assert(Order >= 4 && Order % 2 == 0, "top-down splitting needs an even Order of at least 4");
+
+   public:
+
+      static constexpr int max_keys = Order - 1;
+      static constexpr int min_keys = Order / 2 - 1;
+
+      // Bounds the iterator's path and the stacks of copy and destruction; a tree of 2^31 keys is at most 31 levels even for Order 4.
+      static constexpr int max_height = 32;
+
+      class alignas(cache_line_size) Node {
+
+            friend class btree<Key, Value, Order>;
+            friend struct btree_nodes;
+
+            int totalItems;
+            bool leaf;
+
+            std::array<Key, max_keys> keys;
+            std::array<Value, max_keys> values;
+
+            std::array<std::unique_ptr<Node>, Order> children;
+
+            // Index of the first key not less than key.
+            int lower_bound(const Key& key) const noexcept
+            {
+               return static_cast<int>(std::lower_bound(keys.begin(), keys.begin() + totalItems, key) - keys.begin());
+            }
+
+            bool isFull() const noexcept { return totalItems == max_keys; }
+            bool isMinimal() const noexcept { return totalItems <= min_keys; }
+
+            // True if pkey points at one of this node's key slots, as the key of insert(iter->first, ...) or remove(iter->first) does.
+            bool stores(const Key *pkey) const noexcept
+            {
+               return std::less_equal<const Key *>{}(keys.data(), pkey) && std::less<const Key *>{}(pkey, keys.data() + keys.size());
+            }
+
+         public:
+
+            explicit Node(bool is_leaf) noexcept : totalItems{0}, leaf{is_leaf} {}
+
+            int getTotalItems() const noexcept { return totalItems; }
+            int getChildCount() const noexcept { return leaf ? 0 : totalItems + 1; }
+            bool isLeaf() const noexcept { return leaf; }
+
+            const Key& key(int i) const noexcept { return keys[i]; }
+            const Value& value(int i) const noexcept { return values[i]; }
+            const Node *getChild(int i) const noexcept { return children[i].get(); }
+      };
+
+   private:
+
+      std::unique_ptr<Node> root;
+      int tree_size;
+
+      static std::unique_ptr<Node> make_node(bool is_leaf) { return std::make_unique<Node>(is_leaf); }
+
+      static void split_child(Node *parent, int i);
+      static void merge_children(Node *parent, int i);
+
+      static std::unique_ptr<Node> copy_subtree(const Node *src);
+      static void destroy_subtree(std::unique_ptr<Node>& subtree) noexcept;
+
+      template<typename Functor> static void DoInOrderTraverse(Functor& f, const Node *pnode);
+
+      static bool DoIsBalanced(const Node *pnode, int depth, int& leaf_depth, const Key *lower, const Key *upper, bool is_root) noexcept;
+
+   public:
+
+      using key_type = Key;
+      using mapped_type = Value;
+      using node_type = Node;
+
+      class const_iterator {
+
+            friend class btree<Key, Value, Order>;
+
+            struct position {
+               const Node *node;
+               int index; // the key at the top of the path; below it, the child descended into, whose key is next
+            };
+
+            std::array<position, max_height> path;
+            int depth = 0; // 0 at end()
+
+            void push_leftmost(const Node *pnode) noexcept
+            {
+               for (;;) {
+
+                   path[depth++] = {pnode, 0};
+
+                   if (pnode->leaf) return;
+
+                   pnode = pnode->children[0].get();
+               }
+            }
+
+         public:
+
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = std::pair<const Key&, const Value&>;
+            using difference_type = std::ptrdiff_t;
+            using reference = value_type;
+
+            const_iterator() noexcept = default;
+
+            std::pair<const Key&, const Value&> operator*() const noexcept
+            {
+               auto& top = path[depth - 1];
+
+               return {top.node->keys[top.index], top.node->values[top.index]};
+            }
+
+            const Key& key() const noexcept { auto& top = path[depth - 1]; return top.node->keys[top.index]; }
+            const Value& value() const noexcept { auto& top = path[depth - 1]; return top.node->values[top.index]; }
+
+            const_iterator& operator++() noexcept
+            {
+               auto& top = path[depth - 1];
+
+               if (!top.node->leaf) {
+
+                   ++top.index;
+                   push_leftmost(top.node->children[top.index].get());
+                   return *this;
+               }
+
+               ++top.index;
+
+               while (depth > 0 && path[depth - 1].index == path[depth - 1].node->totalItems) --depth;
+
+               return *this;
+            }
+
+            const_iterator operator++(int) noexcept
+            {
+               auto copy = *this;
+               ++*this;
+               return copy;
+            }
+
+            friend bool operator==(const const_iterator& lhs, const const_iterator& rhs) noexcept
+            {
+               if (lhs.depth == 0 || rhs.depth == 0) return lhs.depth == rhs.depth;
+
+               auto& l = lhs.path[lhs.depth - 1];
+               auto& r = rhs.path[rhs.depth - 1];
+
+               return l.node == r.node && l.index == r.index;
+            }
+      };
+
+      using iterator = const_iterator;
+
+      btree() noexcept : root{}, tree_size{0} {}
+
+      btree(std::initializer_list<std::pair<Key, Value>> list) : btree()
+      {
+         for (auto& [key, value] : list) insert(key, value);
+      }
+
+      btree(const btree& lhs) : root{lhs.root ? copy_subtree(lhs.root.get()) : nullptr}, tree_size{lhs.tree_size} {}
+
+      btree(btree&& lhs) noexcept : root{std::move(lhs.root)}, tree_size{lhs.tree_size} { lhs.tree_size = 0; }
+
+      btree& operator=(const btree& lhs)
+      {
+         if (this != &lhs) {
+
+             btree copy{lhs};
+             *this = std::move(copy);
+         }
+         return *this;
+      }
+
+      btree& operator=(btree&& lhs) noexcept
+      {
+         if (this != &lhs) {
+
+             destroy_subtree(root);
+             root = std::move(lhs.root);
+             tree_size = lhs.tree_size;
+             lhs.tree_size = 0;
+         }
+         return *this;
+      }
+
+     ~btree() { destroy_subtree(root); }
+
+      void clear() noexcept
+      {
+         destroy_subtree(root);
+         tree_size = 0;
+      }
+
+      int size() const noexcept { return tree_size; }
+
+      bool isEmpty() const noexcept { return tree_size == 0; }
+
+      bool find(const Key& key) const noexcept { return lookup(key) != nullptr; }
+
+      std::optional<Value> get(const Key& key) const
+      {
+         auto pvalue = lookup(key);
+
+         return pvalue ? std::optional<Value>{*pvalue} : std::nullopt;
+      }
+
+      // The value stored under key, or nullptr. Valid until the tree is next modified.
+      const Value *lookup(const Key& key) const noexcept;
+
+      // As with tree234::insert(), an existing key keeps its value. Returns true if key was inserted.
+      bool insert(const Key& key, const Value& value);
+
+      // As with tree234::remove(), key may be a key stored in the tree, as in remove(iter->first); it is copied before it could be moved.
+      bool remove(const Key& key);
+
+      // Calls f(const Key&, const Value&) in key order.
+      template<typename Functor> void inOrderTraverse(Functor f) const
+      {
+         if (root) DoInOrderTraverse(f, root.get());
+      }
+
+      const_iterator begin() const noexcept
+      {
+         const_iterator iter;
+
+         if (root) iter.push_leftmost(root.get());
+
+         return iter;
+      }
+
+      const_iterator end() const noexcept { return const_iterator{}; }
+
+      int height() const noexcept;
+
+      // True if every leaf is at the same depth, every node but the root holds min_keys to max_keys keys, and the keys are in order.
+      bool isBalanced() const noexcept;
+
+      const Node *getRoot() const noexcept { return root.get(); }
+
+      static constexpr std::size_t node_bytes() noexcept { return sizeof(Node); }
+
+      friend std::ostream& operator<<(std::ostream& ostr, const btree& tree)
+      {
+         for (auto [key, value] : tree) ostr << key << ' ';
+
+         return ostr;
+      }
+};
+
+/*
+ * The largest even Order, at least 4, whose btree nodes fit in lines cache lines: a count, Order - 1 keys and values and Order child pointers,
+ * allowing a word for padding.
+ */
+template<typename Key, typename Value> constexpr int btree_order(int lines) noexcept
+{
+   auto bytes = static_cast<std::size_t>(lines) * cache_line_size;
+
+   int order = 4;
+
+   for (int next = 6; 2 * sizeof(void *) + (next - 1) * (sizeof(Key) + sizeof(Value)) + next * sizeof(void *) <= bytes; next += 2) order = next;
+
+   return order;
+}
+
+template<typename Key, typename Value, int Order> const Value *btree<Key, Value, Order>::lookup(const Key& key) const noexcept
+{
+   for (const Node *current = root.get(); current; ) {
+
+       auto i = current->lower_bound(key);
+
+       if (i < current->totalItems && !(key < current->keys[i])) return &current->values[i];
+
+       if (current->leaf) break;
+
+       current = current->children[i].get();
+   }
+
+   return nullptr;
+}
+
+// Splits the full node parent->children[i] into it and a new sibling, parent->children[i + 1]; parent is not full.
+template<typename Key, typename Value, int Order> void btree<Key, Value, Order>::split_child(Node *parent, int i)
+{
+   Node *child = parent->children[i].get();
+
+   auto sibling = make_node(child->leaf);
+
+   Node& right = *sibling;
+
+   btree_nodes::split_child(*parent, i, *child, right, std::move(sibling));
+}
+
+// Fuses parent->keys[i] and parent->children[i + 1], which is freed, into parent->children[i]. Both children hold min_keys keys.
+template<typename Key, typename Value, int Order> void btree<Key, Value, Order>::merge_children(Node *parent, int i)
+{
+   std::unique_ptr<Node> right = std::move(parent->children[i + 1]);
+
+   btree_nodes::merge_children(*parent, i, *parent->children[i], *right);
+}
+
+/*
+ * Top-down insertion, as in tree234::insert(): every full node met on the way down is split before it is entered, so the leaf reached always
+ * has room for the new key. If the root is full, a new root is created above it first.
+ */
+template<typename Key, typename Value, int Order> bool btree<Key, Value, Order>::insert(const Key& key, const Value& value)
+{
+   if (!root) {
+
+       root = make_node(true);
+
+       root->keys[0] = key;
+       root->values[0] = value;
+       root->totalItems = 1;
+
+       tree_size = 1;
+       return true;
+   }
+
+   // A key stored in the tree is present, and splitting its node would move it.
+   if (root->stores(&key)) return false;
+
+   if (root->isFull()) {
+
+       auto new_root = make_node(false);
+
+       new_root->children[0] = std::move(root);
+       root = std::move(new_root);
+
+       split_child(root.get(), 0);
+   }
+
+   Node *current = root.get();
+
+   for (;;) {
+
+       auto i = current->lower_bound(key);
+
+       if (i < current->totalItems && !(key < current->keys[i])) return false;
+
+       if (current->leaf) {
+
+           btree_nodes::open_gap(*current, i);
+
+           current->keys[i] = key;
+           current->values[i] = value;
+
+           ++tree_size;
+           return true;
+       }
+
+       if (current->children[i]->stores(&key)) return false;
+
+       if (current->children[i]->isFull()) {
+
+           split_child(current, i);
+
+           if (!(key < current->keys[i]) && !(current->keys[i] < key)) return false; // key was the child's middle key
+
+           if (current->keys[i] < key) ++i;
+       }
+
+       current = current->children[i].get();
+   }
+}
+
+/*
+ * Top-down removal. Before descending into a child that has only min_keys keys, the child is given another key, by rotation from an adjacent
+ * sibling with more than min_keys keys or, if both siblings are minimal, by fusing the child, a parent key and a sibling. A key in an internal
+ * node is replaced by its predecessor or successor from a child that can spare a key, or else the two children around it are fused and the
+ * key is removed from the fused node.
+ */
+template<typename Key, typename Value, int Order> bool btree<Key, Value, Order>::remove(const Key& key_in)
+{
+   if (!root) return false;
+
+   const Key *key = &key_in; // switches to the stored predecessor or successor when a key in an internal node is replaced
+   std::optional<Key> key_copy;
+   bool removed = false;
+
+   Node *current = root.get();
+
+   for (;;) {
+
+       auto i = current->lower_bound(*key);
+       auto n = current->totalItems;
+
+       if (i < n && !(*key < current->keys[i])) { // key is in current
+
+           if (current->leaf) {
+
+               btree_nodes::close_gap(*current, i);
+
+               removed = true;
+               break;
+           }
+
+           Node *left = current->children[i].get();
+           Node *right = current->children[i + 1].get();
+
+           if (!left->isMinimal() || !right->isMinimal()) {
+
+               // Replace the key by its predecessor (or successor) and remove that from the child, which can spare a key.
+               bool use_left = !left->isMinimal();
+
+               const Node *pnode = use_left ? left : right;
+
+               while (!pnode->leaf) pnode = use_left ? pnode->children[pnode->totalItems].get() : pnode->children[0].get();
+
+               auto j = use_left ? pnode->totalItems - 1 : 0;
+
+               current->keys[i] = pnode->keys[j];
+               current->values[i] = pnode->values[j];
+
+               key = &current->keys[i];
+               current = use_left ? left : right;
+               continue;
+           }
+
+           // The fusion moves current->keys[i] down, so a key_in stored there is copied first.
+           if (key == &current->keys[i]) key = &key_copy.emplace(key_in);
+
+           merge_children(current, i); // key moves down into the fused node
+
+           current = left;
+           continue;
+       }
+
+       if (current->leaf) break; // not found
+
+       if (current->children[i]->isMinimal()) {
+
+           auto& children = current->children;
+
+           // A key_in stored in the tree is in the subtree of child i, and the rotation or fusion moves only that child's own keys of it.
+           if (key == &key_in && children[i]->stores(key)) key = &key_copy.emplace(key_in);
+
+           if (i > 0 && !children[i - 1]->isMinimal()) btree_nodes::rotate_right(*current, i, *children[i], *children[i - 1]);
+           else if (i < n && !children[i + 1]->isMinimal()) btree_nodes::rotate_left(*current, i, *children[i], *children[i + 1]);
+           else if (i < n) merge_children(current, i);
+           else merge_children(current, --i);
+       }
+
+       current = current->children[i].get();
+   }
+
+   // A fusion of the root's last key with its two children leaves the root empty: its only child becomes the root.
+   if (root->totalItems == 0) root = root->leaf ? nullptr : std::move(root->children[0]);
+
+   if (removed) --tree_size;
+
+   return removed;
+}
+
+template<typename Key, typename Value, int Order> int btree<Key, Value, Order>::height() const noexcept
+{
+   int height = 0;
+
+   for (const Node *current = root.get(); current; ++height) current = current->leaf ? nullptr : current->children[0].get();
+
+   return height;
+}
+
+template<typename Key, typename Value, int Order> bool btree<Key, Value, Order>::isBalanced() const noexcept
+{
+   int leaf_depth = -1;
+
+   return !root || DoIsBalanced(root.get(), 0, leaf_depth, nullptr, nullptr, true);
+}
+
+template<typename Key, typename Value, int Order> bool btree<Key, Value, Order>::DoIsBalanced(const Node *pnode, int depth, int& leaf_depth, const Key *lower, const Key *upper, bool is_root) noexcept
+{
+   if (pnode->totalItems > max_keys || pnode->totalItems < (is_root ? 1 : min_keys)) return false;
+
+   for (auto i = 0; i < pnode->totalItems; ++i) {
+
+       const Key& key = pnode->keys[i];
+
+       if ((lower && !(*lower < key)) || (upper && !(key < *upper)) || (i > 0 && !(pnode->keys[i - 1] < key))) return false;
+   }
+
+   if (pnode->leaf) {
+
+       if (leaf_depth < 0) leaf_depth = depth;
+
+       return depth == leaf_depth;
+   }
+
+   for (auto i = 0; i <= pnode->totalItems; ++i) {
+
+       const Key *child_lower = i > 0 ? &pnode->keys[i - 1] : lower;
+       const Key *child_upper = i < pnode->totalItems ? &pnode->keys[i] : upper;
+
+       if (!pnode->children[i] || !DoIsBalanced(pnode->children[i].get(), depth + 1, leaf_depth, child_lower, child_upper, false)) return false;
+   }
+
+   return true;
+}
+
+template<typename Key, typename Value, int Order> template<typename Functor> void btree<Key, Value, Order>::DoInOrderTraverse(Functor& f, const Node *pnode)
+{
+   if (pnode->leaf) {
+
+       for (auto i = 0; i < pnode->totalItems; ++i) f(pnode->keys[i], pnode->values[i]);
+       return;
+   }
+
+   for (auto i = 0; i < pnode->totalItems; ++i) {
+
+       DoInOrderTraverse(f, pnode->children[i].get());
+       f(pnode->keys[i], pnode->values[i]);
+   }
+
+   DoInOrderTraverse(f, pnode->children[pnode->totalItems].get());
+}
+
+// As tree234::copy_subtree(): copied nodes wait on a fixed stack for their children to be copied.
+template<typename Key, typename Value, int Order> std::unique_ptr<typename btree<Key, Value, Order>::Node> btree<Key, Value, Order>::copy_subtree(const Node *src)
+{
+   auto copy_node = [](const Node *from) {
+
+      auto to = make_node(from->leaf);
+
+      to->totalItems = from->totalItems;
+      std::copy_n(from->keys.begin(), from->totalItems, to->keys.begin());
+      std::copy_n(from->values.begin(), from->totalItems, to->values.begin());
+      return to;
+   };
+
+   auto copy = copy_node(src);
+
+   std::array<std::pair<const Node *, Node *>, (Order - 1) * max_height + 1> pending;
+   int top = 0;
+
+   pending[top++] = {src, copy.get()};
+
+   while (top > 0) {
+
+       auto [from, to] = pending[--top];
+
+       if (from->leaf) continue;
+
+       for (auto i = from->totalItems; i >= 0; --i) {
+
+           to->children[i] = copy_node(from->children[i].get());
+
+           pending[top++] = {from->children[i].get(), to->children[i].get()};
+       }
+   }
+
+   return copy;
+}
+
+// As tree234::destroy_subtree_iterative(): a node releases its children onto a fixed stack before it is freed.
+template<typename Key, typename Value, int Order> void btree<Key, Value, Order>::destroy_subtree(std::unique_ptr<Node>& subtree) noexcept
+{
+   if (!subtree) return;
+
+   std::array<Node *, (Order - 1) * max_height + 1> pending;
+   int top = 0;
+
+   pending[top++] = subtree.release();
+
+   while (top > 0) {
+
+       Node *current = pending[--top];
+
+       if (!current->leaf)
+           for (auto i = 0; i <= current->totalItems; ++i) pending[top++] = current->children[i].release();
+
+       delete current;
+   }
+}
+#endif
@@ -0,0 +1,290 @@
+#ifndef byte_io_h_9182736
+#define byte_io_h_9182736
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+/*
+ * Byte sinks and sources for the tree234 binary formats. Values are copied with memcpy in host byte order, so they must be trivially
+ * copyable. The stream variants batch their I/O in fixed-size chunks rather than calling ostream::write()/istream::read() per field.
+ */
+class vector_sink {
+
+      std::vector<char>& buffer;
+
+   public:
+
+      explicit vector_sink(std::vector<char>& buffer_in) noexcept : buffer{buffer_in} {}
+
+      void write(const void *data, std::size_t size)
+      {
+         auto p = static_cast<const char *>(data);
+         buffer.insert(buffer.end(), p, p + size);
+      }
+
+      template<typename T> void put(const T& value)
+      {
+         static_assert(std::is_trivially_copyable_v<T>);
+         write(&value, sizeof(T));
+      }
+
+      void flush() noexcept {}
+};
+
+class stream_sink {
+
+      static constexpr std::size_t chunk = 64 * 1024;
+
+      std::ostream& ostr;
+      std::vector<char> buffer;
+
+   public:
+
+      explicit stream_sink(std::ostream& ostr_in) : ostr{ostr_in} { buffer.reserve(chunk); }
+
+     ~stream_sink() { if (!buffer.empty()) ostr.write(buffer.data(), buffer.size()); }
+
+      void write(const void *data, std::size_t size)
+      {
+         if (buffer.size() + size > chunk) flush();
+
+         if (size >= chunk) {
+
+             ostr.write(static_cast<const char *>(data), size);
+
+         } else {
+
+             auto p = static_cast<const char *>(data);
+             buffer.insert(buffer.end(), p, p + size);
+         }
+      }
+
+      template<typename T> void put(const T& value)
+      {
+         static_assert(std::is_trivially_copyable_v<T>);
+         write(&value, sizeof(T));
+      }
+
+      void flush()
+      {
+         ostr.write(buffer.data(), buffer.size());
+         buffer.clear();
+
+         if (!ostr) throw std::runtime_error("stream_sink: write failed");
+      }
+};
+
+class span_source {
+
+      std::span<const char> bytes;
+      std::size_t offset;
+
+   public:
+
+      explicit span_source(std::span<const char> bytes_in) noexcept : bytes{bytes_in}, offset{0} {}
+
+      void read(void *data, std::size_t size)
+      {
+         if (bytes.size() - offset < size) throw std::runtime_error("span_source: unexpected end of input");
+
+         std::memcpy(data, bytes.data() + offset, size);
+         offset += size;
+      }
+
+      template<typename T> T get()
+      {
+         static_assert(std::is_trivially_copyable_v<T>);
+         T value;
+         read(&value, sizeof(T));
+         return value;
+      }
+
+      std::size_t consumed() const noexcept { return offset; }
+};
+
+class stream_source {
+
+      static constexpr std::size_t chunk = 64 * 1024;
+
+      std::istream& istr;
+      std::vector<char> buffer;
+      std::size_t offset;
+      std::size_t remaining; // bytes that may still be read from istr
+
+      bool fill()
+      {
+         buffer.resize(std::min(chunk, remaining));
+         istr.read(buffer.data(), buffer.size());
+         buffer.resize(static_cast<std::size_t>(istr.gcount()));
+         offset = 0;
+         remaining -= buffer.size();
+
+         return !buffer.empty();
+      }
+
+   public:
+
+      // Never reads more than limit bytes from istr, so data that follows in the stream is left unread.
+      explicit stream_source(std::istream& istr_in, std::size_t limit = static_cast<std::size_t>(-1)) : istr{istr_in}, offset{0}, remaining{limit} {}
+
+      void read(void *data, std::size_t size)
+      {
+         auto p = static_cast<char *>(data);
+
+         while (size > 0) {
+
+            if (offset == buffer.size() && !fill()) throw std::runtime_error("stream_source: unexpected end of input");
+
+            auto n = std::min(size, buffer.size() - offset);
+
+            std::memcpy(p, buffer.data() + offset, n);
+
+            offset += n;
+            p += n;
+            size -= n;
+         }
+      }
+
+      template<typename T> T get()
+      {
+         static_assert(std::is_trivially_copyable_v<T>);
+         T value;
+         read(&value, sizeof(T));
+         return value;
+      }
+};
+
+// Reads exactly the bytes asked for straight from istr, for formats whose length is not known until they have been read.
+class istream_source {
+
+      std::istream& istr;
+
+   public:
+
+      explicit istream_source(std::istream& istr_in) noexcept : istr{istr_in} {}
+
+      void read(void *data, std::size_t size)
+      {
+         if (!istr.read(static_cast<char *>(data), size)) throw std::runtime_error("istream_source: unexpected end of input");
+      }
+
+      template<typename T> T get()
+      {
+         static_assert(std::is_trivially_copyable_v<T>);
+         T value;
+         read(&value, sizeof(T));
+         return value;
+      }
+};
+
+// LEB128 variable-length unsigned integers: seven bits per byte, low bits first, high bit set on every byte but the last.
+template<typename Sink> void put_varint(Sink& sink, std::uint64_t value)
+{
+   unsigned char bytes[10];
+   std::size_t n = 0;
+
+   while (value >= 0x80) {
+
+      bytes[n++] = static_cast<unsigned char>(value | 0x80);
+      value >>= 7;
+   }
+
+   bytes[n++] = static_cast<unsigned char>(value);
+
+   sink.write(bytes, n);
+}
+
+template<typename Source> std::uint64_t get_varint(Source& source)
+{
+   std::uint64_t value = 0;
+
+   for (int shift = 0; shift < 64; shift += 7) {
+
+       auto byte = source.template get<std::uint8_t>();
+
+       value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+
+       if (!(byte & 0x80)) return value;
+   }
+
+   throw std::runtime_error("get_varint: malformed varint");
+}
+
+// Bytes needed to hold count values of bits bits each.
+constexpr std::size_t packed_bytes(std::size_t count, int bits) noexcept
+{
+   return (count * bits + 7) / 8;
+}
+
+// Packs the low bits bits of each value, lowest bit first, into packed_bytes(count, bits) bytes at out.
+inline void pack_bits(const std::uint64_t *values, std::size_t count, int bits, unsigned char *out) noexcept
+{
+   std::memset(out, 0, packed_bytes(count, bits));
+
+   std::size_t bit = 0;
+
+   for (std::size_t i = 0; i < count; ++i) {
+
+       std::uint64_t value = values[i];
+
+       for (int written = 0; written < bits; ) {
+
+           auto shift = bit % 8;
+           auto take = std::min<int>(8 - shift, bits - written);
+
+           out[bit / 8] |= static_cast<unsigned char>((value & ((1u << take) - 1)) << shift);
+
+           value >>= take;
+           written += take;
+           bit += take;
+       }
+   }
+}
+
+// Inverse of pack_bits(). in must hold packed_bytes(count, bits) bytes; reads of whole words are used while they stay within them.
+inline void unpack_bits(const unsigned char *in, std::size_t count, int bits, std::uint64_t *values) noexcept
+{
+   auto size = packed_bytes(count, bits);
+
+   std::uint64_t mask = bits == 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << bits) - 1;
+
+   std::size_t bit = 0;
+
+   for (std::size_t i = 0; i < count; ++i, bit += bits) {
+
+       auto byte = bit / 8;
+       auto shift = bit % 8;
+
+       if (bits + shift <= 64 && byte + 8 <= size) {
+
+           std::uint64_t word;
+           std::memcpy(&word, in + byte, sizeof(word)); // assumes a little-endian host
+
+           values[i] = (word >> shift) & mask;
+           continue;
+       }
+
+       std::uint64_t value = 0;
+
+       for (int read = 0; read < bits; ) {
+
+           auto offset = (bit + read) % 8;
+           auto take = std::min<int>(8 - offset, bits - read);
+
+           value |= static_cast<std::uint64_t>((in[(bit + read) / 8] >> offset) & ((1u << take) - 1)) << read;
+
+           read += take;
+       }
+
+       values[i] = value;
+   }
+}
+#endif
@@ -0,0 +1,365 @@
+#ifndef durable_tree234_h_7261538
+#define durable_tree234_h_7261538
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "tree234.h"
+
+struct durability_options {
+
+   std::size_t sync_every = 64;              // fsync the log after this many records (group commit); 1 makes every operation durable on return.
+   std::size_t checkpoint_every = 1 << 20;   // write a checkpoint after this many log records; 0 disables automatic checkpoints.
+};
+
+/*
+ * durable_tree234 adds crash durability to a tree234 with a write-ahead log and periodic checkpoints, both kept in one directory:
+ *
+ *    checkpoint   checkpoint_header followed by a tree234::serialize() snapshot
+ *    wal          log_header followed by fixed-size log records
+ *
+ * Every insert() or remove() that changes the tree appends a record {op, key, value, checksum} to an in-memory buffer. The buffer is written
+ * and fsync'ed every sync_every records, or by sync(), so one fsync commits a whole group of operations. An operation is durable once the
+ * group containing it has been synced.
+ *
+ * checkpoint() saves a snapshot to a temporary file, fsyncs it, renames it over the old checkpoint, and then starts a new, empty log. Logs are
+ * numbered, and a checkpoint records the number of the last log it includes, so a crash between the rename and the new log can never cause
+ * records to be applied twice.
+ *
+ * Recovery, done by the constructor, loads the checkpoint and replays the records of a newer log up to the first torn or corrupt record,
+ * where the log is then truncated.
+ *
+ * Key and Value must be trivially copyable. The class, like tree234, is not thread-safe.
+ */
+template<typename Key, typename Value> class durable_tree234 {
+
+      static_assert(std::is_trivially_copyable_v<Key> && std::is_trivially_copyable_v<Value>, "durable_tree234 requires trivially copyable Key and Value");
+
+      struct checkpoint_header {
+         std::uint32_t magic;
+         std::uint32_t version;
+         std::uint64_t log_number; // last log whose records the checkpoint includes
+      };
+
+      struct log_header {
+         std::uint32_t magic;
+         std::uint32_t version;
+         std::uint64_t log_number;
+      };
+
+      enum class log_op : std::uint8_t { insert = 1, remove = 2 };
+
+      static constexpr std::uint32_t checkpoint_magic = 0x4b434354; // "TCCK"
+      static constexpr std::uint32_t log_magic = 0x4c415754;        // "TWAL"
+      static constexpr std::uint32_t format_version = 1;
+
+      // op, key, value, checksum
+      static constexpr std::size_t record_size = 1 + sizeof(Key) + sizeof(Value) + sizeof(std::uint32_t);
+
+      tree234<Key, Value> tree;
+
+      std::string directory;
+      durability_options options;
+
+      int log_fd;
+      std::uint64_t log_number;
+
+      std::vector<char> pending;   // records not yet written to the log
+      std::size_t unsynced;        // records appended since the last fsync
+      std::size_t since_checkpoint;
+      std::size_t replayed_records;
+
+      std::string path(const char *name) const { return directory + "/" + name; }
+
+      static std::uint32_t checksum(const char *data, std::size_t size) noexcept // FNV-1a
+      {
+         std::uint32_t hash = 2166136261u;
+
+         for (std::size_t i = 0; i < size; ++i) {
+
+             hash ^= static_cast<unsigned char>(data[i]);
+             hash *= 16777619u;
+         }
+         return hash;
+      }
+
+      static void fail(const std::string& what)
+      {
+         throw std::system_error(errno, std::generic_category(), "durable_tree234: " + what);
+      }
+
+      static void write_all(int fd, const char *data, std::size_t size, const std::string& what)
+      {
+         while (size > 0) {
+
+             auto written = ::write(fd, data, size);
+
+             if (written < 0) {
+
+                 if (errno == EINTR) continue;
+                 fail(what);
+             }
+
+             data += written;
+             size -= written;
+         }
+      }
+
+      void sync_directory() const
+      {
+         int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+
+         if (fd < 0) fail("open " + directory);
+
+         auto rc = ::fsync(fd);
+         ::close(fd);
+
+         if (rc != 0) fail("fsync " + directory);
+      }
+
+      void append(log_op op, const Key& key, const Value *value)
+      {
+         std::array<char, record_size> record{};
+
+         record[0] = static_cast<char>(op);
+         std::memcpy(record.data() + 1, &key, sizeof(Key));
+
+         if (value) std::memcpy(record.data() + 1 + sizeof(Key), value, sizeof(Value));
+
+         auto sum = checksum(record.data(), record_size - sizeof(std::uint32_t));
+
+         std::memcpy(record.data() + record_size - sizeof(std::uint32_t), &sum, sizeof(sum));
+
+         pending.insert(pending.end(), record.begin(), record.end());
+
+         ++since_checkpoint;
+
+         if (++unsynced >= options.sync_every) sync();
+
+         if (options.checkpoint_every != 0 && since_checkpoint >= options.checkpoint_every) checkpoint();
+      }
+
+      // Creates an empty log with the given number, replacing the current one.
+      void start_log(std::uint64_t number)
+      {
+         if (log_fd >= 0) ::close(log_fd);
+
+         log_fd = ::open(path("wal").c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+         if (log_fd < 0) fail("create " + path("wal"));
+
+         log_header header{log_magic, format_version, number};
+
+         write_all(log_fd, reinterpret_cast<const char *>(&header), sizeof(header), "write " + path("wal"));
+
+         if (::fsync(log_fd) != 0) fail("fsync " + path("wal"));
+
+         sync_directory();
+
+         log_number = number;
+         pending.clear();
+         unsynced = 0;
+         since_checkpoint = 0;
+      }
+
+      void recover();
+
+   public:
+
+      explicit durable_tree234(const std::string& directory_in, durability_options options_in = {}) : directory{directory_in}, options{options_in},
+                   log_fd{-1}, log_number{0}, unsynced{0}, since_checkpoint{0}, replayed_records{0}
+      {
+         if (options.sync_every == 0) options.sync_every = 1;
+
+         recover();
+      }
+
+      durable_tree234(const durable_tree234&) = delete;
+      durable_tree234& operator=(const durable_tree234&) = delete;
+
+     ~durable_tree234()
+      {
+         try {
+            sync();
+         } catch (...) {
+         }
+
+         if (log_fd >= 0) ::close(log_fd);
+      }
+
+      // Returns true if the key was inserted; as with tree234::insert(), an existing key keeps its value.
+      bool insert(const Key& key, const Value& value)
+      {
+         auto before = tree.size();
+
+         tree.insert(key, value);
+
+         if (tree.size() == before) return false;
+
+         append(log_op::insert, key, &value);
+         return true;
+      }
+
+      bool remove(const Key& key)
+      {
+         Key logged{key}; // key may be stored in the tree, as in remove(iter->first), and so gone once removed
+
+         if (!tree.remove(logged)) return false;
+
+         append(log_op::remove, logged, nullptr);
+         return true;
+      }
+
+      bool find(const Key& key) const noexcept { return tree.find(key); }
+
+      int size() const noexcept { return tree.size(); }
+
+      const tree234<Key, Value>& get_tree() const noexcept { return tree; }
+
+      // Writes the buffered records to the log and fsyncs it.
+      void sync()
+      {
+         if (!pending.empty()) {
+
+             write_all(log_fd, pending.data(), pending.size(), "write " + path("wal"));
+             pending.clear();
+         }
+
+         if (unsynced > 0) {
+
+             if (::fdatasync(log_fd) != 0) fail("fsync " + path("wal"));
+
+             unsynced = 0;
+         }
+      }
+
+      void checkpoint();
+
+      // Number of log records applied during recovery.
+      std::size_t replayed() const noexcept { return replayed_records; }
+};
+
+template<typename Key, typename Value> void durable_tree234<Key, Value>::checkpoint()
+{
+   sync();
+
+   auto tmp = path("checkpoint.tmp");
+   {
+      std::ofstream ofstr{tmp, std::ios::binary | std::ios::trunc};
+
+      if (!ofstr) fail("create " + tmp);
+
+      checkpoint_header header{checkpoint_magic, format_version, log_number};
+
+      ofstr.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+      tree.serialize(ofstr);
+
+      if (!ofstr.flush()) fail("write " + tmp);
+   }
+
+   int fd = ::open(tmp.c_str(), O_RDONLY);
+
+   if (fd < 0 || ::fsync(fd) != 0) {
+
+       if (fd >= 0) ::close(fd);
+       fail("fsync " + tmp);
+   }
+
+   ::close(fd);
+
+   if (::rename(tmp.c_str(), path("checkpoint").c_str()) != 0) fail("rename " + tmp);
+
+   sync_directory();
+
+   start_log(log_number + 1);
+}
+
+template<typename Key, typename Value> void durable_tree234<Key, Value>::recover()
+{
+   if (::mkdir(directory.c_str(), 0755) != 0 && errno != EEXIST) fail("mkdir " + directory);
+
+   std::uint64_t checkpointed = 0; // last log included in the checkpoint
+
+   std::ifstream checkpoint_file{path("checkpoint"), std::ios::binary};
+
+   if (checkpoint_file) {
+
+       checkpoint_header header;
+
+       if (!checkpoint_file.read(reinterpret_cast<char *>(&header), sizeof(header)) || header.magic != checkpoint_magic || header.version != format_version)
+           throw std::runtime_error("durable_tree234: " + path("checkpoint") + " is not a checkpoint");
+
+       tree.deserialize(checkpoint_file);
+
+       checkpointed = header.log_number;
+   }
+
+   std::ifstream log_file{path("wal"), std::ios::binary};
+
+   log_header header{};
+
+   if (!log_file || !log_file.read(reinterpret_cast<char *>(&header), sizeof(header)) || header.magic != log_magic ||
+        header.version != format_version || header.log_number <= checkpointed) {
+
+       // No log, a torn log header, or a log the checkpoint already includes.
+       log_file.close();
+       start_log(checkpointed + 1);
+       return;
+   }
+
+   std::size_t good_bytes = sizeof(header);
+
+   std::array<char, record_size> record;
+
+   while (log_file.read(record.data(), record_size)) {
+
+       std::uint32_t sum;
+       std::memcpy(&sum, record.data() + record_size - sizeof(sum), sizeof(sum));
+
+       if (sum != checksum(record.data(), record_size - sizeof(sum))) break; // torn or corrupt record: the log ends here
+
+       Key key;
+       std::memcpy(&key, record.data() + 1, sizeof(Key));
+
+       if (static_cast<log_op>(record[0]) == log_op::insert) {
+
+           Value value;
+           std::memcpy(&value, record.data() + 1 + sizeof(Key), sizeof(Value));
+
+           tree.insert(key, value);
+
+       } else if (static_cast<log_op>(record[0]) == log_op::remove) {
+
+           tree.remove(key);
+
+       } else break;
+
+       good_bytes += record_size;
+       ++replayed_records;
+   }
+
+   log_file.close();
+
+   log_fd = ::open(path("wal").c_str(), O_WRONLY);
+
+   if (log_fd < 0) fail("open " + path("wal"));
+
+   // Drop any torn tail so new records follow the last good one.
+   if (::ftruncate(log_fd, good_bytes) != 0 || ::lseek(log_fd, good_bytes, SEEK_SET) < 0 || ::fsync(log_fd) != 0)
+       fail("truncate " + path("wal"));
+
+   log_number = header.log_number;
+   since_checkpoint = replayed_records;
+}
+#endif
@@ -0,0 +1,172 @@
+#ifndef left_right_tree234_h_4728371
+#define left_right_tree234_h_4728371
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include "tree234.h"
+
+/*
+ * Left-Right concurrency control (Ramalhete and Correia) for tree234.
+ *
+ * Two tree234 instances hold the same keys. Readers always use the instance selected by left_right, and announce themselves on one of two
+ * read indicators, selected by version_index, so that they never wait: a read is two atomic increments plus the tree234 lookup. Writers are
+ * serialized by a mutex. A writer applies its change to the instance readers are not using, switches readers over to it, waits until no reader
+ * can still be on the old instance, and then applies the same change to the old instance.
+ *
+ * Writes must therefore be deterministic, since each is applied twice, and they cost about twice a single write plus the wait for in-flight
+ * readers. The two instances are created with the tree234 copy and move constructors.
+ */
+template<typename Key, typename Value> class left_right_tree234 {
+
+      static constexpr std::size_t cache_line = 64;
+
+      /*
+       * A reader indicator spread over many cache lines. Each thread is hashed to one slot, and slots hold counts rather than flags, so
+       * threads that share a slot are still counted correctly.
+       */
+      class read_indicator {
+
+            struct alignas(cache_line) slot {
+               std::atomic<long> readers{0};
+            };
+
+            static constexpr std::size_t slots = 64;
+
+            std::array<slot, slots> counters;
+
+            static std::size_t my_slot() noexcept
+            {
+               thread_local const std::size_t index = std::hash<std::thread::id>{}(std::this_thread::get_id()) % slots;
+               return index;
+            }
+
+         public:
+
+            void arrive() noexcept { counters[my_slot()].readers.fetch_add(1); }
+
+            void depart() noexcept { counters[my_slot()].readers.fetch_sub(1); }
+
+            bool empty() const noexcept
+            {
+               for (const auto& counter : counters)
+                  if (counter.readers.load() != 0) return false;
+
+               return true;
+            }
+      };
+
+      std::array<tree234<Key, Value>, 2> instances;
+
+      alignas(cache_line) std::atomic<int> left_right;    // instance readers use
+      alignas(cache_line) std::atomic<int> version_index; // read indicator new readers arrive on
+
+      mutable std::array<read_indicator, 2> indicators;
+
+      std::mutex writer_mutex;
+
+      /*
+       * Waits until no reader can still be using the instance readers were just switched away from. A reader that arrived on either indicator
+       * before the switch may be using it, so both indicators are drained, toggling version_index in between.
+       */
+      void toggle_version_and_wait() noexcept
+      {
+         int prev = version_index.load();
+         int next = 1 - prev;
+
+         while (!indicators[next].empty()) std::this_thread::yield();
+
+         version_index.store(next);
+
+         while (!indicators[prev].empty()) std::this_thread::yield();
+      }
+
+   public:
+
+      left_right_tree234() : left_right{0}, version_index{0} {}
+
+      explicit left_right_tree234(const tree234<Key, Value>& tree) : instances{tree, tree}, left_right{0}, version_index{0} {}
+
+      explicit left_right_tree234(tree234<Key, Value>&& tree) : instances{tree234<Key, Value>(tree), std::move(tree)}, left_right{0}, version_index{0} {}
+
+      left_right_tree234(const left_right_tree234&) = delete;
+      left_right_tree234& operator=(const left_right_tree234&) = delete;
+
+      /*
+       * Runs f(const tree234<Key, Value>&) against the active instance and returns its result. Wait-free with respect to writers. f must not
+       * keep references or iterators into the tree after it returns.
+       */
+      template<typename F> decltype(auto) read(F f) const
+      {
+         int vi = version_index.load();
+
+         indicators[vi].arrive();
+
+         struct departure {
+            read_indicator& indicator;
+           ~departure() { indicator.depart(); }
+         } guard{indicators[vi]};
+
+         return f(static_cast<const tree234<Key, Value>&>(instances[left_right.load()]));
+      }
+
+      bool find(const Key& key) const
+      {
+         return read([&key](const tree234<Key, Value>& tree) { return tree.find(key); });
+      }
+
+      int size() const
+      {
+         return read([](const tree234<Key, Value>& tree) { return tree.size(); });
+      }
+
+      /*
+       * Applies f(tree234<Key, Value>&) to both instances, one after the other, and returns the result of the second application. f must
+       * make the same change each time it is called.
+       */
+      template<typename F> decltype(auto) write(F f)
+      {
+         std::lock_guard<std::mutex> lock{writer_mutex};
+
+         int lr = left_right.load();
+
+         f(instances[1 - lr]);
+
+         left_right.store(1 - lr);
+
+         toggle_version_and_wait();
+
+         return f(instances[lr]);
+      }
+
+      void insert(const Key& key, const Value& value)
+      {
+         write([&](tree234<Key, Value>& tree) { tree.insert(key, value); });
+      }
+
+      bool remove(const Key& key)
+      {
+         return write([&](tree234<Key, Value>& tree) { return tree.remove(key); });
+      }
+
+      // Replaces the contents: the inactive instance receives a copy of tree and the formerly active one is moved into.
+      void assign(tree234<Key, Value> tree)
+      {
+         std::lock_guard<std::mutex> lock{writer_mutex};
+
+         int lr = left_right.load();
+
+         instances[1 - lr] = tree;
+
+         left_right.store(1 - lr);
+
+         toggle_version_and_wait();
+
+         instances[lr] = std::move(tree);
+      }
+};
+#endif
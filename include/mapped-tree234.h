@@ -0,0 +1,362 @@
+#ifndef mapped_tree234_h_5510293
+#define mapped_tree234_h_5510293
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "tree234.h"
+
+/*
+ * mapped_tree234 is a read-only view of a tree234 saved as an on-disk image. The image is mmap'ed, and find(), lower_bound() and ordered
+ * iteration work directly on the mapped pages, so opening an image of any size costs one mmap() call, and processes that map the same file
+ * share its pages in the page cache.
+ *
+ * Image layout (host byte order):
+ *
+ *    image_header, padded to nodes_offset bytes
+ *    image_node records in level order, root first
+ *
+ * Instead of unique_ptr children and parent pointers, an image_node holds the file offsets of its children (0 for a leaf). Level order keeps
+ * the upper levels of the tree, which every search touches, together in the first pages of the file. Key and Value must be trivially copyable.
+ *
+ * Only the header and file size are checked when an image is opened; the node records themselves are trusted.
+ */
+template<typename Key, typename Value> class mapped_tree234 {
+
+      static_assert(std::is_trivially_copyable_v<Key> && std::is_trivially_copyable_v<Value>, "mapped_tree234 requires trivially copyable Key and Value");
+
+      struct image_header {
+         std::uint32_t magic;
+         std::uint32_t version;
+         std::uint32_t key_size;
+         std::uint32_t value_size;
+         std::uint64_t size;
+         std::uint64_t nodes;
+         std::uint64_t root_offset;
+         std::uint32_t height;
+         std::uint32_t node_size;
+      };
+
+      struct image_node {
+         std::uint32_t totalItems;
+         std::uint32_t reserved;
+         std::array<std::uint64_t, 4> children; // file offsets; children[0] == 0 for a leaf
+         std::array<Key, 3> keys;
+         std::array<Value, 3> values;
+      };
+
+      static constexpr std::uint32_t image_magic = 0x474d4954; // "TIMG"
+      static constexpr std::uint32_t image_version = 1;
+      static constexpr std::size_t nodes_offset = 64;
+
+      static_assert(sizeof(image_header) <= nodes_offset && alignof(image_node) <= nodes_offset);
+
+      const char *base;
+      std::size_t length;
+      const image_header *header;
+
+      const image_node *node_at(std::uint64_t offset) const noexcept
+      {
+         return reinterpret_cast<const image_node *>(base + offset);
+      }
+
+   public:
+
+      class const_iterator {
+
+            friend class mapped_tree234<Key, Value>;
+
+            /*
+             * Path from the root to the current key. The top entry {node, i} is the current key, node->keys[i]. In every entry below it,
+             * i is the child of node that the path descends into, so node->keys[i], if i < totalItems, is the next key once that child's
+             * subtree is exhausted. An empty path is end().
+             */
+            const mapped_tree234 *tree;
+            std::array<std::pair<const image_node *, int>, 64> path;
+            int depth;
+
+            const_iterator(const mapped_tree234 *tree_in) noexcept : tree{tree_in}, depth{0} {}
+
+            void push(const image_node *pnode, int index) noexcept { path[depth++] = {pnode, index}; }
+
+            // Pushes the path to the smallest key of the subtree whose root is at offset.
+            void push_leftmost(std::uint64_t offset) noexcept
+            {
+               for (const image_node *pnode = tree->node_at(offset); ; pnode = tree->node_at(pnode->children[0])) {
+
+                   push(pnode, 0);
+
+                   if (pnode->children[0] == 0) break;
+               }
+            }
+
+            // Pops entries whose index has run past their keys, so the top is again a valid key (or the path is empty).
+            void settle() noexcept
+            {
+               while (depth > 0 && path[depth - 1].second == static_cast<int>(path[depth - 1].first->totalItems))
+                   --depth;
+            }
+
+         public:
+
+            using iterator_category = std::forward_iterator_tag;
+            using difference_type   = std::ptrdiff_t;
+            using value_type        = std::pair<Key, Value>;
+            using reference         = std::pair<const Key&, const Value&>;
+            using pointer           = void;
+
+            const_iterator() noexcept : tree{nullptr}, depth{0} {}
+
+            const Key& key() const noexcept { return path[depth - 1].first->keys[path[depth - 1].second]; }
+
+            const Value& value() const noexcept { return path[depth - 1].first->values[path[depth - 1].second]; }
+
+            reference operator*() const noexcept { return {key(), value()}; }
+
+            const_iterator& operator++() noexcept
+            {
+               auto& [pnode, index] = path[depth - 1];
+
+               if (pnode->children[0] != 0) {
+
+                   ++index; // now descending into child index
+                   push_leftmost(pnode->children[index]);
+
+               } else {
+
+                   ++index;
+                   settle();
+               }
+               return *this;
+            }
+
+            const_iterator operator++(int) noexcept
+            {
+               auto tmp = *this;
+               ++*this;
+               return tmp;
+            }
+
+            bool operator==(const const_iterator& lhs) const noexcept
+            {
+               if (depth == 0 || lhs.depth == 0) return depth == lhs.depth;
+
+               return path[depth - 1] == lhs.path[lhs.depth - 1];
+            }
+
+            bool operator!=(const const_iterator& lhs) const noexcept { return !operator==(lhs); }
+      };
+
+      mapped_tree234() noexcept : base{nullptr}, length{0}, header{nullptr} {}
+
+      explicit mapped_tree234(const std::string& path) : mapped_tree234() { open(path); }
+
+      mapped_tree234(const mapped_tree234&) = delete;
+      mapped_tree234& operator=(const mapped_tree234&) = delete;
+
+      mapped_tree234(mapped_tree234&& lhs) noexcept : base{lhs.base}, length{lhs.length}, header{lhs.header}
+      {
+         lhs.base = nullptr;
+         lhs.length = 0;
+         lhs.header = nullptr;
+      }
+
+      mapped_tree234& operator=(mapped_tree234&& lhs) noexcept
+      {
+         if (this != &lhs) {
+
+             close();
+             std::swap(base, lhs.base);
+             std::swap(length, lhs.length);
+             std::swap(header, lhs.header);
+         }
+         return *this;
+      }
+
+     ~mapped_tree234() { close(); }
+
+      // Writes tree as an image file at path, replacing any existing file.
+      static void write(const tree234<Key, Value>& tree, const std::string& path);
+
+      void open(const std::string& path);
+
+      void close() noexcept
+      {
+         if (base) ::munmap(const_cast<char *>(base), length);
+
+         base = nullptr;
+         length = 0;
+         header = nullptr;
+      }
+
+      bool is_open() const noexcept { return base != nullptr; }
+
+      std::size_t size() const noexcept { return header ? header->size : 0; }
+
+      int height() const noexcept { return header ? static_cast<int>(header->height) : 0; }
+
+      const_iterator begin() const noexcept
+      {
+         const_iterator iter{this};
+
+         if (size() > 0) iter.push_leftmost(header->root_offset);
+
+         return iter;
+      }
+
+      const_iterator end() const noexcept { return const_iterator{this}; }
+
+      // First key not less than key.
+      const_iterator lower_bound(const Key& key) const noexcept;
+
+      const_iterator find(const Key& key) const noexcept
+      {
+         auto iter = lower_bound(key);
+
+         return (iter != end() && !(key < iter.key())) ? iter : end();
+      }
+
+      bool contains(const Key& key) const noexcept { return find(key) != end(); }
+};
+
+template<typename Key, typename Value> typename mapped_tree234<Key, Value>::const_iterator mapped_tree234<Key, Value>::lower_bound(const Key& key) const noexcept
+{
+   const_iterator iter{this};
+
+   if (size() == 0) return iter;
+
+   for (const image_node *pnode = node_at(header->root_offset); ; ) {
+
+       int i = 0;
+       int total = static_cast<int>(pnode->totalItems);
+
+       while (i < total && pnode->keys[i] < key) ++i;
+
+       iter.push(pnode, i);
+
+       if ((i < total && !(key < pnode->keys[i])) || pnode->children[0] == 0) break; // found key, or reached a leaf
+
+       pnode = node_at(pnode->children[i]);
+   }
+
+   iter.settle();
+   return iter;
+}
+
+template<typename Key, typename Value> void mapped_tree234<Key, Value>::write(const tree234<Key, Value>& tree, const std::string& path)
+{
+   using Node = typename tree234<Key, Value>::Node;
+
+   std::ofstream ofstr{path, std::ios::binary | std::ios::trunc};
+
+   if (!ofstr) throw std::system_error(errno, std::generic_category(), "mapped_tree234::write: cannot create " + path);
+
+   image_header hdr{image_magic, image_version, sizeof(Key), sizeof(Value), static_cast<std::uint64_t>(tree.size()), 0,
+                    tree.root ? nodes_offset : 0, static_cast<std::uint32_t>(tree.height()), sizeof(image_node)};
+
+   hdr.nodes = tree.root ? tree234<Key, Value>::count_nodes(tree.root.get()) : 0;
+
+   std::array<char, nodes_offset> padded{};
+
+   std::memcpy(padded.data(), &hdr, sizeof(hdr));
+
+   stream_sink sink{ofstr};
+
+   sink.write(padded.data(), padded.size());
+
+   // Records are written in the order nodes are queued, so a child's offset is known as soon as it is queued.
+   std::queue<const Node *> nodes;
+
+   std::uint64_t queued = 0;
+
+   if (tree.root) nodes.push(tree.root.get()), ++queued;
+
+   while (!nodes.empty()) {
+
+       const Node *pnode = nodes.front();
+       nodes.pop();
+
+       image_node record{};
+
+       record.totalItems = pnode->getTotalItems();
+
+       for (auto i = 0; i < pnode->getTotalItems(); ++i) {
+
+           record.keys[i] = pnode->key(i);
+           record.values[i] = pnode->get_value(i).second;
+       }
+
+       if (!pnode->isLeaf()) {
+
+           for (auto i = 0; i < pnode->getChildCount(); ++i) {
+
+               record.children[i] = nodes_offset + queued++ * sizeof(image_node);
+               nodes.push(pnode->children[i].get());
+           }
+       }
+
+       sink.put(record);
+   }
+
+   sink.flush();
+
+   if (!ofstr.flush()) throw std::system_error(errno, std::generic_category(), "mapped_tree234::write: cannot write " + path);
+}
+
+template<typename Key, typename Value> void mapped_tree234<Key, Value>::open(const std::string& path)
+{
+   close();
+
+   int fd = ::open(path.c_str(), O_RDONLY);
+
+   if (fd < 0) throw std::system_error(errno, std::generic_category(), "mapped_tree234::open: " + path);
+
+   struct stat st;
+
+   if (::fstat(fd, &st) != 0) {
+
+       auto error = errno;
+       ::close(fd);
+       throw std::system_error(error, std::generic_category(), "mapped_tree234::open: " + path);
+   }
+
+   if (static_cast<std::size_t>(st.st_size) < nodes_offset) {
+
+       ::close(fd);
+       throw std::runtime_error("mapped_tree234::open: " + path + " is too small to be an image");
+   }
+
+   void *addr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+   auto error = errno;
+
+   ::close(fd); // the mapping keeps the file open
+
+   if (addr == MAP_FAILED) throw std::system_error(error, std::generic_category(), "mapped_tree234::open: mmap " + path);
+
+   base = static_cast<const char *>(addr);
+   length = st.st_size;
+   header = reinterpret_cast<const image_header *>(base);
+
+   if (header->magic != image_magic || header->version != image_version || header->key_size != sizeof(Key) ||
+       header->value_size != sizeof(Value) || header->node_size != sizeof(image_node) ||
+       length < nodes_offset + header->nodes * sizeof(image_node) || header->height > 64) {
+
+       close();
+       throw std::runtime_error("mapped_tree234::open: " + path + " is not an image of this tree234 type");
+   }
+}
+#endif
@@ -0,0 +1,914 @@
+#ifndef paged_tree234_h_6618203
+#define paged_tree234_h_6618203
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "btree-node.h"
+
+/*
+ * paged_tree234 keeps its nodes in fixed-size pages addressed by page ids instead of in heap Nodes owned by std::unique_ptr<Node>. The pages
+ * come from a page store; the default store, buffer_pool, keeps them in a file and caches a bounded number of them in memory, so a tree can
+ * be larger than RAM.
+ *
+ * A page holds as many keys as fit in PageSize bytes, so the tree is a B-tree of that order; with PageSize small enough for three keys it is
+ * a 2-3-4 tree. The algorithms are those of tree234 generalized to any odd maximum number of keys, 2t - 1: insert() splits full nodes on the
+ * way down (as find_insert_node() does), and remove() makes every node it descends into hold at least t keys by rotation or fusion (as
+ * find_delete_node() and convert2Node() do), so neither ever has to walk back up the tree. The splits, fusions and rotations are btree's,
+ * the btree_nodes operations of btree-node.h applied to pinned pages, with page ids as the child links.
+ *
+ * Page store interface, used by paged_tree234:
+ *
+ *    using node_type = page_node<Key, Value, PageSize>;
+ *
+ *    node_type *pin(page_id id);                    Page id stays in memory at the returned address until unpinned.
+ *    node_type *pin_for_write(page_id& id);         Pins a page the caller is about to modify. A copy-on-write store may give the page a
+ *                                                   new id, which the caller must then store in the page's parent.
+ *    void unpin(page_id id, bool dirty);
+ *    std::pair<page_id, node_type *> allocate();   A new, zeroed, pinned page.
+ *    void free(page_id id);                         id must not be pinned.
+ *    page_id root(); void set_root(page_id);
+ *    std::uint64_t size(); void set_size(std::uint64_t);
+ */
+using page_id = std::uint64_t;
+
+inline constexpr page_id null_page = 0; // Page 0 is a store's meta page and is never a node.
+
+template<typename Key, typename Value, std::size_t PageSize> struct page_node {
+
+   static_assert(std::is_trivially_copyable_v<Key> && std::is_trivially_copyable_v<Value>, "paged nodes require trivially copyable Key and Value");
+
+   static constexpr std::size_t page_size = PageSize;
+
+   // Top-down splitting needs an odd maximum: a full node splits into two nodes of min_keys keys and a middle key for the parent.
+   static constexpr int capacity = static_cast<int>((PageSize - 8 - sizeof(page_id)) / (sizeof(Key) + sizeof(Value) + sizeof(page_id)));
+   static constexpr int max_keys = (capacity % 2 == 1) ? capacity : capacity - 1;
+   static constexpr int min_keys = (max_keys - 1) / 2;
+
+   static_assert(max_keys >= 3, "PageSize is too small to hold a 2-3-4 node");
+
+   std::uint16_t totalItems;
+   std::uint16_t leaf;
+   std::uint32_t reserved;
+
+   std::array<page_id, max_keys + 1> children;
+   std::array<Key, max_keys> keys;
+   std::array<Value, max_keys> values;
+
+   bool isLeaf() const noexcept { return leaf != 0; }
+   bool isFull() const noexcept { return totalItems == max_keys; }
+   bool isMinimal() const noexcept { return totalItems <= min_keys; }
+
+   // Index of the first key not less than key.
+   int lower_bound(const Key& key) const noexcept
+   {
+      return static_cast<int>(std::lower_bound(keys.begin(), keys.begin() + totalItems, key) - keys.begin());
+   }
+};
+
+/*
+ * A file of PageSize pages cached by a fixed number of frames. Pages are evicted with the CLOCK algorithm: a frame referenced since the clock
+ * hand last passed gets a second chance, and pinned frames are never evicted. Freed pages are kept on a free list threaded through the pages
+ * themselves. Page 0 holds the file's meta data: the root page, the number of keys, the page count and the free list head.
+ */
+template<typename Node> class buffer_pool {
+
+   public:
+
+      using node_type = Node;
+
+      static constexpr std::size_t page_size = Node::page_size;
+
+      struct statistics {
+         std::uint64_t hits = 0;
+         std::uint64_t faults = 0;    // pins that had to read the page from the file
+         std::uint64_t evictions = 0;
+         std::uint64_t writes = 0;    // dirty pages written back
+      };
+
+   private:
+
+      struct alignas(64) page_buffer {
+         std::byte bytes[page_size];
+      };
+
+      struct frame {
+         page_id id = null_page;
+         int pins = 0;
+         bool dirty = false;
+         bool referenced = false;
+      };
+
+      struct meta_page {
+         std::uint32_t magic;
+         std::uint32_t page_size;
+         std::uint32_t key_size;
+         std::uint32_t node_size;
+         std::uint64_t root;
+         std::uint64_t size;
+         std::uint64_t page_count;
+         std::uint64_t free_head;
+      };
+
+      static constexpr std::uint32_t meta_magic = 0x47505454; // "TTPG"
+
+      int fd;
+      meta_page meta;
+      bool meta_dirty;
+
+      std::vector<frame> frames;
+      std::vector<page_buffer> buffers;
+      std::unordered_map<page_id, std::size_t> page_table; // page id -> frame
+      std::size_t hand;
+
+      statistics stats;
+
+      static void fail(const std::string& what)
+      {
+         throw std::system_error(errno, std::generic_category(), "buffer_pool: " + what);
+      }
+
+      void read_page(page_id id, void *data)
+      {
+         auto offset = static_cast<off_t>(id * page_size);
+
+         auto n = ::pread(fd, data, page_size, offset);
+
+         if (n < 0) fail("read");
+
+         if (static_cast<std::size_t>(n) < page_size) std::memset(static_cast<char *>(data) + n, 0, page_size - n);
+      }
+
+      void write_page(page_id id, const void *data)
+      {
+         if (::pwrite(fd, data, page_size, static_cast<off_t>(id * page_size)) != static_cast<ssize_t>(page_size)) fail("write");
+
+         ++stats.writes;
+      }
+
+      // Returns a frame to hold a new page: an unused frame, or the CLOCK victim after writing it back if it is dirty.
+      std::size_t victim()
+      {
+         for (std::size_t sweep = 0; sweep < 2 * frames.size(); ++sweep) {
+
+             auto& f = frames[hand];
+             auto index = hand;
+
+             hand = (hand + 1) % frames.size();
+
+             if (f.pins > 0) continue;
+
+             if (f.id == null_page) return index;
+
+             if (f.referenced) {
+
+                 f.referenced = false;
+                 continue;
+             }
+
+             if (f.dirty) write_page(f.id, buffers[index].bytes);
+
+             page_table.erase(f.id);
+             f = frame{};
+             ++stats.evictions;
+
+             return index;
+         }
+
+         throw std::runtime_error("buffer_pool: every frame is pinned");
+      }
+
+      node_type *attach(std::size_t index, page_id id)
+      {
+         frames[index] = frame{id, 1, false, true};
+         page_table[id] = index;
+
+         return reinterpret_cast<node_type *>(buffers[index].bytes);
+      }
+
+   public:
+
+      buffer_pool(const std::string& path, std::size_t frame_count) : meta{}, meta_dirty{false}, frames(std::max<std::size_t>(frame_count, 8)),
+                  buffers(frames.size()), hand{0}
+      {
+         fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+
+         if (fd < 0) fail("open " + path);
+
+         struct stat st;
+
+         if (::fstat(fd, &st) != 0) {
+
+             int error = errno;
+
+             ::close(fd);
+             errno = error;
+             fail("stat " + path);
+         }
+
+         if (st.st_size == 0) {
+
+             meta = meta_page{meta_magic, static_cast<std::uint32_t>(page_size), 0, sizeof(node_type), null_page, 0, 1, null_page};
+             meta_dirty = true;
+
+         } else {
+
+             if (::pread(fd, &meta, sizeof(meta), 0) != sizeof(meta) || meta.magic != meta_magic || meta.page_size != page_size || meta.node_size != sizeof(node_type)) {
+
+                 ::close(fd);
+                 throw std::runtime_error("buffer_pool: " + path + " is not a paged tree of this type");
+             }
+         }
+      }
+
+      buffer_pool(const buffer_pool&) = delete;
+      buffer_pool& operator=(const buffer_pool&) = delete;
+
+     ~buffer_pool()
+      {
+         try {
+            flush();
+         } catch (...) {
+         }
+
+         ::close(fd);
+      }
+
+      node_type *pin(page_id id)
+      {
+         if (auto iter = page_table.find(id); iter != page_table.end()) {
+
+             auto& f = frames[iter->second];
+
+             ++f.pins;
+             f.referenced = true;
+             ++stats.hits;
+
+             return reinterpret_cast<node_type *>(buffers[iter->second].bytes);
+         }
+
+         ++stats.faults;
+
+         auto index = victim();
+
+         read_page(id, buffers[index].bytes);
+
+         return attach(index, id);
+      }
+
+      node_type *pin_for_write(page_id& id) { return pin(id); }
+
+      void unpin(page_id id, bool dirty) noexcept
+      {
+         auto& f = frames[page_table.find(id)->second];
+
+         --f.pins;
+         f.dirty = f.dirty || dirty;
+      }
+
+      std::pair<page_id, node_type *> allocate()
+      {
+         page_id id;
+
+         if (meta.free_head != null_page) {
+
+             id = meta.free_head;
+
+             node_type *pnode = pin(id);
+
+             std::memcpy(&meta.free_head, pnode, sizeof(page_id)); // a free page holds the id of the next free page
+
+             std::memset(static_cast<void *>(pnode), 0, page_size);
+
+             frames[page_table[id]].dirty = true;
+             meta_dirty = true;
+
+             return {id, pnode};
+         }
+
+         id = meta.page_count++;
+         meta_dirty = true;
+
+         auto index = victim();
+
+         std::memset(buffers[index].bytes, 0, page_size);
+
+         node_type *pnode = attach(index, id);
+
+         frames[index].dirty = true;
+
+         return {id, pnode};
+      }
+
+      void free(page_id id)
+      {
+         node_type *pnode = pin(id);
+
+         std::memset(static_cast<void *>(pnode), 0, page_size);
+         std::memcpy(pnode, &meta.free_head, sizeof(page_id));
+
+         unpin(id, true);
+
+         meta.free_head = id;
+         meta_dirty = true;
+      }
+
+      page_id root() const noexcept { return meta.root; }
+
+      void set_root(page_id id) noexcept { meta.root = id; meta_dirty = true; }
+
+      std::uint64_t size() const noexcept { return meta.size; }
+
+      void set_size(std::uint64_t n) noexcept { meta.size = n; meta_dirty = true; }
+
+      // Writes back every dirty page and the meta page, and, if durable is true, fsyncs the file.
+      void flush(bool durable = false)
+      {
+         for (std::size_t i = 0; i < frames.size(); ++i) {
+
+             if (frames[i].id != null_page && frames[i].dirty) {
+
+                 write_page(frames[i].id, buffers[i].bytes);
+                 frames[i].dirty = false;
+             }
+         }
+
+         if (meta_dirty) {
+
+             std::array<std::byte, page_size> page{};
+
+             std::memcpy(page.data(), &meta, sizeof(meta));
+
+             write_page(null_page, page.data());
+             meta_dirty = false;
+         }
+
+         if (durable && ::fsync(fd) != 0) fail("fsync");
+      }
+
+      std::size_t frame_count() const noexcept { return frames.size(); }
+
+      std::uint64_t page_count() const noexcept { return meta.page_count; }
+
+      const statistics& get_statistics() const noexcept { return stats; }
+
+      void reset_statistics() noexcept { stats = statistics{}; }
+};
+
+template<typename Key, typename Value, std::size_t PageSize = 4096, template<typename> class Store = buffer_pool> class paged_tree234 {
+
+   public:
+
+      using node_type = page_node<Key, Value, PageSize>;
+      using store_type = Store<node_type>;
+
+      // capacity leaves room for the header, but padding of the key and value arrays could still push a node past its page.
+      static_assert(sizeof(node_type) <= PageSize, "a page_node does not fit in its page");
+
+      static constexpr int max_keys = node_type::max_keys;
+      static constexpr int min_keys = node_type::min_keys; // t - 1
+
+   private:
+
+      mutable store_type store;
+
+      // Unpins its page when it goes out of scope.
+      class pinned {
+
+            store_type *pstore;
+
+         public:
+
+            page_id id;
+            node_type *node;
+            bool dirty;
+
+            pinned() noexcept : pstore{nullptr}, id{null_page}, node{nullptr}, dirty{false} {}
+
+            pinned(store_type& s, page_id id_in, node_type *node_in, bool dirty_in = false) noexcept : pstore{&s}, id{id_in}, node{node_in}, dirty{dirty_in} {}
+
+            pinned(pinned&& lhs) noexcept : pstore{lhs.pstore}, id{lhs.id}, node{lhs.node}, dirty{lhs.dirty} { lhs.pstore = nullptr; }
+
+            pinned& operator=(pinned&& lhs) noexcept
+            {
+               if (this != &lhs) {
+
+                   release();
+                   pstore = lhs.pstore;
+                   id = lhs.id;
+                   node = lhs.node;
+                   dirty = lhs.dirty;
+                   lhs.pstore = nullptr;
+               }
+               return *this;
+            }
+
+           ~pinned() { release(); }
+
+            void release() noexcept
+            {
+               if (pstore) pstore->unpin(id, dirty);
+
+               pstore = nullptr;
+            }
+
+            node_type *operator->() const noexcept { return node; }
+      };
+
+      pinned pin(page_id id) const { return pinned{store, id, store.pin(id)}; }
+
+      pinned pin_for_write(page_id& id) const
+      {
+         node_type *pnode = store.pin_for_write(id);
+
+         return pinned{store, id, pnode};
+      }
+
+      // Pins child i of parent for writing, and records the child's id in the parent if the store moved it.
+      pinned pin_child_for_write(pinned& parent, int i) const
+      {
+         page_id id = parent->children[i];
+
+         auto child = pin_for_write(id);
+
+         if (id != parent->children[i]) {
+
+             parent->children[i] = id;
+             parent.dirty = true;
+         }
+         return child;
+      }
+
+      pinned allocate()
+      {
+         auto [id, pnode] = store.allocate();
+
+         return pinned{store, id, pnode, true};
+      }
+
+      pinned split_child(pinned& parent, int i, pinned& child);
+
+      void merge_children(pinned& parent, int i, pinned& left, pinned& right);
+
+      std::pair<Key, Value> subtree_max(page_id id) const;
+      std::pair<Key, Value> subtree_min(page_id id) const;
+
+      template<typename F> void for_each(page_id id, F& f) const;
+
+      bool is_balanced(page_id id, int depth, int& leaf_depth, const Key *lower, const Key *upper) const;
+
+   public:
+
+      // The arguments are passed to the page store's constructor, e.g. a file path and a frame count for buffer_pool.
+      template<typename... Args> explicit paged_tree234(Args&&... args) : store(std::forward<Args>(args)...) {}
+
+      bool find(const Key& key) const { return get(key).has_value(); }
+
+      std::optional<Value> get(const Key& key) const;
+
+      // As with tree234::insert(), an existing key keeps its value. Returns true if key was inserted.
+      bool insert(const Key& key, const Value& value);
+
+      bool remove(const Key& key);
+
+      std::uint64_t size() const noexcept { return store.size(); }
+
+      bool isEmpty() const noexcept { return store.root() == null_page; }
+
+      int height() const;
+
+      // True if every leaf is at the same depth, every node but the root holds at least min_keys keys and the keys are in order.
+      bool isBalanced() const;
+
+      // Calls f(const Key&, const Value&) in key order.
+      template<typename F> void inOrderTraverse(F f) const
+      {
+         if (store.root() != null_page) for_each(store.root(), f);
+      }
+
+      store_type& get_store() noexcept { return store; }
+
+      const store_type& get_store() const noexcept { return store; }
+};
+
+template<typename Key, typename Value, std::size_t PageSize, template<typename> class Store> std::optional<Value> paged_tree234<Key, Value, PageSize, Store>::get(const Key& key) const
+{
+   for (page_id id = store.root(); id != null_page; ) {
+
+       auto current = pin(id);
+
+       auto i = current->lower_bound(key);
+
+       if (i < current->totalItems && !(key < current->keys[i])) return current->values[i];
+
+       if (current->isLeaf()) break;
+
+       id = current->children[i];
+   }
+
+   return std::nullopt;
+}
+
+template<typename Key, typename Value, std::size_t PageSize, template<typename> class Store> int paged_tree234<Key, Value, PageSize, Store>::height() const
+{
+   int height = 0;
+
+   for (page_id id = store.root(); id != null_page; ++height) {
+
+       auto current = pin(id);
+
+       id = current->isLeaf() ? null_page : current->children[0];
+   }
+
+   return height;
+}
+
+template<typename Key, typename Value, std::size_t PageSize, template<typename> class Store> bool paged_tree234<Key, Value, PageSize, Store>::isBalanced() const
+{
+   int leaf_depth = -1;
+
+   return store.root() == null_page || is_balanced(store.root(), 0, leaf_depth, nullptr, nullptr);
+}
+
+// Like for_each(), unpins each node before descending into a child, so the bounds of the child's keys are copied out of it first.
+template<typename Key, typename Value, std::size_t PageSize, template<typename> class Store>
+bool paged_tree234<Key, Value, PageSize, Store>::is_balanced(page_id id, int depth, int& leaf_depth, const Key *lower, const Key *upper) const
+{
+   for (auto i = 0; ; ++i) {
+
+       page_id child;
+       Key child_lower, child_upper;
+       int n;
+       {
+          auto current = pin(id);
+
+          n = current->totalItems;
+
+          if (i == 0) {
+
+              if (n > max_keys || n < (depth == 0 ? 1 : min_keys)) return false;
+
+              for (auto j = 0; j < n; ++j) {
+
+                  const Key& key = current->keys[j];
+
+                  if ((lower && !(*lower < key)) || (upper && !(key < *upper)) || (j > 0 && !(current->keys[j - 1] < key))) return false;
+              }
+
+              if (current->isLeaf()) {
+
+                  if (leaf_depth < 0) leaf_depth = depth;
+
+                  return depth == leaf_depth;
+              }
+          }
+
+          if (i > n) return true;
+
+          if (i > 0) child_lower = current->keys[i - 1];
+          if (i < n) child_upper = current->keys[i];
+
+          child = current->children[i];
+       }
+
+       if (child == null_page || !is_balanced(child, depth + 1, leaf_depth, i > 0 ? &child_lower : lower, i < n ? &child_upper : upper)) return false;
+   }
+}
+
+/*
+ * Splits the full node child, which is parent->children[i], around its middle key: the upper min_keys keys (and their children) move to a new
+ * sibling that becomes parent->children[i + 1], and the middle key moves up into parent->keys[i]. parent is not full. Returns the new sibling.
+ * The sibling is allocated before anything is moved, so if the store is out of pages nothing has changed.
+ */
+template<typename Key, typename Value, std::size_t PageSize, template<typename> class Store> typename paged_tree234<Key, Value, PageSize, Store>::pinned
+paged_tree234<Key, Value, PageSize, Store>::split_child(pinned& parent, int i, pinned& child)
+{
+   auto sibling = allocate();
+
+   sibling->leaf = child->leaf;
+
+   btree_nodes::split_child(*parent.node, i, *child.node, *sibling.node, sibling.id);
+
+   child.dirty = parent.dirty = true;
+
+   return sibling;
+}
+
+/*
+ * Fuses parent->keys[i] and right, which is parent->children[i + 1], into left, which is parent->children[i]. Both children hold min_keys keys,
+ * so left becomes full. right is only read, so it may be pinned read-only, and its page is freed.
+ */
+template<typename Key, typename Value, std::size_t PageSize, template<typename> class Store> void paged_tree234<Key, Value, PageSize, Store>::merge_children(pinned& parent, int i, pinned& left, pinned& right)
+{
+   btree_nodes::merge_children(*parent.node, i, *left.node, *right.node);
+
+   left.dirty = parent.dirty = true;
+
+   auto right_id = right.id;
+
+   right.release();
+   store.free(right_id);
+}
+
+template<typename Key, typename Value, std::size_t PageSize, template<typename> class Store> std::pair<Key, Value> paged_tree234<Key, Value, PageSize, Store>::subtree_max(page_id id) const
+{
+   for (;;) {
+
+      auto current = pin(id);
+
+      if (current->isLeaf()) return {current->keys[current->totalItems - 1], current->values[current->totalItems - 1]};
+
+      id = current->children[current->totalItems];
+   }
+}
+
+template<typename Key, typename Value, std::size_t PageSize, template<typename> class Store> std::pair<Key, Value> paged_tree234<Key, Value, PageSize, Store>::subtree_min(page_id id) const
+{
+   for (;;) {
+
+      auto current = pin(id);
+
+      if (current->isLeaf()) return {current->keys[0], current->values[0]};
+
+      id = current->children[0];
+   }
+}
+
+/*
+ * Top-down insertion, as in tree234::insert(): every full node met on the way down is split before it is entered, so the leaf reached always
+ * has room for the new key. If the root is full, a new root is created above it first. If the store runs out of pages, allocate()'s exception
+ * propagates and the tree is left valid without the new key; splits already made on the way down stay.
+ *
+ * A read-only search first rules out a key already present, so that an insert() that changes nothing pins no page for write; under a
+ * copy-on-write store such as shadow_page_store, a write pin copies the page.
+ */
+template<typename Key, typename Value, std::size_t PageSize, template<typename> class Store> bool paged_tree234<Key, Value, PageSize, Store>::insert(const Key& key, const Value& value)
+{
+   if (store.root() == null_page) {
+
+       auto root = allocate();
+
+       root->leaf = 1;
+       root->totalItems = 1;
+       root->keys[0] = key;
+       root->values[0] = value;
+
+       store.set_root(root.id);
+       store.set_size(1);
+       return true;
+   }
+
+   if (find(key)) return false;
+
+   page_id root_id = store.root();
+
+   auto current = pin_for_write(root_id);
+
+   store.set_root(root_id);
+
+   if (current->isFull()) {
+
+       auto new_root = allocate();
+
+       new_root->leaf = 0;
+       new_root->totalItems = 0;
+       new_root->children[0] = current.id;
+
+       // The new root is published only once the split has succeeded: a store that is out of pages must leave the old root in place.
+       try {
+
+           split_child(new_root, 0, current);
+
+       } catch (...) {
+
+           auto new_root_id = new_root.id;
+
+           new_root.release();
+           store.free(new_root_id);
+           throw;
+       }
+
+       store.set_root(new_root.id);
+
+       current = std::move(new_root);
+   }
+
+   for (;;) {
+
+       auto i = current->lower_bound(key);
+
+       if (i < current->totalItems && !(key < current->keys[i])) return false;
+
+       if (current->isLeaf()) {
+
+           btree_nodes::open_gap(*current.node, i);
+
+           current->keys[i] = key;
+           current->values[i] = value;
+           current.dirty = true;
+
+           store.set_size(store.size() + 1);
+           return true;
+       }
+
+       auto child = pin_child_for_write(current, i);
+
+       if (child->isFull()) {
+
+           auto sibling = split_child(current, i, child);
+
+           if (!(key < current->keys[i]) && !(current->keys[i] < key)) return false; // key was the child's middle key
+
+           if (current->keys[i] < key) child = std::move(sibling);
+       }
+
+       current = std::move(child);
+   }
+}
+
+/*
+ * Top-down removal. Before descending into a child that has only min_keys keys, the child is given another key, either by rotating one
+ * through the parent from an adjacent sibling with more than min_keys keys or, if both siblings are minimal, by fusing the child, a parent key
+ * and a sibling into one node (convert2Node()'s make3Node() and make4Node() cases). A key in an internal node is replaced by its predecessor or
+ * successor from a child that can spare a key, or else the two children around it are fused and the key is removed from the fused node.
+ *
+ * As in insert(), a read-only search first rules out an absent key. The path to the key is then pinned for write, but a sibling is pinned for
+ * write only if a rotation or fusion changes it; a sibling that is only looked at, or fused into the child and freed, is pinned read-only.
+ */
+template<typename Key, typename Value, std::size_t PageSize, template<typename> class Store> bool paged_tree234<Key, Value, PageSize, Store>::remove(const Key& key_in)
+{
+   if (!find(key_in)) return false;
+
+   Key key = key_in;
+   bool removed = false;
+
+   page_id root_id = store.root();
+   {
+      auto current = pin_for_write(root_id);
+
+      store.set_root(root_id);
+
+      for (;;) {
+
+          auto i = current->lower_bound(key);
+          auto n = current->totalItems;
+
+          if (i < n && !(key < current->keys[i])) { // key is in current
+
+              if (current->isLeaf()) {
+
+                  btree_nodes::close_gap(*current.node, i);
+
+                  current.dirty = true;
+                  removed = true;
+                  break;
+              }
+
+              auto left = pin_child_for_write(current, i);
+
+              if (!left->isMinimal()) { // replace key by its predecessor, and remove the predecessor from the left subtree
+
+                  auto [k, v] = subtree_max(left.id);
+
+                  current->keys[i] = k;
+                  current->values[i] = v;
+                  current.dirty = true;
+
+                  key = k;
+                  current = std::move(left);
+                  continue;
+              }
+
+              auto right = pin(current->children[i + 1]);
+
+              if (!right->isMinimal()) { // replace key by its successor, and remove the successor from the right subtree
+
+                  right = pin_child_for_write(current, i + 1);
+
+                  auto [k, v] = subtree_min(right.id);
+
+                  current->keys[i] = k;
+                  current->values[i] = v;
+                  current.dirty = true;
+
+                  key = k;
+                  current = std::move(right);
+                  continue;
+              }
+
+              merge_children(current, i, left, right); // key moves down into the fused node
+
+              current = std::move(left);
+              continue;
+          }
+
+          if (current->isLeaf()) break; // not found
+
+          auto child = pin_child_for_write(current, i);
+
+          if (child->isMinimal()) {
+
+              pinned left, right;
+
+              if (i > 0) left = pin(current->children[i - 1]);
+
+              if (i > 0 && !left->isMinimal()) { // rotate right: parent key i - 1 moves down, left's largest key moves up
+
+                  left = pin_child_for_write(current, i - 1);
+
+                  btree_nodes::rotate_right(*current.node, i, *child.node, *left.node);
+
+                  child.dirty = left.dirty = current.dirty = true;
+
+              } else {
+
+                  if (i < n) right = pin(current->children[i + 1]);
+
+                  if (i < n && !right->isMinimal()) { // rotate left: parent key i moves down, right's smallest key moves up
+
+                      right = pin_child_for_write(current, i + 1);
+
+                      btree_nodes::rotate_left(*current.node, i, *child.node, *right.node);
+
+                      child.dirty = right.dirty = current.dirty = true;
+
+                  } else if (i < n) {
+
+                      merge_children(current, i, child, right);
+
+                  } else {
+
+                      left = pin_child_for_write(current, i - 1);
+
+                      merge_children(current, i - 1, left, child);
+                      child = std::move(left);
+                  }
+              }
+          }
+
+          current = std::move(child);
+      }
+   }
+
+   // A fusion of the root's last key with its two children leaves the root empty: its only child becomes the root.
+   root_id = store.root();
+
+   auto root = pin(root_id);
+
+   if (root->totalItems == 0) {
+
+       page_id new_root = root->isLeaf() ? null_page : root->children[0];
+
+       root.release();
+       store.free(root_id);
+       store.set_root(new_root);
+   }
+
+   if (removed) store.set_size(store.size() - 1);
+
+   return removed;
+}
+
+/*
+ * The node is unpinned while each child subtree is traversed and pinned again afterwards, so a traversal holds one pin at a time however tall
+ * the tree is.
+ */
+template<typename Key, typename Value, std::size_t PageSize, template<typename> class Store> template<typename F> void paged_tree234<Key, Value, PageSize, Store>::for_each(page_id id, F& f) const
+{
+   for (auto i = 0; ; ++i) {
+
+       page_id child;
+       {
+          auto current = pin(id);
+
+          if (current->isLeaf()) {
+
+              for (auto j = 0; j < current->totalItems; ++j) f(current->keys[j], current->values[j]);
+              return;
+          }
+
+          if (i > current->totalItems) return;
+
+          if (i > 0) f(current->keys[i - 1], current->values[i - 1]);
+
+          child = current->children[i];
+       }
+
+       for_each(child, f);
+   }
+}
+#endif
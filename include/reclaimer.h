@@ -0,0 +1,121 @@
+#ifndef reclaimer_h_8237461
+#define reclaimer_h_8237461
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+/*
+ * A process-wide background thread that runs deferred clean-up work, used by tree234 to free the nodes of a tree off the caller's thread.
+ *
+ * retire() queues the work and returns at once. If the reclaimer has already been shut down--which can happen when a static tree is destroyed
+ * after the reclaimer during program exit--retire() returns false and the caller must do the work itself. The reclaimer's destructor finishes
+ * all queued work before it joins its thread.
+ */
+class background_reclaimer {
+
+      std::mutex mutex;
+      std::condition_variable work_available;
+      std::condition_variable idle;
+
+      std::deque<std::function<void()>> queue;
+      bool busy;
+      bool done;
+
+      std::thread thread;
+
+      inline static std::atomic<bool> stopped{false};
+
+      background_reclaimer() : busy{false}, done{false}, thread{&background_reclaimer::run, this} {}
+
+      void run()
+      {
+         std::unique_lock<std::mutex> lock{mutex};
+
+         for (;;) {
+
+            work_available.wait(lock, [this] { return done || !queue.empty(); });
+
+            if (queue.empty()) return; // done and drained
+
+            auto work = std::move(queue.front());
+            queue.pop_front();
+
+            busy = true;
+            lock.unlock();
+
+            work();
+            work = nullptr;
+
+            lock.lock();
+            busy = false;
+
+            if (queue.empty()) idle.notify_all();
+         }
+      }
+
+   public:
+
+      background_reclaimer(const background_reclaimer&) = delete;
+      background_reclaimer& operator=(const background_reclaimer&) = delete;
+
+     ~background_reclaimer()
+      {
+         {
+            std::lock_guard<std::mutex> lock{mutex};
+            done = true;
+         }
+         work_available.notify_one();
+
+         thread.join();
+
+         stopped.store(true);
+      }
+
+      static background_reclaimer& instance()
+      {
+         static background_reclaimer reclaimer;
+         return reclaimer;
+      }
+
+      // Queues work. Returns false, without queuing it, if the work could not be handed off.
+      static bool retire(std::function<void()>&& work) noexcept
+      {
+         if (stopped.load()) return false;
+
+         try {
+
+            auto& reclaimer = instance();
+            {
+               std::lock_guard<std::mutex> lock{reclaimer.mutex};
+
+               if (reclaimer.done) return false;
+
+               reclaimer.queue.push_back(std::move(work));
+            }
+            reclaimer.work_available.notify_one();
+
+            return true;
+
+         } catch (...) {
+
+            return false;
+         }
+      }
+
+      // Blocks until all work queued so far has finished.
+      static void flush()
+      {
+         if (stopped.load()) return;
+
+         auto& reclaimer = instance();
+
+         std::unique_lock<std::mutex> lock{reclaimer.mutex};
+
+         reclaimer.idle.wait(lock, [&] { return reclaimer.queue.empty() && !reclaimer.busy; });
+      }
+};
+#endif
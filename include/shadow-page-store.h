@@ -0,0 +1,435 @@
+#ifndef shadow_page_store_h_4470912
+#define shadow_page_store_h_4470912
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "paged-tree234.h"
+
+/*
+ * A copy-on-write page store for paged_tree234 that never overwrites a live page (shadow paging, as in LMDB). Commits are atomic and
+ * crash-safe without a log.
+ *
+ * The file is mmap'ed read-only. A write transaction starts implicitly with the first change after a commit. pin_for_write() gives a committed
+ * page a new id and copies it into a private buffer, so an insert() or remove() rewrites the root-to-leaf paths it touches into new pages and
+ * leaves the committed tree untouched. commit() writes the new pages, fsyncs, then writes the meta page and fsyncs again. The two meta pages,
+ * 0 and 1, alternate: the one with the higher transaction number and a valid checksum is the committed state, so a crash at any point leaves
+ * either the old or the new tree. abort() drops the transaction.
+ *
+ * Readers take a snapshot, a paged_tree234 whose store is a shadow_snapshot. A snapshot keeps the root of the commit it was taken at and reads
+ * the mapping directly, so readers on other threads never wait for the writer. Pages a commit replaces are reused only once no snapshot older
+ * than that commit remains. There is one writer, and the file is used by one process at a time.
+ *
+ * Freed pages are not recorded in the file: opening a file walks the committed tree and treats every page it does not reach as free.
+ */
+template<typename Node> class shadow_snapshot;
+
+template<typename Node> class shadow_page_store {
+
+   public:
+
+      using node_type = Node;
+
+      static constexpr std::size_t page_size = Node::page_size;
+
+   private:
+
+      friend class shadow_snapshot<Node>;
+
+      struct alignas(64) page_buffer {
+         std::byte bytes[page_size];
+      };
+
+      struct meta_page {
+         std::uint32_t magic;
+         std::uint32_t page_size;
+         std::uint32_t node_size;
+         std::uint32_t reserved;
+         std::uint64_t txn;
+         std::uint64_t root;
+         std::uint64_t size;
+         std::uint64_t page_count;
+         std::uint64_t checksum;
+      };
+
+      static constexpr std::uint32_t meta_magic = 0x57534854; // "THSW"
+      static constexpr page_id first_node_page = 2;
+
+      int fd;
+      const std::byte *map;
+      std::size_t map_size;
+
+      meta_page committed; // guarded by mutex once readers exist
+      meta_page current;   // the write transaction's root, size and page count
+
+      std::unordered_map<page_id, std::unique_ptr<page_buffer>> dirty; // pages written by the current transaction
+      std::vector<page_id> free_pages;     // reusable now
+      std::vector<page_id> txn_free;       // pages allocated and freed again by the current transaction
+      std::vector<page_id> reused;         // pages the current transaction took from free_pages
+      std::vector<page_id> retired;        // committed pages the current transaction replaced or freed
+      std::map<std::uint64_t, std::vector<page_id>> pending; // pages retired by commit txn, reusable once no snapshot predates txn
+
+      mutable std::mutex mutex;
+      mutable std::multiset<std::uint64_t> readers; // txn of each live snapshot
+
+      static std::uint64_t checksum(const meta_page& meta) noexcept // FNV-1a over everything before the checksum
+      {
+         auto p = reinterpret_cast<const unsigned char *>(&meta);
+         std::uint64_t hash = 14695981039346656037ull;
+
+         for (std::size_t i = 0; i < offsetof(meta_page, checksum); ++i) {
+
+             hash ^= p[i];
+             hash *= 1099511628211ull;
+         }
+         return hash;
+      }
+
+      static void fail(const std::string& what)
+      {
+         throw std::system_error(errno, std::generic_category(), "shadow_page_store: " + what);
+      }
+
+      void write_page(page_id id, const void *data)
+      {
+         if (::pwrite(fd, data, page_size, static_cast<off_t>(id * page_size)) != static_cast<ssize_t>(page_size)) fail("write");
+      }
+
+      node_type *mapped(page_id id) const noexcept
+      {
+         return const_cast<node_type *>(reinterpret_cast<const node_type *>(map + id * page_size));
+      }
+
+      page_id new_page_id()
+      {
+         if (!txn_free.empty()) {
+
+             auto id = txn_free.back();
+             txn_free.pop_back();
+             return id;
+         }
+
+         if (free_pages.empty()) reclaim();
+
+         if (!free_pages.empty()) {
+
+             auto id = free_pages.back();
+             free_pages.pop_back();
+             reused.push_back(id);
+             return id;
+         }
+
+         if ((current.page_count + 1) * page_size > map_size) throw std::runtime_error("shadow_page_store: the file has outgrown map_size");
+
+         return current.page_count++;
+      }
+
+      // Makes the pages of commits that no live snapshot predates reusable.
+      void reclaim()
+      {
+         std::uint64_t oldest;
+         {
+            std::lock_guard<std::mutex> lock{mutex};
+
+            oldest = readers.empty() ? committed.txn : *readers.begin();
+         }
+
+         for (auto iter = pending.begin(); iter != pending.end() && iter->first <= oldest; iter = pending.erase(iter))
+             free_pages.insert(free_pages.end(), iter->second.begin(), iter->second.end());
+      }
+
+      void mark_reachable(page_id id, std::vector<bool>& reachable) const
+      {
+         reachable[id] = true;
+
+         const node_type *pnode = mapped(id);
+
+         if (!pnode->isLeaf())
+             for (auto i = 0; i <= pnode->totalItems; ++i) mark_reachable(pnode->children[i], reachable);
+      }
+
+      void open_map()
+      {
+         void *addr = ::mmap(nullptr, map_size, PROT_READ, MAP_SHARED, fd, 0);
+
+         if (addr == MAP_FAILED) fail("mmap");
+
+         map = static_cast<const std::byte *>(addr);
+      }
+
+   public:
+
+      // map_size is the address space reserved for the file, and so its maximum size.
+      explicit shadow_page_store(const std::string& path, std::size_t map_size_in = std::size_t(1) << 32) : map{nullptr}, map_size{map_size_in}
+      {
+         fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+
+         if (fd < 0) fail("open " + path);
+
+         struct stat st;
+
+         if (::fstat(fd, &st) != 0) {
+
+             ::close(fd);
+             fail("stat " + path);
+         }
+
+         if (st.st_size == 0) {
+
+             committed = meta_page{meta_magic, static_cast<std::uint32_t>(page_size), sizeof(node_type), 0, 0, null_page, 0, first_node_page, 0};
+             committed.checksum = checksum(committed);
+
+             std::array<std::byte, page_size> page{};
+
+             std::memcpy(page.data(), &committed, sizeof(committed));
+
+             write_page(0, page.data());
+             write_page(1, page.data());
+
+             if (::fsync(fd) != 0) fail("fsync " + path);
+
+         } else {
+
+             std::array<meta_page, 2> metas{};
+             bool found = false;
+
+             for (auto i = 0; i < 2; ++i) {
+
+                 auto& meta = metas[i];
+
+                 if (::pread(fd, &meta, sizeof(meta), static_cast<off_t>(i * page_size)) != sizeof(meta) || meta.magic != meta_magic ||
+                     meta.page_size != page_size || meta.node_size != sizeof(node_type) || meta.checksum != checksum(meta)) continue;
+
+                 if (!found || meta.txn > committed.txn) committed = meta;
+
+                 found = true;
+             }
+
+             if (!found) {
+
+                 ::close(fd);
+                 throw std::runtime_error("shadow_page_store: " + path + " has no valid meta page");
+             }
+         }
+
+         open_map();
+
+         current = committed;
+
+         if (committed.root != null_page) {
+
+             std::vector<bool> reachable(committed.page_count, false);
+
+             mark_reachable(committed.root, reachable);
+
+             for (page_id id = committed.page_count; id-- > first_node_page; )
+                 if (!reachable[id]) free_pages.push_back(id);
+         } else {
+
+             for (page_id id = committed.page_count; id-- > first_node_page; ) free_pages.push_back(id);
+         }
+      }
+
+      shadow_page_store(const shadow_page_store&) = delete;
+      shadow_page_store& operator=(const shadow_page_store&) = delete;
+
+     ~shadow_page_store()
+      {
+         ::munmap(const_cast<std::byte *>(map), map_size);
+         ::close(fd);
+      }
+
+      // Uncommitted changes are lost unless commit() is called.
+
+      node_type *pin(page_id id)
+      {
+         if (auto iter = dirty.find(id); iter != dirty.end()) return reinterpret_cast<node_type *>(iter->second->bytes);
+
+         return mapped(id);
+      }
+
+      node_type *pin_for_write(page_id& id)
+      {
+         if (auto iter = dirty.find(id); iter != dirty.end()) return reinterpret_cast<node_type *>(iter->second->bytes);
+
+         auto copy = std::make_unique<page_buffer>();
+
+         std::memcpy(copy->bytes, map + id * page_size, page_size);
+
+         retired.push_back(id);
+
+         id = new_page_id();
+
+         auto pnode = reinterpret_cast<node_type *>(copy->bytes);
+
+         dirty[id] = std::move(copy);
+
+         return pnode;
+      }
+
+      void unpin(page_id, bool) noexcept {}
+
+      std::pair<page_id, node_type *> allocate()
+      {
+         auto id = new_page_id();
+
+         auto page = std::make_unique<page_buffer>(); // value-initialized: zeroed
+
+         auto pnode = reinterpret_cast<node_type *>(page->bytes);
+
+         dirty[id] = std::move(page);
+
+         return {id, pnode};
+      }
+
+      void free(page_id id)
+      {
+         if (dirty.erase(id)) txn_free.push_back(id);
+         else retired.push_back(id);
+      }
+
+      page_id root() const noexcept { return current.root; }
+
+      void set_root(page_id id) noexcept { current.root = id; }
+
+      std::uint64_t size() const noexcept { return current.size; }
+
+      void set_size(std::uint64_t n) noexcept { current.size = n; }
+
+      std::uint64_t page_count() const noexcept { return current.page_count; }
+
+      // Number of the last commit.
+      std::uint64_t txn() const noexcept { return committed.txn; }
+
+      bool in_transaction() const noexcept { return !dirty.empty() || !retired.empty(); }
+
+      void commit();
+
+      void abort() noexcept
+      {
+         dirty.clear();
+         txn_free.clear();
+         retired.clear();
+
+         free_pages.insert(free_pages.end(), reused.begin(), reused.end());
+         reused.clear();
+
+         current = committed;
+      }
+};
+
+template<typename Node> void shadow_page_store<Node>::commit()
+{
+   if (!in_transaction()) return;
+
+   std::vector<page_id> ids;
+
+   for (auto& entry : dirty) ids.push_back(entry.first);
+
+   std::sort(ids.begin(), ids.end());
+
+   for (auto id : ids) write_page(id, dirty[id]->bytes);
+
+   if (::fdatasync(fd) != 0) fail("fsync");
+
+   meta_page meta = current;
+
+   meta.txn = committed.txn + 1;
+   meta.checksum = checksum(meta);
+
+   std::array<std::byte, page_size> page{};
+
+   std::memcpy(page.data(), &meta, sizeof(meta));
+
+   write_page(meta.txn % 2, page.data());
+
+   if (::fdatasync(fd) != 0) fail("fsync");
+
+   {
+      std::lock_guard<std::mutex> lock{mutex};
+
+      committed = meta;
+   }
+
+   current = meta;
+
+   if (!retired.empty()) pending[meta.txn] = std::move(retired);
+
+   free_pages.insert(free_pages.end(), txn_free.begin(), txn_free.end());
+
+   dirty.clear();
+   txn_free.clear();
+   reused.clear();
+   retired.clear();
+}
+
+/*
+ * A read-only page store over the commit of a shadow_page_store that was current when it was constructed. A paged_tree234 built on one,
+ *
+ *    paged_tree234<Key, Value, PageSize, shadow_snapshot> reader{writer.get_store()};
+ *
+ * can find() and traverse that commit while the writer goes on changing and committing the tree. The snapshot must not outlive the store.
+ */
+template<typename Node> class shadow_snapshot {
+
+      using store_type = shadow_page_store<Node>;
+
+      const store_type& store;
+      std::uint64_t txn;
+      page_id root_id;
+      std::uint64_t count;
+
+   public:
+
+      using node_type = Node;
+
+      explicit shadow_snapshot(const store_type& store_in) : store{store_in}
+      {
+         std::lock_guard<std::mutex> lock{store.mutex};
+
+         txn = store.committed.txn;
+         root_id = store.committed.root;
+         count = store.committed.size;
+
+         store.readers.insert(txn);
+      }
+
+      shadow_snapshot(const shadow_snapshot&) = delete;
+      shadow_snapshot& operator=(const shadow_snapshot&) = delete;
+
+     ~shadow_snapshot()
+      {
+         std::lock_guard<std::mutex> lock{store.mutex};
+
+         store.readers.erase(store.readers.find(txn));
+      }
+
+      node_type *pin(page_id id) const noexcept { return store.mapped(id); }
+
+      void unpin(page_id, bool) const noexcept {}
+
+      page_id root() const noexcept { return root_id; }
+
+      std::uint64_t size() const noexcept { return count; }
+
+      // Number of the commit the snapshot reads.
+      std::uint64_t snapshot_txn() const noexcept { return txn; }
+};
+#endif
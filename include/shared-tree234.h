@@ -0,0 +1,280 @@
+#ifndef shared_tree234_h_3391847
+#define shared_tree234_h_3391847
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "paged-tree234.h"
+
+enum class shm_mode { create, open };
+
+/*
+ * A page store for paged_tree234 that keeps every page in a POSIX shared-memory segment, so processes that map the segment share one tree.
+ * Pages are addressed by their page number within the segment rather than by pointer, so each process may map the segment at a different
+ * address. The segment starts with a header holding the root, the key count, the free page list and a process-shared read-write lock;
+ * shared_tree234 takes that lock around every operation.
+ *
+ * The segment has a fixed number of pages, chosen by the process that creates it; allocate() throws std::bad_alloc when they are used up, and
+ * the insert() that needed the page fails with the tree still valid. The creating process must finish constructing the store before others
+ * open it.
+ */
+template<typename Node> class shm_page_store {
+
+   public:
+
+      using node_type = Node;
+
+      static constexpr std::size_t page_size = Node::page_size;
+
+   private:
+
+      struct segment_header {
+         std::atomic<std::uint32_t> magic; // set last by the creator
+         std::uint32_t page_size;
+         std::uint32_t node_size;
+         std::uint32_t reserved;
+         std::uint64_t capacity;   // pages in the segment
+         std::uint64_t first_page; // first node page, after the header
+         std::uint64_t root;
+         std::uint64_t size;
+         std::uint64_t page_count; // pages handed out so far
+         std::uint64_t free_head;  // freed pages, linked through their first bytes
+         pthread_rwlock_t lock;
+      };
+
+      static constexpr std::uint32_t segment_magic = 0x4d485354; // "TSHM"
+      static constexpr std::uint64_t header_pages = (sizeof(segment_header) + page_size - 1) / page_size;
+
+      std::byte *base;
+      std::size_t length;
+      segment_header *header;
+
+      static void fail(const std::string& what)
+      {
+         throw std::system_error(errno, std::generic_category(), "shm_page_store: " + what);
+      }
+
+      void map(int fd, std::size_t bytes, const std::string& name)
+      {
+         void *addr = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+         auto error = errno;
+
+         ::close(fd);
+
+         if (addr == MAP_FAILED) throw std::system_error(error, std::generic_category(), "shm_page_store: mmap " + name);
+
+         base = static_cast<std::byte *>(addr);
+         length = bytes;
+         header = reinterpret_cast<segment_header *>(base);
+      }
+
+   public:
+
+      // name is a POSIX shared-memory object name such as "/tree". pages, the segment's capacity, is needed only to create one.
+      shm_page_store(const std::string& name, shm_mode mode, std::size_t pages = 0);
+
+      shm_page_store(const shm_page_store&) = delete;
+      shm_page_store& operator=(const shm_page_store&) = delete;
+
+     ~shm_page_store() { ::munmap(base, length); }
+
+      // Removes the segment's name. Processes that have it mapped keep using it.
+      static void unlink(const std::string& name) noexcept { ::shm_unlink(name.c_str()); }
+
+      node_type *pin(page_id id) const noexcept { return reinterpret_cast<node_type *>(base + id * page_size); }
+
+      node_type *pin_for_write(page_id& id) const noexcept { return pin(id); }
+
+      void unpin(page_id, bool) const noexcept {}
+
+      std::pair<page_id, node_type *> allocate()
+      {
+         page_id id;
+
+         if (header->free_head != null_page) {
+
+             id = header->free_head;
+             std::memcpy(&header->free_head, pin(id), sizeof(page_id));
+
+         } else {
+
+             if (header->page_count == header->capacity) throw std::bad_alloc();
+
+             id = header->page_count++;
+         }
+
+         node_type *pnode = pin(id);
+
+         std::memset(static_cast<void *>(pnode), 0, page_size);
+
+         return {id, pnode};
+      }
+
+      void free(page_id id) noexcept
+      {
+         std::memcpy(pin(id), &header->free_head, sizeof(page_id));
+         header->free_head = id;
+      }
+
+      page_id root() const noexcept { return header->root; }
+
+      void set_root(page_id id) noexcept { header->root = id; }
+
+      std::uint64_t size() const noexcept { return header->size; }
+
+      void set_size(std::uint64_t n) noexcept { header->size = n; }
+
+      std::uint64_t capacity() const noexcept { return header->capacity - header->first_page; }
+
+      pthread_rwlock_t *rwlock() const noexcept { return &header->lock; }
+};
+
+template<typename Node> shm_page_store<Node>::shm_page_store(const std::string& name, shm_mode mode, std::size_t pages) : base{nullptr}, length{0}, header{nullptr}
+{
+   if (mode == shm_mode::create) {
+
+       int fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+
+       if (fd < 0) fail("create " + name);
+
+       auto total = header_pages + std::max<std::size_t>(pages, 1);
+
+       if (::ftruncate(fd, static_cast<off_t>(total * page_size)) != 0) {
+
+           auto error = errno;
+           ::close(fd);
+           ::shm_unlink(name.c_str());
+           throw std::system_error(error, std::generic_category(), "shm_page_store: ftruncate " + name);
+       }
+
+       map(fd, total * page_size, name);
+
+       header->page_size = page_size;
+       header->node_size = sizeof(node_type);
+       header->capacity = total;
+       header->first_page = header_pages;
+       header->root = null_page;
+       header->size = 0;
+       header->page_count = header_pages;
+       header->free_head = null_page;
+
+       pthread_rwlockattr_t attr;
+
+       pthread_rwlockattr_init(&attr);
+       pthread_rwlockattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+       pthread_rwlock_init(&header->lock, &attr);
+       pthread_rwlockattr_destroy(&attr);
+
+       header->magic.store(segment_magic, std::memory_order_release);
+       return;
+   }
+
+   int fd = ::shm_open(name.c_str(), O_RDWR, 0600);
+
+   if (fd < 0) fail("open " + name);
+
+   struct stat st;
+
+   if (::fstat(fd, &st) != 0) {
+
+       auto error = errno;
+       ::close(fd);
+       throw std::system_error(error, std::generic_category(), "shm_page_store: stat " + name);
+   }
+
+   if (static_cast<std::size_t>(st.st_size) < header_pages * page_size) {
+
+       ::close(fd);
+       throw std::runtime_error("shm_page_store: " + name + " is not a tree segment");
+   }
+
+   map(fd, st.st_size, name);
+
+   if (header->magic.load(std::memory_order_acquire) != segment_magic || header->page_size != page_size || header->node_size != sizeof(node_type) ||
+       header->capacity * page_size != length) {
+
+       ::munmap(base, length);
+       throw std::runtime_error("shm_page_store: " + name + " is not a tree segment of this type");
+   }
+}
+
+/*
+ * A paged_tree234 in shared memory. One process creates the segment and any number open it; each may find(), insert() and remove(). Every
+ * operation holds the segment's process-shared lock, shared for reads and exclusive for writes, and read() and write() hold it around a
+ * sequence of operations, e.g. an in-order traversal:
+ *
+ *    tree.read([](const auto& t) { t.inOrderTraverse([](const Key& key, const Value& value) { ... }); });
+ *
+ * A process that dies holding the lock leaves it held.
+ */
+template<typename Key, typename Value, std::size_t PageSize = 4096> class shared_tree234 {
+
+   public:
+
+      using tree_type = paged_tree234<Key, Value, PageSize, shm_page_store>;
+
+   private:
+
+      tree_type tree;
+
+      class read_lock {
+            pthread_rwlock_t *lock;
+         public:
+            explicit read_lock(pthread_rwlock_t *lock_in) noexcept : lock{lock_in} { pthread_rwlock_rdlock(lock); }
+           ~read_lock() { pthread_rwlock_unlock(lock); }
+      };
+
+      class write_lock {
+            pthread_rwlock_t *lock;
+         public:
+            explicit write_lock(pthread_rwlock_t *lock_in) noexcept : lock{lock_in} { pthread_rwlock_wrlock(lock); }
+           ~write_lock() { pthread_rwlock_unlock(lock); }
+      };
+
+   public:
+
+      shared_tree234(const std::string& name, shm_mode mode, std::size_t pages = 0) : tree{name, mode, pages} {}
+
+      // Calls f(const tree_type&) under the shared lock and returns its result.
+      template<typename F> decltype(auto) read(F f) const
+      {
+         read_lock lock{tree.get_store().rwlock()};
+
+         return f(tree);
+      }
+
+      // Calls f(tree_type&) under the exclusive lock and returns its result.
+      template<typename F> decltype(auto) write(F f)
+      {
+         write_lock lock{tree.get_store().rwlock()};
+
+         return f(tree);
+      }
+
+      bool find(const Key& key) const { return read([&](const tree_type& t) { return t.find(key); }); }
+
+      std::optional<Value> get(const Key& key) const { return read([&](const tree_type& t) { return t.get(key); }); }
+
+      bool insert(const Key& key, const Value& value) { return write([&](tree_type& t) { return t.insert(key, value); }); }
+
+      bool remove(const Key& key) { return write([&](tree_type& t) { return t.remove(key); }); }
+
+      std::uint64_t size() const { return read([](const tree_type& t) { return t.size(); }); }
+
+      static void unlink(const std::string& name) noexcept { shm_page_store<typename tree_type::node_type>::unlink(name); }
+};
+#endif
@@ -5,7 +5,7 @@
 #include <vector>
 #include <utility>
 
-template<class Key, class Value> class tree234; // Fwd ref.
+template<class Key, class Value, class Stats, class Prefetch> class tree234; // Fwd ref.
 
 template<class  Key, class Value> void test_insert(std::vector<std::pair<Key, Value>>& vec_pairs)
 {
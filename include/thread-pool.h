@@ -0,0 +1,231 @@
+#ifndef thread_pool_h_2398472
+#define thread_pool_h_2398472
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * A small work-stealing thread pool used by the parallel tree234 algorithms.
+ *
+ * Each worker owns a deque of tasks. A worker pushes the tasks it spawns onto the front of its own deque and pops them from the front (LIFO, so it
+ * keeps working on the subtree it just split), while idle workers steal from the back of the other deques (FIFO, so they take the largest,
+ * oldest pieces of work). Threads that are not workers of the pool share queue 0.
+ *
+ * A pool constructed with n threads starts n - 1 workers: the thread that calls task_group::wait() executes pending tasks, too, so n threads in
+ * total take part in the computation. A pool of size 1 therefore runs everything on the calling thread.
+ */
+class work_stealing_pool {
+
+      struct task_queue {
+         std::mutex mutex;
+         std::deque<std::function<void()>> tasks;
+      };
+
+      std::vector<std::unique_ptr<task_queue>> queues; // queues[0] is shared by non-worker threads; queues[i] belongs to worker i.
+      std::vector<std::thread> workers;
+
+      std::atomic<bool> done;
+      std::atomic<int>  pending; // number of tasks queued but not yet started.
+
+      std::mutex sleep_mutex;
+      std::condition_variable wake;
+
+      inline static thread_local work_stealing_pool *current_pool = nullptr;
+      inline static thread_local unsigned current_index = 0;
+
+      unsigned my_queue() const noexcept
+      {
+         return current_pool == this ? current_index : 0;
+      }
+
+      bool pop(unsigned index, std::function<void()>& task, bool from_front)
+      {
+         auto& q = *queues[index];
+
+         std::lock_guard<std::mutex> lock{q.mutex};
+
+         if (q.tasks.empty()) return false;
+
+         if (from_front) {
+
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+
+         } else {
+
+            task = std::move(q.tasks.back());
+            q.tasks.pop_back();
+         }
+
+         --pending;
+         return true;
+      }
+
+      void worker_loop(unsigned index)
+      {
+         current_pool = this;
+         current_index = index;
+
+         while (!done.load(std::memory_order_acquire)) {
+
+            if (run_pending_task()) continue;
+
+            std::unique_lock<std::mutex> lock{sleep_mutex};
+
+            wake.wait(lock, [this] { return pending.load() > 0 || done.load(); });
+         }
+      }
+
+   public:
+
+      explicit work_stealing_pool(unsigned threads = std::thread::hardware_concurrency()) : done{false}, pending{0}
+      {
+         if (threads == 0) threads = 1;
+
+         for (unsigned i = 0; i < threads; ++i)
+            queues.push_back(std::make_unique<task_queue>());
+
+         for (unsigned i = 1; i < threads; ++i)
+            workers.emplace_back(&work_stealing_pool::worker_loop, this, i);
+      }
+
+      work_stealing_pool(const work_stealing_pool&) = delete;
+      work_stealing_pool& operator=(const work_stealing_pool&) = delete;
+
+     ~work_stealing_pool()
+      {
+         {
+            std::lock_guard<std::mutex> lock{sleep_mutex};
+            done.store(true, std::memory_order_release);
+         }
+
+         wake.notify_all();
+
+         for (auto& thread : workers)
+            thread.join();
+      }
+
+      // Number of threads, including the waiting caller, that execute tasks.
+      unsigned size() const noexcept { return static_cast<unsigned>(queues.size()); }
+
+      void submit(std::function<void()> task)
+      {
+         auto index = my_queue();
+         {
+            std::lock_guard<std::mutex> lock{queues[index]->mutex};
+
+            queues[index]->tasks.push_front(std::move(task));
+         }
+         {
+            std::lock_guard<std::mutex> lock{sleep_mutex};
+            ++pending;
+         }
+         wake.notify_one();
+      }
+
+      /*
+       * Runs one pending task: first from the caller's own queue, then by stealing from the back of the other queues.
+       * Returns false if there was nothing to run.
+       */
+      bool run_pending_task()
+      {
+         if (pending.load(std::memory_order_relaxed) == 0) return false;
+
+         std::function<void()> task;
+
+         auto index = my_queue();
+
+         if (pop(index, task, true)) {
+
+             task();
+             return true;
+         }
+
+         for (unsigned i = 1; i <= size(); ++i) {
+
+             if (pop((index + i) % size(), task, false)) {
+
+                 task();
+                 return true;
+             }
+         }
+
+         return false;
+      }
+
+      // Process-wide pool sized to the hardware, used by the overloads that do not take a pool.
+      static work_stealing_pool& default_pool()
+      {
+         static work_stealing_pool pool;
+         return pool;
+      }
+};
+
+/*
+ * Fork-join helper: run() spawns a task on the pool; wait() executes pending tasks until every task spawned by this group has finished, and then
+ * rethrows the first exception, if any, thrown by one of them.
+ */
+class task_group {
+
+      work_stealing_pool& pool;
+
+      std::atomic<int> outstanding;
+
+      std::mutex error_mutex;
+      std::exception_ptr error;
+
+   public:
+
+      explicit task_group(work_stealing_pool& pool_in) noexcept : pool{pool_in}, outstanding{0} {}
+
+      task_group(const task_group&) = delete;
+
+     ~task_group()
+      {
+         while (outstanding.load() > 0)
+            if (!pool.run_pending_task()) std::this_thread::yield();
+      }
+
+      template<typename F> void run(F f)
+      {
+         ++outstanding;
+
+         pool.submit([this, f = std::move(f)]() mutable {
+
+            try {
+               f();
+
+            } catch (...) {
+
+               std::lock_guard<std::mutex> lock{error_mutex};
+
+               if (!error) error = std::current_exception();
+            }
+
+            --outstanding;
+         });
+      }
+
+      void wait()
+      {
+         while (outstanding.load() > 0) {
+
+            if (!pool.run_pending_task()) std::this_thread::yield();
+         }
+
+         if (error) {
+
+            auto e = error;
+            error = nullptr;
+            std::rethrow_exception(e);
+         }
+      }
+};
+#endif
@@ -0,0 +1,246 @@
+#ifndef traced_tree234_h_4402918
+#define traced_tree234_h_4402918
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "tree234.h"
+#include "byte-io.h"
+
+/*
+ * Operation traces: a compact binary log of the operations applied to a tree, for replaying a production workload offline (see
+ * bench/trace-replay.cpp). A trace is a trace_header followed by records
+ *
+ *    uint8    trace_op
+ *    varint   nanoseconds since the previous record
+ *    key      the key (the first key of a scan)
+ *    key      scans only: the end of the scanned range [first, last)
+ *
+ * An integral key is written as a varint, zigzag-encoded if signed, so small keys take a byte or two; any other Key is copied with memcpy and
+ * must be trivially copyable. Values are not recorded; a replay inserts a value of its own choosing.
+ */
+enum class trace_op : std::uint8_t { find = 1, insert = 2, remove = 3, scan = 4, load = 5 };
+
+struct trace_header {
+   std::uint32_t magic;
+   std::uint32_t version;
+   std::uint32_t key_size;
+   std::uint32_t key_kind; // 0: unsigned integer, 1: signed integer, 2: other
+};
+
+inline constexpr std::uint32_t trace_magic = 0x43525454; // "TTRC"
+inline constexpr std::uint32_t trace_version = 1;
+
+template<typename Key> struct trace_record {
+   trace_op op;
+   std::uint64_t delta_ns;
+   Key key;
+   Key last; // scans only
+};
+
+template<typename Key> constexpr std::uint32_t trace_key_kind() noexcept
+{
+   if constexpr (std::is_integral_v<Key>) return std::is_signed_v<Key> ? 1 : 0;
+   else return 2;
+}
+
+template<typename Sink, typename Key> void put_trace_key(Sink& sink, const Key& key)
+{
+   if constexpr (std::is_integral_v<Key> && std::is_signed_v<Key>) {
+
+       auto value = static_cast<std::int64_t>(key);
+       put_varint(sink, (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63));
+
+   } else if constexpr (std::is_integral_v<Key>) {
+
+       put_varint(sink, static_cast<std::uint64_t>(key));
+
+   } else {
+
+       sink.put(key);
+   }
+}
+
+template<typename Key, typename Source> Key get_trace_key(Source& source)
+{
+   if constexpr (std::is_integral_v<Key> && std::is_signed_v<Key>) {
+
+       auto bits = get_varint(source);
+       return static_cast<Key>(static_cast<std::int64_t>(bits >> 1) ^ -static_cast<std::int64_t>(bits & 1));
+
+   } else if constexpr (std::is_integral_v<Key>) {
+
+       return static_cast<Key>(get_varint(source));
+
+   } else {
+
+       return source.template get<Key>();
+   }
+}
+
+// Appends records to a trace file. The records are buffered; they reach the file when the buffer fills, on flush() and on destruction.
+template<typename Key> class trace_writer {
+
+      static_assert(std::is_trivially_copyable_v<Key>, "traces require a trivially copyable Key");
+
+      std::ofstream ofstr;
+      stream_sink sink;
+      std::chrono::steady_clock::time_point previous;
+
+   public:
+
+      explicit trace_writer(const std::string& path) : ofstr{path, std::ios::binary | std::ios::trunc}, sink{ofstr}, previous{std::chrono::steady_clock::now()}
+      {
+         if (!ofstr) throw std::runtime_error("trace_writer: cannot create " + path);
+
+         sink.put(trace_header{trace_magic, trace_version, sizeof(Key), trace_key_kind<Key>()});
+      }
+
+      void record(trace_op op, const Key& key)
+      {
+         auto now = std::chrono::steady_clock::now();
+
+         sink.put(op);
+         put_varint(sink, static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - previous).count()));
+         put_trace_key(sink, key);
+
+         previous = now;
+      }
+
+      void record(trace_op op, const Key& first, const Key& last)
+      {
+         record(op, first);
+         put_trace_key(sink, last);
+      }
+
+      void flush()
+      {
+         sink.flush();
+         ofstr.flush();
+      }
+};
+
+/*
+ * Reads a whole trace. A record cut short, as by a crash of the recording process, ends the trace. Throws std::runtime_error if the file is
+ * not a trace of this Key.
+ */
+template<typename Key> std::vector<trace_record<Key>> read_trace(const std::string& path)
+{
+   std::ifstream ifstr{path, std::ios::binary};
+
+   if (!ifstr) throw std::runtime_error("read_trace: cannot open " + path);
+
+   std::vector<char> bytes{std::istreambuf_iterator<char>(ifstr), std::istreambuf_iterator<char>()};
+
+   span_source source{bytes};
+
+   auto header = source.get<trace_header>();
+
+   if (header.magic != trace_magic || header.version != trace_version || header.key_size != sizeof(Key) || header.key_kind != trace_key_kind<Key>())
+       throw std::runtime_error("read_trace: " + path + " is not a trace of this key type");
+
+   std::vector<trace_record<Key>> records;
+
+   while (source.consumed() < bytes.size()) {
+
+       trace_record<Key> record{};
+
+       try {
+
+          record.op = source.get<trace_op>();
+          record.delta_ns = get_varint(source);
+          record.key = get_trace_key<Key>(source);
+
+          if (record.op == trace_op::scan) record.last = get_trace_key<Key>(source);
+
+       } catch (const std::runtime_error&) {
+
+          break; // a record cut short
+       }
+
+       if (record.op < trace_op::find || record.op > trace_op::load) throw std::runtime_error("read_trace: bad record in " + path);
+
+       records.push_back(record);
+   }
+
+   return records;
+}
+
+/*
+ * A tree234 whose find(), insert(), remove() and scan() calls can be recorded to a trace. start_trace() first writes a load record for every
+ * key already in the tree, so that replaying the trace into an empty container recreates the tree's contents before the timed operations
+ * begin. While no trace is being recorded, each call costs one test of a null pointer beyond the tree234 call itself.
+ *
+ * Like tree234, the class is not thread-safe.
+ */
+template<typename Key, typename Value> class traced_tree234 {
+
+      tree234<Key, Value> tree;
+
+      std::unique_ptr<trace_writer<Key>> writer;
+
+   public:
+
+      traced_tree234() = default;
+
+      explicit traced_tree234(tree234<Key, Value> tree_in) : tree{std::move(tree_in)} {}
+
+      void start_trace(const std::string& path)
+      {
+         auto new_writer = std::make_unique<trace_writer<Key>>(path);
+
+         tree.inOrderTraverse([&](const auto& pair) { new_writer->record(trace_op::load, pair.first); });
+
+         writer = std::move(new_writer);
+      }
+
+      // Flushes and closes the trace.
+      void stop_trace()
+      {
+         if (writer) writer->flush();
+
+         writer.reset();
+      }
+
+      bool tracing() const noexcept { return writer != nullptr; }
+
+      bool find(const Key& key) const
+      {
+         if (writer) writer->record(trace_op::find, key);
+
+         return tree.find(key);
+      }
+
+      void insert(const Key& key, const Value& value)
+      {
+         if (writer) writer->record(trace_op::insert, key);
+
+         tree.insert(key, value);
+      }
+
+      bool remove(const Key& key)
+      {
+         if (writer) writer->record(trace_op::remove, key);
+
+         return tree.remove(key);
+      }
+
+      // Calls f(const value_type&) on the pairs with keys in [first, last); see tree234::rangeTraverse().
+      template<typename Functor> void scan(const Key& first, const Key& last, Functor f) const
+      {
+         if (writer) writer->record(trace_op::scan, first, last);
+
+         tree.rangeTraverse(first, last, f);
+      }
+
+      int size() const noexcept { return tree.size(); }
+
+      const tree234<Key, Value>& get_tree() const noexcept { return tree; }
+};
+#endif
@@ -0,0 +1,43 @@
+#ifndef tree234_prefetch_h_3309518
+#define tree234_prefetch_h_3309518
+
+#include <cstddef>
+
+/*
+ * Prefetch policies, tree234's fourth template parameter. tree234 calls
+ *
+ *    node(pnode, sizeof(Node))    for each node it expects to read soon
+ *
+ * find(), insert() and remove() call it for every child of a node they enter, so the child they pick is already being loaded while they
+ * compare the node's keys. In-order and range traversals also call it for the children of each node they enter. An iterator increment calls
+ * it for the root of the subtree the cursor will enter after leaving its node: the child right of its key in an internal node, or the next
+ * sibling of a leaf it has just entered.
+ *
+ * no_prefetch, the default, ignores them, so a tree234<Key, Value> compiles to the same code as it would without the hooks. prefetch_nodes
+ * turns each call into a __builtin_prefetch of every cache line of the node. A descent still waits for each node in turn: the hint only
+ * overlaps the load of the next node with the comparisons made in the current one, which take a few nanoseconds against a miss of about a
+ * hundred. bench/prefetch-lookup.cpp compares the two policies. On the machine it was written on, with trees of one to ten million keys,
+ * prefetch_nodes was within noise of no_prefetch for finds and iteration, usually 5-15% faster for inOrderTraverse() and rangeTraverse(),
+ * and 5-20% slower for inserts, whose splits touch nodes the hints did not ask for.
+ */
+struct no_prefetch {
+
+   static constexpr bool enabled = false;
+
+   static constexpr void node(const void *, std::size_t) noexcept {}
+};
+
+struct prefetch_nodes {
+
+   static constexpr bool enabled = true;
+
+   static void node(const void *pnode, std::size_t bytes) noexcept
+   {
+      auto p = static_cast<const char *>(pnode);
+
+      for (std::size_t offset = 0; offset < bytes; offset += 64) __builtin_prefetch(p + offset);
+
+      __builtin_prefetch(p + bytes - 1); // the last line, when pnode is not aligned to one
+   }
+};
+#endif
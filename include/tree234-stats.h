@@ -0,0 +1,251 @@
+#ifndef tree234_stats_h_5820137
+#define tree234_stats_h_5820137
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/*
+ * Counters kept by tree234 when its Stats policy is counting_stats. The first group counts the restructurings done by insert() and remove();
+ * root_make4Node is the special case of remove() in which a 2-node root absorbs its two 2-node children (Node::make4Node()). Each operation
+ * also records how many times it was called and the key comparisons it made and nodes it visited in total, so per-call averages are
+ * comparisons / count and nodes_visited / count.
+ */
+struct tree234_stats {
+
+   std::uint64_t split;
+   std::uint64_t convert2Node;
+   std::uint64_t make3Node;
+   std::uint64_t make4Node;
+   std::uint64_t leftRotation;
+   std::uint64_t rightRotation;
+   std::uint64_t root_make4Node;
+
+   struct operation {
+      std::uint64_t count;
+      std::uint64_t comparisons;
+      std::uint64_t nodes_visited;
+   };
+
+   operation find;
+   operation insert;
+   operation remove;
+   operation increment; // iterator and const_iterator operator++
+};
+
+/*
+ * Stats policies, tree234's third template parameter. tree234 calls
+ *
+ *    begin(&tree234_stats::insert)        at the start of find(), insert(), remove() and iterator increments
+ *    end(&tree234_stats::insert)          when that operation returns
+ *    count(&tree234_stats::split)         for each restructuring
+ *    compare() and visit()                for each key comparison and each node it descends into
+ *
+ * no_stats, the default, ignores them all, so a tree234<Key, Value> compiles to the same code as it would without the hooks and takes no
+ * space for them. counting_stats counts them, and latency_stats also times each operation. Their counters are not atomic, so a tree using
+ * either must not be read by several threads at once.
+ */
+struct no_stats {
+
+   static constexpr bool enabled = false;
+
+   constexpr void begin(tree234_stats::operation tree234_stats::*) noexcept {}
+   constexpr void end(tree234_stats::operation tree234_stats::*) noexcept {}
+   constexpr void count(std::uint64_t tree234_stats::*) noexcept {}
+   constexpr void compare() noexcept {}
+   constexpr void visit() noexcept {}
+
+   constexpr tree234_stats snapshot() const noexcept { return {}; }
+   constexpr void reset() noexcept {}
+};
+
+class counting_stats {
+
+      tree234_stats counters;
+      tree234_stats::operation *current;
+
+   public:
+
+      static constexpr bool enabled = true;
+
+      counting_stats() noexcept : counters{}, current{&counters.find} {}
+
+      // A copy starts with its own zeroed counters.
+      counting_stats(const counting_stats&) noexcept : counting_stats() {}
+      counting_stats& operator=(const counting_stats&) noexcept { return *this; }
+
+      void begin(tree234_stats::operation tree234_stats::*op) noexcept
+      {
+         current = &(counters.*op);
+         ++current->count;
+      }
+
+      void end(tree234_stats::operation tree234_stats::*) noexcept {}
+
+      void count(std::uint64_t tree234_stats::*event) noexcept { ++(counters.*event); }
+
+      void compare() noexcept { ++current->comparisons; }
+
+      void visit() noexcept { ++current->nodes_visited; }
+
+      tree234_stats snapshot() const noexcept { return counters; }
+
+      void reset() noexcept { counters = tree234_stats{}; }
+};
+
+// The processor's time-stamp counter where there is one (x86), and otherwise steady_clock's nanoseconds.
+inline std::uint64_t cycle_count() noexcept
+{
+#if defined(__x86_64__) || defined(__i386__)
+   return __rdtsc();
+#else
+   return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+/*
+ * An HDR-style histogram of 64-bit values. Values below 2 * sub_buckets are counted exactly; above that each power of two is split into
+ * sub_buckets equal buckets, so a percentile is reported to within 1/sub_buckets (about 3%) of the value recorded. record() is a few
+ * instructions and never allocates; the counts take about 15 KB.
+ */
+class latency_histogram {
+
+   public:
+
+      static constexpr int sub_bucket_bits = 5;
+      static constexpr std::uint64_t sub_buckets = 1 << sub_bucket_bits;
+
+   private:
+
+      std::vector<std::uint64_t> counts;
+      std::uint64_t total;
+      std::uint64_t max_value;
+
+      static std::size_t bucket(std::uint64_t value) noexcept
+      {
+         int shift = std::max(0, static_cast<int>(std::bit_width(value)) - (sub_bucket_bits + 1));
+
+         return shift * sub_buckets + (value >> shift);
+      }
+
+      // The largest value counted in bucket index.
+      static std::uint64_t highest_value(std::size_t index) noexcept
+      {
+         std::uint64_t shift = index < 2 * sub_buckets ? 0 : index / sub_buckets - 1;
+
+         return ((index - shift * sub_buckets + 1) << shift) - 1;
+      }
+
+   public:
+
+      latency_histogram() : counts((65 - sub_bucket_bits) * sub_buckets), total{0}, max_value{0} {}
+
+      void record(std::uint64_t value) noexcept
+      {
+         ++counts[bucket(value)];
+         ++total;
+         max_value = std::max(max_value, value);
+      }
+
+      std::uint64_t count() const noexcept { return total; }
+
+      std::uint64_t max() const noexcept { return max_value; }
+
+      // The value below which percent of the recorded values fall, e.g. percentile(99.9). 0 if nothing was recorded.
+      std::uint64_t percentile(double percent) const noexcept
+      {
+         if (total == 0) return 0;
+
+         auto rank = static_cast<std::uint64_t>(percent / 100.0 * total + 0.5);
+
+         rank = std::clamp<std::uint64_t>(rank, 1, total);
+
+         std::uint64_t seen = 0;
+
+         for (std::size_t i = 0; i < counts.size(); ++i) {
+
+             seen += counts[i];
+
+             if (seen >= rank) return std::min(highest_value(i), max_value);
+         }
+
+         return max_value;
+      }
+
+      // Adds other's values, e.g. to combine the histograms of several threads.
+      latency_histogram& operator+=(const latency_histogram& other) noexcept
+      {
+         for (std::size_t i = 0; i < counts.size(); ++i) counts[i] += other.counts[i];
+
+         total += other.total;
+         max_value = std::max(max_value, other.max_value);
+         return *this;
+      }
+
+      void reset() noexcept
+      {
+         std::fill(counts.begin(), counts.end(), 0);
+         total = max_value = 0;
+      }
+
+      friend std::ostream& operator<<(std::ostream& ostr, const latency_histogram& histogram)
+      {
+         return ostr << "count " << histogram.count() << ", p50 " << histogram.percentile(50) << ", p99 " << histogram.percentile(99)
+                     << ", p999 " << histogram.percentile(99.9) << ", max " << histogram.max();
+      }
+};
+
+/*
+ * counting_stats plus a latency histogram for each operation in tree234_stats, in cycle_count() ticks. Should operations nest, only the
+ * outermost is timed. Read the histograms through the tree's stats_policy(), e.g.
+ *
+ *    tree.stats_policy().latency(&tree234_stats::insert).percentile(99)
+ */
+class latency_stats : public counting_stats {
+
+      std::array<latency_histogram, 4> histograms;
+      std::uint64_t start;
+      int depth;
+
+      static std::size_t index(tree234_stats::operation tree234_stats::*op) noexcept
+      {
+         return op == &tree234_stats::find ? 0 : op == &tree234_stats::insert ? 1 : op == &tree234_stats::remove ? 2 : 3;
+      }
+
+   public:
+
+      latency_stats() : histograms{}, start{0}, depth{0} {}
+
+      // A copy starts with its own empty histograms.
+      latency_stats(const latency_stats&) : latency_stats() {}
+      latency_stats& operator=(const latency_stats&) noexcept { return *this; }
+
+      void begin(tree234_stats::operation tree234_stats::*op) noexcept
+      {
+         counting_stats::begin(op);
+
+         if (depth++ == 0) start = cycle_count();
+      }
+
+      void end(tree234_stats::operation tree234_stats::*op) noexcept
+      {
+         if (--depth == 0) histograms[index(op)].record(cycle_count() - start);
+      }
+
+      const latency_histogram& latency(tree234_stats::operation tree234_stats::*op) const noexcept { return histograms[index(op)]; }
+
+      void reset() noexcept
+      {
+         counting_stats::reset();
+
+         for (auto& histogram : histograms) histogram.reset();
+      }
+};
+#endif
@@ -14,12 +14,29 @@
 #include <iosfwd>
 #include <string>
 #include <iostream>
+#include <functional>
+#include <span>
+#include <vector>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <optional>
 #include "value-type.h" // This header was taken from clang's STL implementation. It works like a union for the two
                         // types std::pair<Key, Value> and std::pair<const Key, Value>.  
+#include "thread-pool.h"
+#include "reclaimer.h"
+#include "byte-io.h"
+#include "tree234-stats.h"
+#include "tree234-prefetch.h"
 
-template<typename Key, typename Value> class tree234;  // Forward declaration
+// Forward declaration. Stats: see tree234-stats.h; Prefetch: see tree234-prefetch.h
+template<typename Key, typename Value, typename Stats = no_stats, typename Prefetch = no_prefetch> class tree234;
+template<typename Key, typename Value> class mapped_tree234; // Read-only view of an on-disk image, in mapped-tree234.h
 
-template<typename Key, typename Value> class tree234 {
+template<typename Key, typename Value, typename Stats, typename Prefetch> class tree234 {
 
    public:
   
@@ -34,13 +51,16 @@ template<typename Key, typename Value> class tree234 {
 
  
    class Node; // Forward reference. 
+
+   struct memory_report_type; // Returned by memory_report()
    
    class Node { 
       /*
          Node depends on both of tree234's template parameters, Key and Value, so we make it a nested class.
       */
       private:  
-      friend class tree234<Key, Value>;             
+      friend class tree234<Key, Value, Stats, Prefetch>;             
+      friend class mapped_tree234<Key, Value>; // writes images from Nodes
       inline static const int MAX_KEYS;   
       
       enum class NodeType : int { two_node=1, three_node=2, four_node=3 };
@@ -68,7 +88,7 @@ template<typename Key, typename Value> class tree234 {
         1. {true, Node * pnode, int index}  -- if key is found. pnode->keys_values[index] == found_key
         2. {false, Node * pnode, int index} -- if key is not found. pnode and index set to the next to key in next prospective node to search one level down in the tree.
       */
-      std::tuple<bool, typename tree234<Key, Value>::Node *, int>  find(Key key) const noexcept;
+      std::tuple<bool, typename tree234<Key, Value, Stats, Prefetch>::Node *, int>  find(const Key& key) const noexcept;
       
       int insert(const Key& key, const Value& value) noexcept;
       
@@ -127,6 +147,8 @@ template<typename Key, typename Value> class tree234 {
          constexpr int getChildCount() const noexcept;
       
          constexpr const Node *getRightMostChild() const noexcept { return children[getTotalItems()].get(); }
+
+         constexpr const Node *getChild(int i) const noexcept { return children[i].get(); }
       
          // Helps in debugging
          void printKeys(std::ostream&);
@@ -135,6 +157,11 @@ template<typename Key, typename Value> class tree234 {
         {
            return keys_values[i].__get_value().first; //  'template<typename _Key, typename _Value> struct keys_values[i].__value_type' does not have members first and second.
         } 
+
+        constexpr const Value& value(int i) const noexcept 
+        {
+           return keys_values[i].__get_value().second;
+        } 
       
         int getIndexInParent() const;
       
@@ -199,21 +226,201 @@ template<typename Key, typename Value> class tree234 {
    
    private:
    
+   friend class mapped_tree234<Key, Value>;
+
    std::unique_ptr<Node>  root; 
    
    int tree_size; // adjusted by insert(), remove(), operator=(const tree234...), move ctor
+
+   bool deferred_destruction; // If true, release_nodes() hands nodes to the background_reclaimer instead of freeing them.
+
+   [[no_unique_address]] mutable Stats counters; // Hooks called by find(), insert() and remove(); empty unless Stats counts.
+
+   // Calls counters.begin(op) and, on every return path, counters.end(op).
+   class operation_scope {
+         Stats& counters;
+         tree234_stats::operation tree234_stats::*op;
+      public:
+         operation_scope(Stats& counters_in, tree234_stats::operation tree234_stats::*op_in) noexcept : counters{counters_in}, op{op_in} { counters.begin(op); }
+        ~operation_scope() { counters.end(op); }
+   };
+
+   // Key comparisons made by the search paths of find(), insert() and remove(), which counters counts.
+   bool less(const Key& lhs, const Key& rhs) const noexcept { counters.compare(); return lhs < rhs; }
+   bool equal(const Key& lhs, const Key& rhs) const noexcept { counters.compare(); return lhs == rhs; }
    
    // Implementations of the public depth-frist traversal methods    
    template<typename Functor> void DoInOrderTraverse(Functor f, const Node *proot) const noexcept;
+
+   /*
+    * The pruned in-order walk of rangeTraverse() and the range export_columns(): calls f, in key order, on each pair of pnode's subtree with a
+    * key in [first, last), skipping the children whose keys are all less than first. f returns false to end the walk early. Returns false
+    * once the walk has ended, by reaching a key not less than last or by f.
+    */
+   template<typename Functor> static bool DoRangeTraverse(Functor& f, const Key& first, const Key& last, const Node *pnode);
    
    template<typename Functor> void DoPostOrderTraverse(Functor f,  const Node *proot) const noexcept;
    
    template<typename Functor> void DoPreOrderTraverse(Functor f, const Node *proot) const noexcept;
+
+   // Implementations of parallel_for_each() and parallel_reduce(). Subtrees less than 'spawn_depth' levels below the root are forked as tasks.
+   template<typename Functor> void DoParallelForEach(Functor& f, const Node *pnode, int spawn_depth, task_group& group) const;
+
+   template<typename T, typename Accumulate, typename Combine> T DoParallelReduce(const T& identity, Accumulate& acc, Combine& combine, const Node *pnode, int spawn_depth, work_stealing_pool& pool) const;
+
+   static int parallel_spawn_depth(const work_stealing_pool& pool, int tree_height) noexcept;
+
+   // Implementations of export_columns(). They copy pairs in key order to keys and values, advancing both, until room is exhausted.
+   static void export_subtree(const Node *pnode, Key *& keys, Value *& values, std::size_t& room);
+
+   static std::size_t count_keys(const Node *pnode) noexcept;
+
+   // Appends, in key order, the subtrees 'depth' levels below pnode (or leaves above that depth) to subtrees and the keys between them to separators.
+   static void collect_subtrees(const Node *pnode, int depth, std::vector<const Node *>& subtrees, std::vector<const value_type *>& separators);
+
+   /*
+    * Linear-time bulk construction from keys in ascending order, used by insert_batch() on an empty tree. Every subtree of a given height
+    * gets a number of keys between the minimum (all 2-nodes) and maximum (all 4-nodes) for that height, and the keys are split evenly among
+    * the children, so all leaves end at the same depth.
+    */
+   static int bulk_height(std::size_t n) noexcept;
+   static int bulk_child_sizes(std::size_t n, int height, std::array<std::size_t, 4>& sizes) noexcept;
+
+   // Source is a callable whose successive calls return the keys/values in ascending order. 
+   template<typename Source> static std::unique_ptr<Node> build_subtree(Source& next, std::size_t n, int height);
+
+   // Subtrees less than spawn_depth levels below the root are built as independent tasks from their slice of items.
+   static std::unique_ptr<Node> build_subtree(std::pair<Key, Value> *items, std::size_t n, int height, int spawn_depth, work_stealing_pool& pool);
+
+   void build_from_sorted(std::vector<std::pair<Key, Value>>& items, work_stealing_pool& pool);
+
+   /*
+    * The partitioned descent of insert_batch() and remove_batch(). update_subtree() applies a sorted slice of the batch to a subtree: it splits
+    * the slice among the children by the node's keys, updates only the children that get part of it, in parallel while spawn_depth > 0, and
+    * then puts the node back together from what the children became. A subtree becomes a batch_run: either trees all of its own height (it
+    * split) or a single tree of any lower height (it shrank, or emptied to height 0). Where a shorter tree meets a neighbor of full height,
+    * join() grafts it onto the neighbor's facing edge, so splits and fusions happen only on the boundaries between updated children. The
+    * common case, children that only split, is handled in place: the node takes their keys and trees, splitting in two if it overflows.
+    */
+   struct batch_tree {
+      std::unique_ptr<Node> root;
+      int height = 0;        // 0 for an empty tree
+      bool attached = false; // root is still a child of the node being updated, so its parent pointer need not be rewritten
+   };
+
+   struct batch_run {
+      std::vector<batch_tree> trees;
+      std::vector<__value_type<Key, Value>> separators; // separators[i] lies between trees[i] and trees[i + 1]
+   };
+
+   // Slices of fewer items than this are updated on the calling thread.
+   static constexpr std::size_t batch_task_grain = 256;
+
+   /*
+    * Item is std::pair<Key, Value> to insert the slice, const Key to remove it. changed is increased by the number of keys inserted or removed.
+    * Returns an empty run if the subtree is still one tree of its height, left in subtree; otherwise subtree is left empty.
+    */
+   template<typename Item> static batch_run update_subtree(std::unique_ptr<Node>& subtree, int height, std::span<Item> slice, int spawn_depth, work_stealing_pool& pool, std::size_t& changed);
+
+   // Makes a run of trees of height at most height - 1 into trees of height height - 1, or into a single shorter tree.
+   static batch_run settle_run(batch_run& sequence, int height);
+
+   // Groups a run of at least two trees of height height - 1 into nodes of height height, reusing spare, if given, for the first.
+   static batch_run gather_run(batch_run& level, int height, std::unique_ptr<Node> spare);
+
+   // Joins lhs, separator and rhs into one tree, or two of the taller one's height if the graft splits its root.
+   static batch_run join(batch_tree lhs, __value_type<Key, Value>&& separator, batch_tree rhs);
+
+   using edge_split = std::optional<std::pair<__value_type<Key, Value>, std::unique_ptr<Node>>>;
+
+   // Graft separator and a shorter tree onto the right (left) edge of the subtree pnode of height height. If pnode splits, the key and new
+   // right (left) sibling for its parent are returned.
+   static edge_split join_right(Node *pnode, int height, __value_type<Key, Value>& separator, batch_tree& rhs);
+   static edge_split join_left(Node *pnode, int height, batch_tree& lhs, __value_type<Key, Value>& separator);
+
+   // Adds key and child as pnode's last (first) key and child, splitting pnode if it was a 4-node.
+   static edge_split append_edge(Node *pnode, __value_type<Key, Value>&& key, std::unique_ptr<Node> child);
+   static edge_split prepend_edge(Node *pnode, __value_type<Key, Value>&& key, std::unique_ptr<Node> child);
+
+   void plant(batch_run& run);
+
+   /*
+    * Binary snapshot format written by serialize(): a snapshot_header followed by the nodes in pre-order. Each node is one byte holding
+    * totalItems, then its totalItems keys and then its totalItems values, each copied with memcpy. Since all leaves are at depth 'height',
+    * the reader knows from the depth alone whether a node has children.
+    */
+   struct snapshot_header {
+      std::uint32_t magic;
+      std::uint32_t version;
+      std::uint32_t key_size;
+      std::uint32_t value_size;
+      std::uint64_t size;
+      std::uint64_t nodes;
+      std::uint32_t height;
+      std::uint32_t reserved;
+   };
+
+   static constexpr std::uint32_t snapshot_magic = 0x34333254; // "T234" 
+   static constexpr std::uint32_t snapshot_version = 1;
+
+   snapshot_header make_snapshot_header() const noexcept;
+   static void check_snapshot_header(const snapshot_header& header);
+
+   static std::uint64_t count_nodes(const Node *pnode) noexcept;
+
+   // Tallies pnode's subtree, which is 'level' levels below the root, into report. Called by memory_report().
+   static void tally_nodes(const Node *pnode, std::size_t level, memory_report_type& report);
+
+   template<typename Sink> static void serialize_subtree(Sink& sink, const Node *pnode);
+
+   template<typename Source> static std::unique_ptr<Node> deserialize_subtree(Source& source, int height, std::uint64_t& keys_read);
+
+   template<typename Source> void deserialize_nodes(Source& source, const snapshot_header& header);
+
+   /*
+    * Compressed format written by serialize_compressed(): a compressed_header followed by the pairs in key order, in blocks of compressed_block
+    * pairs (the last block may be shorter). Keys are mapped to unsigned integers that sort the same way. A block holds
+    *
+    *    varint   first key - (last key of the previous block + 1), or the first key itself in the first block
+    *    uint8    key_bits
+    *    packed   the block's other keys as (key - previous key - 1), key_bits bits each
+    *
+    * followed, for an integral Value, by a frame of reference
+    *
+    *    varint   smallest value in the block
+    *    uint8    value_bits
+    *    packed   each value - smallest value, value_bits bits each
+    *
+    * or, for any other Value, by the values' bytes. Dense keys thus cost a few bits each.
+    */
+   struct compressed_header {
+      std::uint32_t magic;
+      std::uint32_t version;
+      std::uint32_t key_size;
+      std::uint32_t value_size;
+      std::uint64_t size;
+      std::uint32_t block_size;
+      std::uint32_t value_encoding; // 0: raw bytes, 1: frame of reference
+   };
+
+   static constexpr std::uint32_t compressed_magic = 0x5a333254; // "T23Z"
+   static constexpr std::uint32_t compressed_version = 1;
+   static constexpr std::size_t compressed_block = 128;
+
+   // Maps an integer to an unsigned integer of the same order.
+   template<typename T> static std::uint64_t to_ordered(T value) noexcept;
+   template<typename T> static T from_ordered(std::uint64_t bits) noexcept;
+
+   template<typename Functor> static void visit_in_order(const Node *pnode, Functor& f);
+
+   template<typename Sink> void write_compressed(Sink& sink) const;
+
+   template<typename Source> void read_compressed(Source& source);
    
-   Node *split(Node *node, Key new_key) noexcept;  // called during insert(Key key) to split 4-nodes when encountered.
+   Node *split(Node *node, const Key& new_key) noexcept;  // called during insert(Key key) to split 4-nodes when encountered.
 
    // Called during remove(Key key)
-   bool remove(Node *location, Key key);     
+   bool remove(Node *location, const Key& key);     
    
    // Called during remove(Key key, Node *) to convert two-node to three- or four-node during descent of tree.
    int convert2Node(Node *node, int child_index) noexcept;
@@ -238,27 +445,65 @@ template<typename Key, typename Value> class tree234 {
    int  depth(const Node *pnode) const noexcept;
    bool isBalanced(const Node *pnode) const noexcept;
    
-   bool find(const Node *current, Key key) const noexcept; 
+   // Passes each child of pnode to the Prefetch policy (see tree234-prefetch.h), before a descent picks one of them.
+   static void prefetch_children(const Node *pnode) noexcept;
+
+   bool find(const Node *current, const Key& key) const noexcept; 
    
-   std::tuple<bool, Node *, int> find_insert_node(Node *pnode, Key new_key) noexcept;  // Called during insert
+   std::tuple<bool, Node *, int> find_insert_node(Node *pnode, const Key& new_key) noexcept;  // Called during insert
+
+   // key_copy is set, and delete_key replaced by it, when delete_key is stored in a node the removal would move it out of; see remove().
+   std::tuple<bool, typename tree234<Key, Value, Stats, Prefetch>::Node *, int>  find_delete_node(Node *pcurrent, const Key& delete_key, std::optional<Key>& key_copy, int child_index=0); 
 
-   std::tuple<bool, typename tree234<Key, Value>::Node *, int>  find_delete_node(Node *pcurrent, Key delete_key, int child_index=0) noexcept; 
+   // True if key is one of the keys stored in pnode, by address.
+   static bool node_stores(const Node *pnode, const Key& key) noexcept;
 
    Node *get_successor_node(Node *pnode, int child_index) noexcept; // Called during remove()
 
-   std::tuple<Node *, int, Node *> get_delete_successor(Node *pdelete, Key delete_key, int delete_key_index) noexcept;
+   std::tuple<Node *, int, Node *> get_delete_successor(Node *pdelete, const Key& delete_key, int delete_key_index) noexcept;
+
+  static void destroy_subtree(std::unique_ptr<Node>& current) noexcept;
+
+  // Levels in the subtree rooted at pnode, found along its leftmost path since all leaves are at the same depth.
+  static int subtree_height(const Node *pnode) noexcept;
 
-  void destroy_subtree(std::unique_ptr<Node>& current) noexcept;
+  // Frees the subtree without recursion, keeping the nodes still to be freed on a fixed stack.
+  static void destroy_subtree_iterative(std::unique_ptr<Node>& subtree) noexcept;
+
+  // Copies the subtree rooted at src without recursion, keeping the nodes still to be copied on a fixed stack. The copy's root has no parent.
+  static std::unique_ptr<Node> copy_subtree(const Node *src);
+
+  // Frees the subtree, or, if deferred_destruction is set, passes it to the background reclaimer. Leaves subtree nullptr.
+  void release_nodes(std::unique_ptr<Node>& subtree) noexcept;
+
+  // Called by the parallel copy constructor. Children less than spawn_depth levels below src are cloned as separate tasks.
+  static std::unique_ptr<Node> clone_subtree(const Node *src, int spawn_depth, work_stealing_pool& pool);
 
  public:
    
    using node_type = Node; 
+
+   // The root, for walking the nodes through Node's const accessors; nullptr if the tree is empty.
+   const Node *getRoot() const noexcept { return root.get(); }
    
    void debug() noexcept;  // As an aid in writting any future debug code.
  
-   explicit tree234() noexcept : root{}, tree_size{0} { } 
+   explicit tree234() noexcept : root{}, tree_size{0}, deferred_destruction{false} { } 
    
    tree234(const tree234& lhs) noexcept; 
+
+   /*
+    * The algorithms behind copying and freeing nodes. Node(const Node&) and destroy_subtree() recurse once per level; copy_subtree() and
+    * destroy_subtree_iterative() loop instead. bench/structure-bench.cpp compares them, and the copy constructor, copy assignment, clear() and
+    * ~tree234() use the faster of each pair, preorder and iterative.
+    */
+   enum class copy_algorithm { recursive, preorder };
+   enum class destroy_algorithm { recursive, iterative };
+
+   tree234(const tree234& lhs, copy_algorithm algorithm); 
+
+   // Parallel copy: the subtrees of lhs are cloned as independent tasks on pool.
+   tree234(const tree234& lhs, work_stealing_pool& pool); 
    tree234(tree234&& lhs) noexcept;     // move constructor
    
    tree234& operator=(const tree234& lhs) noexcept; 
@@ -270,29 +515,98 @@ template<typename Key, typename Value> class tree234 {
 
    ~tree234() //--= default; 
    {
-       destroy_subtree(root); // The default dtor is recursive
+       release_nodes(root); // Not the default dtor, which recurses: the nodes go to the reclaimer or are freed by destroy_subtree_iterative().
    }
+
+   // Removes all keys. Returns in O(1) if deferred destruction is enabled.
+   void clear() noexcept;
+
+   // Removes all keys, freeing the nodes on this thread with the given algorithm.
+   void clear(destroy_algorithm algorithm) noexcept;
+
+   /*
+    * When enabled, ~tree234(), operator=() and clear() detach the nodes they would free and hand them to a background reclaimer thread, so
+    * they return in constant time on the caller's thread. Keys and values are then destroyed on the reclaimer thread.
+    */
+   void set_deferred_destruction(bool on) noexcept { deferred_destruction = on; }
+
+   bool get_deferred_destruction() const noexcept { return deferred_destruction; }
    // Breadth-first traversal
    template<typename Functor> void levelOrderTraverse(Functor f) const noexcept;
    
    // Depth-first traversals
    template<typename Functor> void inOrderTraverse(Functor f) const noexcept;
+
+   // Calls f(const value_type&) in key order on the pairs whose keys are in [first, last), skipping subtrees outside the range.
+   template<typename Functor> void rangeTraverse(const Key& first, const Key& last, Functor f) const;
    
    template<typename Functor> void iterativeInOrderTraverse(Functor f) const noexcept;
    
    template<typename Functor> void postOrderTraverse(Functor f) const noexcept;
    template<typename Functor> void preOrderTraverse(Functor f) const noexcept;
+
+   /*
+    * Parallel traversals. The root's subtrees, and recursively their subtrees, are processed as tasks on a work-stealing pool. parallel_for_each()
+    * calls f(const value_type&) concurrently and in no particular order, so f must be thread-safe. parallel_reduce() folds each subtree with
+    * acc(T, const value_type&) and joins the partial results in key order with combine(T, T), so combine need only be associative; identity
+    * starts every partial result and must be an identity of combine.
+    */
+   template<typename Functor> void parallel_for_each(Functor f) const;
+   template<typename Functor> void parallel_for_each(Functor f, work_stealing_pool& pool) const;
+
+   template<typename T, typename Accumulate, typename Combine = std::plus<>> T parallel_reduce(T identity, Accumulate acc, Combine combine = Combine{}) const;
+   template<typename T, typename Accumulate, typename Combine> T parallel_reduce(T identity, Accumulate acc, Combine combine, work_stealing_pool& pool) const;
+
+   /*
+    * Columnar export: copies the keys and values, in key order, into separate arrays, keys[i] pairing with values[i], walking the nodes directly
+    * rather than through iterators. At most min(keys.size(), values.size()) pairs are written, and the number written is returned. The range
+    * version exports the keys in [first, last) and skips subtrees outside it.
+    *
+    * The parallel version needs room for size() pairs (it throws std::length_error otherwise). It splits the tree into the subtrees a few levels
+    * below the root, counts their keys as tasks to find where each subtree's pairs start, and then copies the subtrees as tasks.
+    */
+   std::size_t export_columns(std::span<Key> keys, std::span<Value> values) const;
+   std::size_t export_columns(const Key& first, const Key& last, std::span<Key> keys, std::span<Value> values) const;
+   std::size_t export_columns(std::span<Key> keys, std::span<Value> values, work_stealing_pool& pool) const;
    
    // Used during development and testing 
    template<typename Functor> void debug_dump(Functor f) noexcept;
    
-   bool find(Key key) const noexcept;
+   bool find(const Key& key) const noexcept;
+
+   /*
+    * Batch lookup: sets results[i] to the value of keys[i], or to nullptr if it is absent, for the first min(keys.size(), results.size()) keys,
+    * and returns the number found. Up to find_batch_width lookups are in flight at once, each advanced one node per turn: a turn compares the
+    * keys of the node it reached, prefetches the child it descends to and passes to the next lookup, so the misses of different lookups
+    * overlap instead of each descent waiting out its own. A finished lookup's slot takes the next key. The pointers are valid until the tree is
+    * next modified. The Stats policy counts the batch as one find.
+    */
+   static constexpr std::size_t find_batch_width = 16;
+
+   std::size_t find_batch(std::span<const Key> keys, std::span<const Value *> results) const;
    
    void insert(const Key& key, const Value &) noexcept; 
    
    void insert(const value_type& pair) noexcept { insert(pair.first, pair.second); } 
+
+   /*
+    * Batch insert and remove. The batch is sorted and de-duplicated (the first occurrence of a key wins), then applied in one descent: each node
+    * on the way splits its part of the batch among its children, so a node shared by many keys is visited once, and subtrees that get no keys
+    * are not visited at all. Disjoint subtrees near the root are updated in parallel on the pool. Splits and fusions are repaired on the way
+    * back up, only where an updated child changed shape. An empty tree is built from the batch in linear time. As with insert(), keys already
+    * in the tree keep their values. Both return the number of keys inserted or removed.
+    */
+   std::size_t insert_batch(std::span<const std::pair<Key, Value>> batch);
+   std::size_t insert_batch(std::span<const std::pair<Key, Value>> batch, work_stealing_pool& pool);
+
+   std::size_t remove_batch(std::span<const Key> keys);
+   std::size_t remove_batch(std::span<const Key> keys, work_stealing_pool& pool);
    
-   bool remove(Key key);
+   /*
+    * Keys are taken by reference, so no copy is made, except when key is itself stored in the tree, as in remove(iter->first): remove() then
+    * copies it before converting the 2-node it sits in, and insert() finds it present without splitting its node.
+    */
+   bool remove(const Key& key);
    
    void printlevelOrder(std::ostream&) const noexcept;
    
@@ -305,12 +619,96 @@ template<typename Key, typename Value> class tree234 {
    void printPostOrder(std::ostream&) const noexcept;
    
    bool isEmpty() const noexcept;
+
+   /*
+    * Shape-preserving binary snapshots (Key and Value must be trivially copyable). Loading rebuilds the exact nodes that were saved in one
+    * linear pass, with no searching or splitting. The buffer variant of serialize() appends to buffer; that of deserialize() returns the number
+    * of bytes consumed. deserialize() throws std::runtime_error on malformed input and leaves the tree unchanged.
+    */
+   void serialize(std::ostream& ostr) const;
+   void serialize(std::vector<char>& buffer) const;
+
+   void deserialize(std::istream& istr);
+   std::size_t deserialize(std::span<const char> buffer);
+
+   /*
+    * Compressed snapshots for integral Key (see compressed_header): delta-encoded, bit-packed keys and frame-of-reference values. Loading
+    * decodes a block at a time straight into the linear-time bulk builder, so the loaded tree has the bulk builder's shape rather than the
+    * saved one. The functions otherwise behave like serialize() and deserialize().
+    */
+   void serialize_compressed(std::ostream& ostr) const;
+   void serialize_compressed(std::vector<char>& buffer) const;
+
+   void deserialize_compressed(std::istream& istr);
+   std::size_t deserialize_compressed(std::span<const char> buffer);
    
    int  height() const noexcept;
    
    bool isBalanced() const noexcept;
-   
-   friend std::ostream& operator<<(std::ostream& ostr, const tree234<Key, Value>& tree)
+
+   /*
+    * Snapshot of the counters kept by the Stats policy (see tree234-stats.h): restructurings, and per operation the calls, key comparisons and
+    * nodes visited. With latency_stats, each operation is also timed. All zero with the default no_stats. A copied tree starts with zeroed counters.
+    */
+   tree234_stats stats() const noexcept { return counters.snapshot(); }
+
+   void reset_stats() noexcept { counters.reset(); }
+
+   // The Stats policy itself, for what stats() does not report, e.g. latency_stats' histograms.
+   const Stats& stats_policy() const noexcept { return counters; }
+
+   /*
+    * Memory footprint and node fill, gathered by memory_report() in one walk of the tree. node_bytes counts the Nodes themselves; memory that
+    * Key or Value own (a std::string's buffer, say) is not included. unused_bytes is the part of node_bytes held by empty keys_values and
+    * children slots, which grows as remove() leaves 2-nodes behind. levels[0] is the root's level.
+    *
+    * A tree of n keys has between min_height (all 4-nodes, about log4 n levels) and max_height (all 2-nodes, about log2 n levels) levels.
+    */
+   struct memory_report_type {
+
+      struct level_fill {
+         std::size_t two_nodes;
+         std::size_t three_nodes;
+         std::size_t four_nodes;
+      };
+
+      std::size_t size;
+      std::size_t nodes;
+      std::size_t leaves;
+      std::size_t internal_nodes;
+
+      std::size_t node_bytes;        // nodes * sizeof(Node)
+      std::size_t unused_bytes;
+      double bytes_per_entry;        // (node_bytes + sizeof(tree234)) / size
+      double fill;                   // size / (3 * nodes): 1/3 when all 2-nodes, 1 when all 4-nodes
+
+      int height;
+      int min_height;
+      int max_height;
+      double log2_size;
+
+      std::vector<level_fill> levels;
+
+      friend std::ostream& operator<<(std::ostream& ostr, const memory_report_type& report)
+      {
+         ostr << "size " << report.size << ", nodes " << report.nodes << " (" << report.leaves << " leaves, " << report.internal_nodes << " internal)\n"
+              << "node bytes " << report.node_bytes << ", unused " << report.unused_bytes << ", " << report.bytes_per_entry << " bytes/entry, fill " << report.fill << '\n'
+              << "height " << report.height << " (min " << report.min_height << ", max " << report.max_height << ", log2(size) " << report.log2_size << ")\n";
+
+         for (std::size_t level = 0; level < report.levels.size(); ++level) {
+
+             auto& fill = report.levels[level];
+
+             ostr << "level " << level << ": " << fill.two_nodes << " 2-nodes, " << fill.three_nodes << " 3-nodes, " << fill.four_nodes << " 4-nodes\n";
+         }
+
+         return ostr;
+      }
+   };
+
+   memory_report_type memory_report() const;
+
+   friend std::ostream& operator<<(std::ostream& ostr, const tree234<Key, Value, Stats, Prefetch>& tree)
    {
       tree.printlevelOrder(ostr);
       return ostr;
@@ -321,30 +719,37 @@ template<typename Key, typename Value> class tree234 {
 					       
       public:
       using difference_type  = std::ptrdiff_t; 
-      using value_type       = tree234<Key, Value>::value_type; 
+      using value_type       = tree234<Key, Value, Stats, Prefetch>::value_type; 
       using reference        = value_type&; 
       using pointer          = value_type*;
       
       using iterator_category = std::bidirectional_iterator_tag; 
 				          
-      friend class tree234<Key, Value>; 
+      friend class tree234<Key, Value, Stats, Prefetch>; 
       
       private:
-       tree234<Key, Value>& tree; 
+       tree234<Key, Value, Stats, Prefetch>& tree; 
       
        const Node *current;
        const Node *cursor; //  points to "current" node.
        int key_index;
 
-       std::stack<int> child_indexes; 
+       /*
+        * Child indexes along the path from the root to cursor. Since tree_size is an int, the tree is never more than 31 levels high, so a
+        * fixed array holds the path and iterators never allocate.
+        */
+       static constexpr int max_height = 32;
+
+       std::array<int, max_height> child_indexes{}; 
+       int stack_size = 0;
        
-       std::pair<const typename tree234<Key, Value>::Node *, int> findLeftChildAncestor() noexcept;
+       std::pair<const typename tree234<Key, Value, Stats, Prefetch>::Node *, int> findLeftChildAncestor() noexcept;
       
        iterator& increment() noexcept; 
       
        iterator& decrement() noexcept;
       
-       iterator(tree234<Key, Value>& lhs, int i);  // called by end()   
+       iterator(tree234<Key, Value, Stats, Prefetch>& lhs, int i);  // called by end()   
 
        std::pair<const Node *, int> getSuccessor(const Node *current, int key_index) noexcept;
        std::pair<const Node *, int> getPredecessor(const Node *current, int key_index) noexcept;
@@ -356,23 +761,23 @@ template<typename Key, typename Value> class tree234 {
        std::pair<const Node *, int> getLeafNodeSuccessor(const Node *pnode, int key_index);
        std::pair<const Node *, int> getLeafNodePredecessor(const Node *pnode, int key_index);
 
+       void prefetch_next_subtree() const noexcept; // see tree234-prefetch.h
+
        const Node *get_min() noexcept;
 
        const Node *get_max() noexcept;
 
-       void push(int child_index)
+       void push(int child_index) noexcept
        {
-           child_indexes.push(child_index);
+           child_indexes[stack_size++] = child_index;
        }
 
        int pop()
        {
-          if (child_indexes.empty()) {
+          if (stack_size == 0) {
               throw(std::logic_error("iterator popping empty stack"));
           }
-          auto i = child_indexes.top();
-          child_indexes.pop();
-          return i; 
+          return child_indexes[--stack_size];
        }
 
        constexpr reference dereference() const noexcept 
@@ -384,7 +789,7 @@ template<typename Key, typename Value> class tree234 {
    
       public:
 
-       explicit iterator(tree234<Key, Value>&); 
+       explicit iterator(tree234<Key, Value, Stats, Prefetch>&); 
 
        iterator(const iterator& lhs) = default; 
       
@@ -442,18 +847,18 @@ template<typename Key, typename Value> class tree234 {
 					    
       public:
       using difference_type   = std::ptrdiff_t; 
-      using value_type        = tree234<Key, Value>::value_type; 
-      using reference	      = const tree234<Key, Value>::value_type&; 
-      using pointer           = const tree234<Key, Value>::value_type*;
+      using value_type        = tree234<Key, Value, Stats, Prefetch>::value_type; 
+      using reference	      = const tree234<Key, Value, Stats, Prefetch>::value_type&; 
+      using pointer           = const tree234<Key, Value, Stats, Prefetch>::value_type*;
       
       using iterator_category = std::bidirectional_iterator_tag; 
 				          
-      friend class tree234<Key, Value>;   
+      friend class tree234<Key, Value, Stats, Prefetch>;   
       
       private:
        iterator iter; 
       
-       const_iterator(const tree234<Key, Value>& lhs, int i); // called by end()
+       const_iterator(const tree234<Key, Value, Stats, Prefetch>& lhs, int i); // called by end()
           
        reference dereference() const noexcept 
        { 
@@ -462,14 +867,14 @@ template<typename Key, typename Value> class tree234 {
        
       public:
        
-       explicit const_iterator(const tree234<Key, Value>& lhs);
+       explicit const_iterator(const tree234<Key, Value, Stats, Prefetch>& lhs);
       
        const_iterator(const const_iterator& lhs);
        
        const_iterator(const_iterator&& lhs); 
       
        // Provides the implicit conversion from iterator to const_iterator     
-       const_iterator(const typename tree234<Key, Value>::iterator& lhs); 
+       const_iterator(const typename tree234<Key, Value, Stats, Prefetch>::iterator& lhs); 
       
        bool operator==(const const_iterator& lhs) const;
        bool operator!=(const const_iterator& lhs) const;
@@ -532,7 +937,7 @@ template<typename Key, typename Value> class tree234 {
    const_reverse_iterator rend() const noexcept;    
 };
 
-template<class Key, class Value> inline bool tree234<Key, Value>::isEmpty() const noexcept
+template<class Key, class Value, class Stats, class Prefetch> inline bool tree234<Key, Value, Stats, Prefetch>::isEmpty() const noexcept
 {
    return !root ? true : false;
 }
@@ -541,17 +946,17 @@ template<class Key, class Value> inline bool tree234<Key, Value>::isEmpty() cons
 * Node constructors. Note: While all children are initialized to nullptr, this is not really necessary. 
 * Instead you can simply set children[0] = nullptr, since a Node is a leaf if and only if children[0] == nullptr.
 */
-template<typename Key, typename Value> inline  tree234<Key, Value>::Node::Node()  noexcept : parent{nullptr}, totalItems{0}
+template<typename Key, typename Value, typename Stats, typename Prefetch> inline  tree234<Key, Value, Stats, Prefetch>::Node::Node()  noexcept : parent{nullptr}, totalItems{0}
 {
  // Note: Default member construction used for keys_values and children 
 }
 
-template<typename Key, typename Value> inline  tree234<Key, Value>::Node::Node(__value_type<Key, Value>&& key_value) noexcept : totalItems{1},  parent{nullptr}
+template<typename Key, typename Value, typename Stats, typename Prefetch> inline  tree234<Key, Value, Stats, Prefetch>::Node::Node(__value_type<Key, Value>&& key_value) noexcept : totalItems{1},  parent{nullptr}
 {
    keys_values[0] = std::move(key_value); 
 }
 
-template<typename Key, typename Value> inline  tree234<Key, Value>::Node::Node(const Node& lhs)  noexcept : totalItems{lhs.totalItems},  keys_values{lhs.keys_values}
+template<typename Key, typename Value, typename Stats, typename Prefetch> inline  tree234<Key, Value, Stats, Prefetch>::Node::Node(const Node& lhs)  noexcept : totalItems{lhs.totalItems},  keys_values{lhs.keys_values}
 {
   if (!lhs.parent) // If lhs is the root, then set parent to nullptr.
       parent = nullptr;
@@ -572,7 +977,7 @@ template<typename Key, typename Value> inline  tree234<Key, Value>::Node::Node(c
   }
 }
 
-template<class Key, class Value> std::ostream& tree234<Key, Value>::Node::print(std::ostream& ostr) const noexcept
+template<class Key, class Value, class Stats, class Prefetch> std::ostream& tree234<Key, Value, Stats, Prefetch>::Node::print(std::ostream& ostr) const noexcept
 {
    ostr << "[";
    
@@ -601,7 +1006,7 @@ template<class Key, class Value> std::ostream& tree234<Key, Value>::Node::print(
    return ostr;
 }
 
-template<class Key, class Value> int tree234<Key, Value>::Node::getIndexInParent() const 
+template<class Key, class Value, class Stats, class Prefetch> int tree234<Key, Value, Stats, Prefetch>::Node::getIndexInParent() const 
 {
    for (int child_index = 0; child_index <= parent->getTotalItems(); ++child_index) { // Check the address of each of the children of the parent with the address of "this".
    
@@ -617,23 +1022,128 @@ template<class Key, class Value> int tree234<Key, Value>::Node::getIndexInParent
  * Does a post order tree traversal, using recursion and deleting nodes as they are visited.
  */
 
-template<typename Key, typename Value> inline tree234<Key, Value>::tree234(const tree234<Key, Value>& lhs) noexcept
+template<typename Key, typename Value, typename Stats, typename Prefetch> inline tree234<Key, Value, Stats, Prefetch>::tree234(const tree234<Key, Value, Stats, Prefetch>& lhs) noexcept : tree_size{lhs.tree_size}, deferred_destruction{lhs.deferred_destruction}
+{
+   if (lhs.root) 
+       root = copy_subtree(lhs.root.get()); 
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> tree234<Key, Value, Stats, Prefetch>::tree234(const tree234<Key, Value, Stats, Prefetch>& lhs, copy_algorithm algorithm) : tree_size{lhs.tree_size}, deferred_destruction{lhs.deferred_destruction}
+{
+   if (!lhs.root) return;
+
+   if (algorithm == copy_algorithm::recursive) {
+
+       // Node(const Node&) will copy the entire tree rooted at lhs.get(). 
+       root = std::make_unique<Node>(*lhs.root); 
+       root->parent = nullptr;
+
+   } else {
+
+       root = copy_subtree(lhs.root.get()); 
+   }
+}
+
+/*
+ * Each node popped from pending has already been copied; its children are copied and pushed, the rightmost first, so the left subtrees are
+ * copied first. A node pushes at most four children and pops itself, so the stack never holds more than three per level plus one.
+ */
+template<typename Key, typename Value, typename Stats, typename Prefetch> std::unique_ptr<typename tree234<Key, Value, Stats, Prefetch>::Node> tree234<Key, Value, Stats, Prefetch>::copy_subtree(const Node *src)
+{
+   constexpr int max_height = 32;
+
+   assert(subtree_height(src) <= max_height); // pending is sized for it
+
+   auto copy = std::make_unique<Node>();
+
+   copy->totalItems = src->totalItems;
+   copy->keys_values = src->keys_values;
+
+   std::array<std::pair<const Node *, Node *>, 3 * max_height + 1> pending;
+   int top = 0;
+
+   pending[top++] = {src, copy.get()};
+
+   while (top > 0) {
+
+       auto [from, to] = pending[--top];
+
+       if (from->isLeaf()) continue;
+
+       for (auto i = from->getChildCount() - 1; i >= 0; --i) {
+
+           const Node *child = from->children[i].get();
+
+           to->children[i] = std::make_unique<Node>();
+
+           Node *child_copy = to->children[i].get();
+
+           child_copy->totalItems = child->totalItems;
+           child_copy->keys_values = child->keys_values;
+           child_copy->parent = to;
+
+           pending[top++] = {child, child_copy};
+       }
+   }
+
+   return copy;
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> tree234<Key, Value, Stats, Prefetch>::tree234(const tree234<Key, Value, Stats, Prefetch>& lhs, work_stealing_pool& pool) : tree_size{lhs.tree_size}, deferred_destruction{lhs.deferred_destruction}
 {
-   // Node(const Node&) will copy the entire tree rooted at lhs.get(). 
+   if (lhs.root) {
 
-   root = std::make_unique<Node>(*lhs.root); 
-   tree_size = lhs.tree_size;
+       root = clone_subtree(lhs.root.get(), parallel_spawn_depth(pool, lhs.height()), pool);
+       root->parent = nullptr;
+   }
 }
 
+/*
+ * Copies src's keys and totalItems into a new Node. Its children are cloned as independent tasks while spawn_depth is positive; below that,
+ * copy_subtree() copies each subtree on the task's own thread. The caller sets the returned Node's parent.
+ */
+template<typename Key, typename Value, typename Stats, typename Prefetch> std::unique_ptr<typename tree234<Key, Value, Stats, Prefetch>::Node> tree234<Key, Value, Stats, Prefetch>::clone_subtree(const Node *src, int spawn_depth, work_stealing_pool& pool)
+{
+   auto node = std::make_unique<Node>();
+
+   node->totalItems = src->totalItems;
+   node->keys_values = src->keys_values;
+
+   if (src->isLeaf()) return node;
+
+   if (spawn_depth <= 0) {
+
+       for (auto i = 0; i < src->getChildCount(); ++i) 
+            node->children[i] = copy_subtree(src->children[i].get());
+
+   } else {
+
+       task_group group{pool};
+
+       for (auto i = 0; i < src->getChildCount(); ++i) {
+
+           const Node *child = src->children[i].get();
+
+           group.run([&node, child, i, spawn_depth, &pool] { node->children[i] = clone_subtree(child, spawn_depth - 1, pool); });
+       }
+
+       group.wait();
+   }
+
+   for (auto i = 0; i < src->getChildCount(); ++i) 
+        node->children[i]->parent = node.get();
+
+   return node;
+}
 
 // Node(Node&&) will copy the entire tree rooted at lhs.get(). 
-template<typename Key, typename Value> inline tree234<Key, Value>::tree234(tree234&& lhs) noexcept : root{std::move(lhs.root)}, tree_size{lhs.tree_size}  
+template<typename Key, typename Value, typename Stats, typename Prefetch> inline tree234<Key, Value, Stats, Prefetch>::tree234(tree234&& lhs) noexcept : root{std::move(lhs.root)}, tree_size{lhs.tree_size}, deferred_destruction{lhs.deferred_destruction}  
 {
-    root->parent = nullptr;
+    if (root) root->parent = nullptr;
     lhs.tree_size = 0;
 }
 
-template<typename Key, typename Value> inline tree234<Key, Value>::tree234(std::initializer_list<std::pair<Key, Value>> il) noexcept : root(nullptr), tree_size{0} 
+template<typename Key, typename Value, typename Stats, typename Prefetch> inline tree234<Key, Value, Stats, Prefetch>::tree234(std::initializer_list<std::pair<Key, Value>> il) noexcept : root(nullptr), tree_size{0}, deferred_destruction{false} 
 {
     for (auto&& [key, value]: il) { 
    
@@ -659,7 +1169,7 @@ Requires:
 *     If the last key has already been visited, the pointer returned will be nullptr.
 *
 */
-template<class Key, class Value> std::pair<const typename tree234<Key, Value>::Node *, int> tree234<Key, Value>::iterator::getSuccessor(const Node *current, int key_index) noexcept
+template<class Key, class Value, class Stats, class Prefetch> std::pair<const typename tree234<Key, Value, Stats, Prefetch>::Node *, int> tree234<Key, Value, Stats, Prefetch>::iterator::getSuccessor(const Node *current, int key_index) noexcept
 {
   if (current->isLeaf()) { // If leaf node
 
@@ -691,7 +1201,7 @@ template<class Key, class Value> std::pair<const typename tree234<Key, Value>::N
    Requires: pnode is an internal node not a leaf node.
    Returns:  pointer to successor of internal node.
  */
-template<class Key, class Value> std::pair<const typename tree234<Key, Value>::Node *, int> tree234<Key, Value>::iterator::getInternalNodeSuccessor(const typename tree234<Key, Value>::Node *pnode, int key_index) noexcept	    
+template<class Key, class Value, class Stats, class Prefetch> std::pair<const typename tree234<Key, Value, Stats, Prefetch>::Node *, int> tree234<Key, Value, Stats, Prefetch>::iterator::getInternalNodeSuccessor(const typename tree234<Key, Value, Stats, Prefetch>::Node *pnode, int key_index) noexcept	    
 {
  auto child_index = key_index + 1;
 
@@ -711,7 +1221,7 @@ template<class Key, class Value> std::pair<const typename tree234<Key, Value>::N
 /*
  Requires: pnode is a leaf node other than the root.
  */
-template<class Key, class Value> std::pair<const typename tree234<Key, Value>::Node *, int> tree234<Key, Value>::iterator::getLeafNodeSuccessor(const Node *pnode, int key_index) 
+template<class Key, class Value, class Stats, class Prefetch> std::pair<const typename tree234<Key, Value, Stats, Prefetch>::Node *, int> tree234<Key, Value, Stats, Prefetch>::iterator::getLeafNodeSuccessor(const Node *pnode, int key_index) 
 {
  const auto& root = tree.root;
 
@@ -799,7 +1309,7 @@ template<class Key, class Value> std::pair<const typename tree234<Key, Value>::N
   }  
 }
 
-template<class Key, class Value> std::pair<const typename tree234<Key, Value>::Node *, int> tree234<Key, Value>::iterator::getPredecessor(const typename  tree234<Key, Value>::Node *current, int key_index) noexcept
+template<class Key, class Value, class Stats, class Prefetch> std::pair<const typename tree234<Key, Value, Stats, Prefetch>::Node *, int> tree234<Key, Value, Stats, Prefetch>::iterator::getPredecessor(const typename  tree234<Key, Value, Stats, Prefetch>::Node *current, int key_index) noexcept
 {
  const auto& root = tree.root;
 
@@ -824,8 +1334,8 @@ template<class Key, class Value> std::pair<const typename tree234<Key, Value>::N
   }
 }
 
-template<class Key, class Value> std::pair<const typename tree234<Key, Value>::Node *, int> tree234<Key, Value>::iterator::getInternalNodePredecessor(\
-     const typename tree234<Key, Value>::Node *pnode, int key_index) noexcept	    
+template<class Key, class Value, class Stats, class Prefetch> std::pair<const typename tree234<Key, Value, Stats, Prefetch>::Node *, int> tree234<Key, Value, Stats, Prefetch>::iterator::getInternalNodePredecessor(\
+     const typename tree234<Key, Value, Stats, Prefetch>::Node *pnode, int key_index) noexcept	    
 {
  auto child_index = key_index;
 
@@ -849,7 +1359,7 @@ Finding the predecessor of a given node
   If you get to the root w/o finding a node that is a right child, there is no predecessor
 */
 
-template<class Key, class Value> std::pair<const typename tree234<Key, Value>::Node *, int> tree234<Key, Value>::iterator::getLeafNodePredecessor(const Node *pnode, int index)
+template<class Key, class Value, class Stats, class Prefetch> std::pair<const typename tree234<Key, Value, Stats, Prefetch>::Node *, int> tree234<Key, Value, Stats, Prefetch>::iterator::getLeafNodePredecessor(const Node *pnode, int index)
 {
   // Handle trivial case: if the leaf node is not a 2-node (it is a 3-node or 4-node, and key_index is not the first key), simply set index of predecessor to index - 1. 
   if (!pnode->isTwoNode() && index != 0) {
@@ -927,159 +1437,1640 @@ template<class Key, class Value> std::pair<const typename tree234<Key, Value>::N
          pnode = parent;
      }
 
-     // The predecessor will be the first key, starting with the right most key, that is less than current_key. 
-     return {parent, child_index - 1}; 
+     // The predecessor will be the first key, starting with the right most key, that is less than current_key. 
+     return {parent, child_index - 1}; 
+
+  } // end else
+}
+
+// copy assignment
+template<typename Key, typename Value, typename Stats, typename Prefetch> inline tree234<Key, Value, Stats, Prefetch>& tree234<Key, Value, Stats, Prefetch>::operator=(const tree234& lhs) noexcept 
+{
+  if (this == &lhs)  {
+      
+      return *this;
+  }
+  
+  release_nodes(root); // free all the nodes of the current tree 
+
+  tree_size = lhs.tree_size;
+
+  if (lhs.root) 
+      root = copy_subtree(lhs.root.get()); 
+
+  return *this;
+}
+
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> inline void tree234<Key, Value, Stats, Prefetch>::Node::printKeys(std::ostream& ostr)
+{
+  ostr << "["; 
+
+  for(auto i = 0; i < getTotalItems(); ++i) {
+
+      ostr << keys_values[i].__get_value().first;
+
+      if (i < get_lastkey_index()) { //getTotalItems() - 1)       {
+
+         ostr << ", ";
+      } 
+  }
+
+  ostr << "]";
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> inline constexpr int tree234<Key, Value, Stats, Prefetch>::Node::getTotalItems() const noexcept
+{
+   return totalItems; 
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> inline constexpr int tree234<Key, Value, Stats, Prefetch>::Node::getChildCount() const noexcept
+{
+   return totalItems + 1; 
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> inline constexpr bool tree234<Key, Value, Stats, Prefetch>::Node::isTwoNode() const noexcept
+{
+   return (totalItems == static_cast<int>(NodeType::two_node)) ? true : false;
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> inline constexpr bool tree234<Key, Value, Stats, Prefetch>::Node::isThreeNode() const noexcept
+{
+   return (totalItems == static_cast<int>(NodeType::three_node)) ? true : false;
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> inline constexpr bool tree234<Key, Value, Stats, Prefetch>::Node::isFourNode() const noexcept
+{
+   return (totalItems == static_cast<int>(NodeType::four_node)) ? true : false;
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> inline constexpr bool tree234<Key, Value, Stats, Prefetch>::Node::isEmpty() const noexcept
+{
+   return (totalItems == 0) ? true : false;
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> inline constexpr int tree234<Key, Value, Stats, Prefetch>::size() const
+{
+  return tree_size;
+}
+             
+template<typename Key, typename Value, typename Stats, typename Prefetch> inline int tree234<Key, Value, Stats, Prefetch>::height() const noexcept
+{
+  return subtree_height(root.get());
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> inline int tree234<Key, Value, Stats, Prefetch>::subtree_height(const Node *pnode) noexcept
+{
+  int depth = 0;
+
+  for (auto current = pnode; current; current = current->children[0].get()) {
+
+       ++depth;
+  }
+
+  return depth;
+}
+// Move assignment operator
+template<typename Key, typename Value, typename Stats, typename Prefetch> inline tree234<Key, Value, Stats, Prefetch>& tree234<Key, Value, Stats, Prefetch>::operator=(tree234&& lhs) noexcept 
+{
+    if (this == &lhs) return *this;
+
+    release_nodes(root);
+
+    tree_size = lhs.tree_size;
+
+    lhs.tree_size = 0;
+
+    root = std::move(lhs.root);
+
+    if (root) root->parent = nullptr;
+
+    return *this;
+}
+/*
+ * F is a functor whose function call operator takes a 1.) const Node * and an 2.) int, indicating the depth of the node from the root,
+ * which has depth 1.
+ */
+template<typename Key, typename Value, typename Stats, typename Prefetch> template<typename Functor> void tree234<Key, Value, Stats, Prefetch>::levelOrderTraverse(Functor f) const noexcept
+{
+   if (!root.get()) return;
+   
+   // pair of: 1. const Node * and 2. level of tree.
+   std::queue<std::pair<const Node*, int>> queue; 
+
+   auto level = 1;
+
+   queue.push({root.get(), level});
+
+   while (!queue.empty()) {
+
+        auto& [pnode, tree_level] = queue.front(); 
+
+        f(pnode, tree_level); // Call functor 
+         
+        if (!pnode->isLeaf()) { // If it was not a leaf node, push its children onto the queue
+            
+            for(auto i = 0; i < pnode->getChildCount(); ++i) {
+
+               queue.push({pnode->children[i].get(), tree_level + 1});  
+            }
+        }
+
+        queue.pop(); // Remove the node used in the call to functor f above.
+   }
+}
+/*
+ * This method allows the tree to be traversed in-order step-by-step
+ */
+template<typename Key, typename Value, typename Stats, typename Prefetch> template<typename Functor> inline void tree234<Key, Value, Stats, Prefetch>::iterativeInOrderTraverse(Functor f) const noexcept
+{
+   const Node *current = min(root.get());
+   int key_index = 0;
+
+   while (current)  {
+ 
+      f(current->pair(key_index)); 
+
+      //std::pair<const Node *, int> pair = getSuccessor(current, key_index);  
+      auto &&[next_pnode, next_index] = getSuccessor(current, key_index);  
+  
+      current = next_pnode; 
+      key_index = next_index;
+  }
+}
+/*
+ * Number of levels below the root at which subtrees are still forked as tasks: enough levels to give each thread of the pool about eight subtrees
+ * (every level at least doubles the number of subtrees), and never the leaves.
+ */
+template<typename Key, typename Value, typename Stats, typename Prefetch> int tree234<Key, Value, Stats, Prefetch>::parallel_spawn_depth(const work_stealing_pool& pool, int tree_height) noexcept
+{
+   int depth = 0;
+
+   for (std::size_t subtrees = 1; subtrees < 8 * static_cast<std::size_t>(pool.size()); subtrees *= 2)
+        ++depth;
+
+   return std::min(depth, tree_height - 1);
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> template<typename Functor> inline void tree234<Key, Value, Stats, Prefetch>::parallel_for_each(Functor f) const
+{
+   parallel_for_each(f, work_stealing_pool::default_pool());
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> template<typename Functor> void tree234<Key, Value, Stats, Prefetch>::parallel_for_each(Functor f, work_stealing_pool& pool) const
+{
+   if (!root) return;
+
+   task_group group{pool};
+
+   DoParallelForEach(f, root.get(), parallel_spawn_depth(pool, height()), group);
+
+   group.wait();
+}
+
+/*
+ * Forks each child subtree as a task until spawn_depth reaches zero, after which the subtree is visited serially by DoInOrderTraverse().
+ */
+template<typename Key, typename Value, typename Stats, typename Prefetch> template<typename Functor> void tree234<Key, Value, Stats, Prefetch>::DoParallelForEach(Functor& f, const Node *pnode, int spawn_depth, task_group& group) const
+{
+   if (spawn_depth <= 0 || pnode->isLeaf()) {
+
+       DoInOrderTraverse([&f](const value_type& pair) { f(pair); }, pnode);
+       return;
+   }
+
+   for (auto i = 0; i < pnode->getChildCount(); ++i) {
+
+       const Node *child = pnode->children[i].get();
+
+       group.run([this, &f, child, spawn_depth, &group] { DoParallelForEach(f, child, spawn_depth - 1, group); });
+   }
+
+   for (auto i = 0; i < pnode->getTotalItems(); ++i)
+        f(pnode->get_value(i));
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> void tree234<Key, Value, Stats, Prefetch>::export_subtree(const Node *pnode, Key *& keys, Value *& values, std::size_t& room)
+{
+   if (pnode->isLeaf()) {
+
+       auto n = std::min<std::size_t>(pnode->getTotalItems(), room);
+
+       for (std::size_t i = 0; i < n; ++i) {
+
+           const auto& pair = pnode->get_value(static_cast<int>(i));
+
+           *keys++ = pair.first;
+           *values++ = pair.second;
+       }
+
+       room -= n;
+       return;
+   }
+
+   for (auto i = 0; i < pnode->getTotalItems() && room > 0; ++i) {
+
+       export_subtree(pnode->children[i].get(), keys, values, room);
+
+       if (room == 0) return;
+
+       const auto& pair = pnode->get_value(i);
+
+       *keys++ = pair.first;
+       *values++ = pair.second;
+       --room;
+   }
+
+   if (room > 0) export_subtree(pnode->children[pnode->getTotalItems()].get(), keys, values, room);
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> std::size_t tree234<Key, Value, Stats, Prefetch>::count_keys(const Node *pnode) noexcept
+{
+   std::size_t count = pnode->getTotalItems();
+
+   if (!pnode->isLeaf()) 
+       for (auto i = 0; i < pnode->getChildCount(); ++i)
+            count += count_keys(pnode->children[i].get());
+
+   return count;
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> void tree234<Key, Value, Stats, Prefetch>::collect_subtrees(const Node *pnode, int depth, std::vector<const Node *>& subtrees, std::vector<const value_type *>& separators)
+{
+   if (depth <= 0 || pnode->isLeaf()) {
+
+       subtrees.push_back(pnode);
+       return;
+   }
+
+   for (auto i = 0; i < pnode->getChildCount(); ++i) {
+
+       collect_subtrees(pnode->children[i].get(), depth - 1, subtrees, separators);
+
+       if (i < pnode->getTotalItems()) separators.push_back(&pnode->get_value(i));
+   }
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> std::size_t tree234<Key, Value, Stats, Prefetch>::export_columns(std::span<Key> keys, std::span<Value> values) const
+{
+   auto room = std::min(keys.size(), values.size());
+   auto total = room;
+
+   Key *pkeys = keys.data();
+   Value *pvalues = values.data();
+
+   if (root && room > 0) export_subtree(root.get(), pkeys, pvalues, room);
+
+   return total - room;
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> std::size_t tree234<Key, Value, Stats, Prefetch>::export_columns(const Key& first, const Key& last, std::span<Key> keys, std::span<Value> values) const
+{
+   auto room = std::min(keys.size(), values.size());
+   auto total = room;
+
+   Key *pkeys = keys.data();
+   Value *pvalues = values.data();
+
+   auto export_pair = [&](const value_type& pair) {
+
+      if (room == 0) return false;
+
+      *pkeys++ = pair.first;
+      *pvalues++ = pair.second;
+      --room;
+
+      return true;
+   };
+
+   if (root && first < last) DoRangeTraverse(export_pair, first, last, root.get());
+
+   return total - room;
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> std::size_t tree234<Key, Value, Stats, Prefetch>::export_columns(std::span<Key> keys, std::span<Value> values, work_stealing_pool& pool) const
+{
+   auto size = static_cast<std::size_t>(tree_size);
+
+   if (keys.size() < size || values.size() < size) throw std::length_error("tree234::export_columns: output is smaller than the tree");
+
+   if (!root) return 0;
+
+   std::vector<const Node *> subtrees;
+   std::vector<const value_type *> separators; // separators[i] follows subtrees[i]
+
+   collect_subtrees(root.get(), parallel_spawn_depth(pool, height()), subtrees, separators);
+
+   std::vector<std::size_t> offsets(subtrees.size());
+   {
+      task_group group{pool};
+
+      for (std::size_t i = 0; i < subtrees.size(); ++i) 
+           group.run([&subtrees, &offsets, i] { offsets[i] = count_keys(subtrees[i]); });
+
+      group.wait();
+   }
+
+   std::size_t offset = 0;
+
+   for (std::size_t i = 0; i < subtrees.size(); ++i) {
+
+       auto count = offsets[i];
+
+       offsets[i] = offset;
+       offset += count;
+
+       if (i < separators.size()) {
+
+           keys[offset] = separators[i]->first;
+           values[offset] = separators[i]->second;
+           ++offset;
+       }
+   }
+
+   task_group group{pool};
+
+   for (std::size_t i = 0; i < subtrees.size(); ++i) {
+
+       group.run([&subtrees, &offsets, &keys, &values, i] {
+
+          Key *pkeys = keys.data() + offsets[i];
+          Value *pvalues = values.data() + offsets[i];
+          std::size_t room = static_cast<std::size_t>(-1);
+
+          export_subtree(subtrees[i], pkeys, pvalues, room);
+       });
+   }
+
+   group.wait();
+
+   return size;
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> template<typename T, typename Accumulate, typename Combine> inline T tree234<Key, Value, Stats, Prefetch>::parallel_reduce(T identity, Accumulate acc, Combine combine) const
+{
+   return parallel_reduce(std::move(identity), acc, combine, work_stealing_pool::default_pool());
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> template<typename T, typename Accumulate, typename Combine> T tree234<Key, Value, Stats, Prefetch>::parallel_reduce(T identity, Accumulate acc, Combine combine, work_stealing_pool& pool) const
+{
+   if (!root) return identity;
+
+   return DoParallelReduce(identity, acc, combine, root.get(), parallel_spawn_depth(pool, height()), pool);
+}
+
+/*
+ * Reduces the subtree rooted at pnode. The child subtrees are reduced as independent tasks (the last one on the calling thread), and their
+ * results are then joined with the node's own keys in in-order sequence: child 0, key 0, child 1, key 1, ..., so that the result is the
+ * same as that of a serial in-order fold whenever combine is associative.
+ */
+template<typename Key, typename Value, typename Stats, typename Prefetch> template<typename T, typename Accumulate, typename Combine> T tree234<Key, Value, Stats, Prefetch>::DoParallelReduce(const T& identity, Accumulate& acc, Combine& combine, const Node *pnode, int spawn_depth, work_stealing_pool& pool) const
+{
+   if (spawn_depth <= 0 || pnode->isLeaf()) {
+
+       T result = identity;
+
+       DoInOrderTraverse([&](const value_type& pair) { result = acc(std::move(result), pair); }, pnode);
+
+       return result;
+   }
+
+   std::array<T, 4> partial{identity, identity, identity, identity};
+
+   auto last = pnode->getChildCount() - 1;
+   {
+      task_group group{pool};
+
+      for (auto i = 0; i < last; ++i) {
+
+          const Node *child = pnode->children[i].get();
+
+          group.run([&, child, i] { partial[i] = DoParallelReduce(identity, acc, combine, child, spawn_depth - 1, pool); });
+      }
+
+      partial[last] = DoParallelReduce(identity, acc, combine, pnode->children[last].get(), spawn_depth - 1, pool);
+
+      group.wait();
+   }
+
+   T result = std::move(partial[0]);
+
+   for (auto i = 0; i < pnode->getTotalItems(); ++i) {
+
+       result = acc(std::move(result), pnode->get_value(i));
+
+       result = combine(std::move(result), std::move(partial[i + 1]));
+   }
+
+   return result;
+}
+
+/*
+ * A subtree of height h holds at least 2^h - 1 keys (all 2-nodes) and at most 4^h - 1 keys (all 4-nodes). bulk_height() returns the least
+ * height that can hold n keys; n is then also at least the minimum for that height.
+ */
+template<typename Key, typename Value, typename Stats, typename Prefetch> int tree234<Key, Value, Stats, Prefetch>::bulk_height(std::size_t n) noexcept
+{
+   int height = 1;
+
+   for (std::size_t max_keys = 3; max_keys < n; max_keys = 4 * max_keys + 3) 
+        ++height;
+
+   return height;
+}
+
+/*
+ * Divides the n keys of a subtree of the given height (> 1) among its children: sizes[i] receives the number of keys in child i, and the
+ * number of children is returned. The number of children is the feasible value closest to the subtree's average fan-out, (n + 1)^(1/height),
+ * so that nodes are filled evenly at all levels.
+ */
+template<typename Key, typename Value, typename Stats, typename Prefetch> int tree234<Key, Value, Stats, Prefetch>::bulk_child_sizes(std::size_t n, int height, std::array<std::size_t, 4>& sizes) noexcept
+{
+   std::size_t min_keys = (std::size_t{1} << (height - 1)) - 1; // bounds for a child of height - 1 
+   std::size_t max_keys = 0;
+
+   for (auto i = 1; i < height; ++i) max_keys = 4 * max_keys + 3;
+
+   double fanout = std::pow(static_cast<double>(n + 1), 1.0 / height);
+
+   std::array<int, 3> candidates{2, 3, 4};
+
+   std::sort(candidates.begin(), candidates.end(), [fanout](int a, int b) { return std::abs(a - fanout) < std::abs(b - fanout); });
+
+   for (auto children : candidates) {
+
+       if (n < static_cast<std::size_t>(children - 1)) continue;
+
+       std::size_t m = n - (children - 1); // keys left for the children
+
+       if (m < children * min_keys || m > children * max_keys) continue;
+
+       for (auto i = 0; i < children; ++i) 
+            sizes[i] = m / children + (static_cast<std::size_t>(i) < m % children ? 1 : 0);
+
+       return children;
+   }
+
+   return 0; // unreachable when height == bulk_height(n) or n is within the bounds of height.
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> template<typename Source> std::unique_ptr<typename tree234<Key, Value, Stats, Prefetch>::Node> tree234<Key, Value, Stats, Prefetch>::build_subtree(Source& next, std::size_t n, int height)
+{
+   auto node = std::make_unique<Node>();
+
+   if (height == 1) {
+
+       for (std::size_t i = 0; i < n; ++i) 
+            node->keys_values[i].__ref() = std::move(next());
+
+       node->totalItems = static_cast<int>(n);
+       return node;
+   }
+
+   std::array<std::size_t, 4> sizes;
+
+   auto children = bulk_child_sizes(n, height, sizes);
+
+   for (auto i = 0; i < children; ++i) {
+
+       auto child = build_subtree(next, sizes[i], height - 1);
+
+       node->connectChild(i, child);
+
+       if (i < children - 1) 
+           node->keys_values[i].__ref() = std::move(next());
+   }
+
+   node->totalItems = children - 1;
+   return node;
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> std::unique_ptr<typename tree234<Key, Value, Stats, Prefetch>::Node> tree234<Key, Value, Stats, Prefetch>::build_subtree(std::pair<Key, Value> *items, std::size_t n, int height, int spawn_depth, work_stealing_pool& pool)
+{
+   if (spawn_depth <= 0 || height == 1) {
+
+       auto next = [items]() mutable -> std::pair<Key, Value>& { return *items++; };
+
+       return build_subtree(next, n, height);
+   }
+
+   auto node = std::make_unique<Node>();
+
+   std::array<std::size_t, 4> sizes;
+
+   auto children = bulk_child_sizes(n, height, sizes);
+
+   std::array<std::unique_ptr<Node>, 4> subtrees;
+   {
+      task_group group{pool};
+
+      std::size_t offset = 0;
+
+      for (auto i = 0; i < children; ++i) {
+
+          std::pair<Key, Value> *first = items + offset;
+          std::size_t count = sizes[i];
+
+          group.run([&subtrees, i, first, count, height, spawn_depth, &pool] { subtrees[i] = build_subtree(first, count, height - 1, spawn_depth - 1, pool); });
+
+          offset += count;
+
+          if (i < children - 1) 
+              node->keys_values[i].__ref() = std::move(items[offset++]);
+      }
+
+      group.wait();
+   }
+
+   for (auto i = 0; i < children; ++i) 
+        node->connectChild(i, subtrees[i]);
+
+   node->totalItems = children - 1;
+   return node;
+}
+
+// Replaces the tree's nodes with a tree built from items, which must be in strictly ascending key order.
+template<typename Key, typename Value, typename Stats, typename Prefetch> void tree234<Key, Value, Stats, Prefetch>::build_from_sorted(std::vector<std::pair<Key, Value>>& items, work_stealing_pool& pool)
+{
+   release_nodes(root);
+
+   tree_size = static_cast<int>(items.size());
+
+   if (items.empty()) return;
+
+   auto height = bulk_height(items.size());
+
+   root = build_subtree(items.data(), items.size(), height, parallel_spawn_depth(pool, height), pool);
+   root->parent = nullptr;
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> template<typename Item> typename tree234<Key, Value, Stats, Prefetch>::batch_run tree234<Key, Value, Stats, Prefetch>::update_subtree(std::unique_ptr<Node>& subtree, int height, std::span<Item> slice, int spawn_depth, work_stealing_pool& pool, std::size_t& changed)
+{
+   constexpr bool inserting = !std::is_same_v<std::remove_const_t<Item>, Key>;
+
+   auto key_of = [](const auto& item) -> const Key& { if constexpr (inserting) return item.first; else return item; };
+
+   batch_run sequence;
+
+   if (slice.empty()) return sequence;
+
+   Node *pnode = subtree.get();
+
+   if (height == 1) { // Merge the leaf's keys with the slice; the keys are then separators between empty trees.
+
+       // Up to seven keys are merged in a buffer and put back in the leaf, or in it and a new right sibling, so the leaf stays where it is.
+       bool small = !inserting || pnode->getTotalItems() + slice.size() <= 7;
+
+       std::array<__value_type<Key, Value>, 7> buffer;
+       int buffered = 0;
+
+       auto& keys = sequence.separators;
+
+       if (!small) keys.reserve(pnode->getTotalItems() + slice.size());
+
+       auto keep = [&](auto&& key_value) {
+          if (small) buffer[buffered++] = __value_type<Key, Value>(std::move(key_value));
+          else keys.emplace_back(std::move(key_value));
+       };
+
+       auto item = slice.begin();
+
+       for (auto i = 0; i < pnode->getTotalItems(); ++i) {
+
+           const Key& key = pnode->key(i);
+
+           for (; item != slice.end() && key_of(*item) < key; ++item) 
+               if constexpr (inserting) { keep(*item); ++changed; }
+
+           bool matched = item != slice.end() && !(key < key_of(*item));
+
+           if (matched) ++item;
+
+           if (inserting || !matched) keep(pnode->keys_values[i]); // an existing key keeps its value
+           else ++changed;
+       }
+
+       if constexpr (inserting) 
+           for (; item != slice.end(); ++item) { keep(*item); ++changed; }
+
+       if (small) {
+
+           auto left = buffered <= 3 ? buffered : (buffered - 1) / 2;
+
+           for (auto i = 0; i < left; ++i) pnode->keys_values[i] = std::move(buffer[i]);
+
+           pnode->totalItems = left;
+
+           if (buffered == 0) { // the leaf emptied
+
+               subtree.reset();
+               sequence.trees.emplace_back();
+
+           } else if (buffered > 3) { // split: the rest of the keys go to a new right sibling
+
+               auto right = std::make_unique<Node>();
+
+               for (auto i = left + 1; i < buffered; ++i) right->keys_values[i - left - 1] = std::move(buffer[i]);
+
+               right->totalItems = buffered - left - 1;
+
+               sequence.trees.reserve(2);
+               sequence.trees.push_back({std::move(subtree), 1, true});
+               sequence.trees.push_back({std::move(right), 1});
+               sequence.separators.push_back(std::move(buffer[left]));
+           }
+
+           return sequence;
+       }
+
+       sequence.trees.resize(keys.size() + 1); // empty trees
+
+   } else {
+
+       auto children = pnode->getChildCount();
+
+       std::array<std::span<Item>, 4> slices;
+       std::array<bool, 3> removed{}; // whether the key between children i and i + 1 is in a remove batch
+
+       auto first = slice.begin();
+
+       for (auto i = 0; i < pnode->getTotalItems(); ++i) {
+
+           auto last = std::lower_bound(first, slice.end(), pnode->key(i), [&key_of](const auto& item, const Key& key) { return key_of(item) < key; });
+
+           slices[i] = std::span<Item>(first, last);
+
+           first = last;
+
+           if (last != slice.end() && !(pnode->key(i) < key_of(*last))) { // an existing key keeps its value, or is removed
+
+               removed[i] = !inserting;
+               ++first;
+           }
+       }
+
+       slices[children - 1] = std::span<Item>(first, slice.end());
+
+       std::array<batch_run, 4> results;
+       std::array<std::size_t, 4> counts{};
+
+       auto update = [&results, &counts, pnode, &slices, height, spawn_depth, &pool](int i) {
+          results[i] = update_subtree(pnode->children[i], height - 1, slices[i], spawn_depth - 1, pool, counts[i]);
+       };
+
+       if (spawn_depth > 0) {
+
+           task_group group{pool};
+
+           for (auto i = 0; i < children; ++i) 
+               if (slices[i].size() >= batch_task_grain) group.run([&update, i] { update(i); });
+               else if (!slices[i].empty()) update(i);
+
+           group.wait();
+
+       } else {
+
+           for (auto i = 0; i < children; ++i) 
+               if (!slices[i].empty()) update(i);
+       }
+
+       bool reshaped = false; // whether a child changed height or split, or a key between children was removed
+
+       for (auto i = 0; i < children; ++i) {
+
+           changed += counts[i] + (i > 0 && removed[i - 1]);
+
+           reshaped = reshaped || !results[i].trees.empty() || (i > 0 && removed[i - 1]);
+       }
+
+       if (!reshaped) return sequence;
+
+       std::size_t trees = 0;
+       bool split_only = true; // every child that reshaped split into trees of its height, and no key between children was removed
+
+       for (auto i = 0; i < children; ++i) {
+
+           trees += std::max<std::size_t>(results[i].trees.size(), 1);
+
+           split_only = split_only && !(i > 0 && removed[i - 1]) 
+                        && std::all_of(results[i].trees.begin(), results[i].trees.end(), [height](const auto& tree) { return tree.height == height - 1; });
+       }
+
+       if (split_only && trees <= 8) { // pnode takes the splits' keys and trees in place, splitting in two itself if they overflow it
+
+           std::array<__value_type<Key, Value>, 7> keys;
+           std::array<batch_tree, 8> subtrees;
+           int count = 0;
+
+           for (auto i = 0; i < children; ++i) {
+
+               if (i > 0) keys[count - 1] = std::move(pnode->keys_values[i - 1]);
+
+               if (results[i].trees.empty()) {
+
+                   subtrees[count++] = {std::move(pnode->children[i]), height - 1, true};
+                   continue;
+               }
+
+               for (std::size_t j = 0; j < results[i].trees.size(); ++j) {
+
+                   if (j > 0) keys[count - 1] = std::move(results[i].separators[j - 1]);
+
+                   subtrees[count++] = std::move(results[i].trees[j]);
+               }
+           }
+
+           auto left = count <= 4 ? count : count / 2;
+
+           for (auto i = 0; i < left; ++i) {
+
+               if (i > 0) pnode->keys_values[i - 1] = std::move(keys[i - 1]);
+
+               if (subtrees[i].attached) pnode->children[i] = std::move(subtrees[i].root); // saves reading a child the update never touched
+               else pnode->connectChild(i, subtrees[i].root);
+           }
+
+           pnode->totalItems = left - 1;
+
+           if (count > 4) {
+
+               auto right = std::make_unique<Node>();
+
+               for (auto i = left; i < count; ++i) {
+
+                   if (i > left) right->keys_values[i - left - 1] = std::move(keys[i - 1]);
+
+                   right->connectChild(i - left, subtrees[i].root);
+               }
+
+               right->totalItems = count - left - 1;
+
+               sequence.trees.reserve(2);
+               sequence.trees.push_back({std::move(subtree), height, true});
+               sequence.trees.push_back({std::move(right), height});
+               sequence.separators.push_back(std::move(keys[left - 1]));
+           }
+
+           return sequence;
+       }
+
+       sequence.trees.reserve(trees);
+       sequence.separators.reserve(trees - 1);
+
+       for (auto i = 0; i < children; ++i) {
+
+           if (results[i].trees.empty()) results[i].trees.push_back({std::move(pnode->children[i]), height - 1, true});
+
+           if (i > 0 && !removed[i - 1]) 
+               sequence.separators.push_back(std::move(pnode->keys_values[i - 1]));
+
+           else if (i > 0) { // The removed key's place goes to the largest key left of it, unless nothing is left of it.
+
+               auto left = std::move(sequence.trees.back());
+
+               sequence.trees.pop_back();
+
+               if (left.height > 0) {
+
+                   const Node *pmax = left.root.get();
+
+                   while (!pmax->isLeaf()) pmax = pmax->getRightMostChild();
+
+                   const auto& max = pmax->get_value(pmax->get_lastkey_index());
+
+                   __value_type<Key, Value> separator{max.first, max.second};
+
+                   std::size_t moved = 0;
+
+                   auto rest = update_subtree(left.root, left.height, std::span<const Key>(&separator.__get_value().first, 1), 0, pool, moved);
+
+                   if (rest.trees.empty()) rest.trees.push_back(std::move(left));
+
+                   std::move(rest.trees.begin(), rest.trees.end(), std::back_inserter(sequence.trees));
+                   std::move(rest.separators.begin(), rest.separators.end(), std::back_inserter(sequence.separators));
+
+                   sequence.separators.push_back(std::move(separator));
+               }
+           }
+
+           std::move(results[i].trees.begin(), results[i].trees.end(), std::back_inserter(sequence.trees));
+           std::move(results[i].separators.begin(), results[i].separators.end(), std::back_inserter(sequence.separators));
+       }
+
+       pnode->totalItems = 0;
+   }
+
+   auto level = settle_run(sequence, height);
+
+   if (level.trees.size() == 1) { // the subtree shrank
+
+       subtree.reset();
+       return level;
+   }
+
+   auto run = gather_run(level, height, std::move(subtree));
+
+   if (run.trees.size() == 1) { // one node again, the one pnode was
+
+       subtree = std::move(run.trees[0].root);
+       run.trees.clear();
+   }
+
+   return run;
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> typename tree234<Key, Value, Stats, Prefetch>::batch_run tree234<Key, Value, Stats, Prefetch>::settle_run(batch_run& sequence, int height)
+{
+   if (std::all_of(sequence.trees.begin(), sequence.trees.end(), [height](const auto& tree) { return tree.height == height - 1; }))
+       return std::move(sequence);
+
+   batch_run level;     // trees of height - 1
+   batch_tree pending;  // a shorter tree, while level is empty
+   bool has_pending = false;
+
+   level.trees.reserve(sequence.trees.size() + 1);
+   level.separators.reserve(sequence.trees.size());
+
+   for (std::size_t i = 0; i < sequence.trees.size(); ++i) {
+
+       auto& tree = sequence.trees[i];
+
+       if (i == 0) {
+
+           if (tree.height == height - 1) level.trees.push_back(std::move(tree));
+           else pending = std::move(tree), has_pending = true;
+
+           continue;
+       }
+
+       auto& separator = sequence.separators[i - 1];
+
+       if (!level.trees.empty() && tree.height == height - 1) {
+
+           level.separators.push_back(std::move(separator));
+           level.trees.push_back(std::move(tree));
+           continue;
+       }
+
+       batch_run joined;
+
+       if (!level.trees.empty()) { // tree is shorter: graft it onto the last tree of full height
+
+           auto last = std::move(level.trees.back());
+
+           level.trees.pop_back();
+
+           joined = join(std::move(last), std::move(separator), std::move(tree));
+
+       } else {
+
+           joined = join(std::move(pending), std::move(separator), std::move(tree));
+           has_pending = false;
+
+           if (joined.trees.size() == 2 && joined.trees[0].height < height - 1) { // two short trees of one height: a 2-node over them
+
+               auto parent = std::make_unique<Node>();
+
+               parent->keys_values[0] = std::move(joined.separators[0]);
+               parent->connectChild(0, joined.trees[0].root);
+               parent->connectChild(1, joined.trees[1].root);
+               parent->totalItems = 1;
+
+               pending = {std::move(parent), joined.trees[0].height + 1};
+
+               if (pending.height < height - 1) {
+
+                   has_pending = true;
+                   continue;
+               }
+
+               joined.trees.clear();
+               joined.separators.clear();
+               joined.trees.push_back(std::move(pending));
+
+           } else if (joined.trees[0].height < height - 1) {
+
+               pending = std::move(joined.trees[0]);
+               has_pending = true;
+               continue;
+           }
+       }
+
+       std::move(joined.trees.begin(), joined.trees.end(), std::back_inserter(level.trees));
+       std::move(joined.separators.begin(), joined.separators.end(), std::back_inserter(level.separators));
+   }
+
+   if (has_pending) level.trees.push_back(std::move(pending));
+
+   return level;
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> typename tree234<Key, Value, Stats, Prefetch>::batch_run tree234<Key, Value, Stats, Prefetch>::gather_run(batch_run& level, int height, std::unique_ptr<Node> spare)
+{
+   // Groups of three children leave room for later inserts; two to four children each keep every node legal.
+   std::size_t count = level.trees.size();
+   std::size_t groups = count <= 4 ? 1 : (count + 2) / 3;
+
+   batch_run run;
+
+   run.trees.reserve(groups);
+   run.separators.reserve(groups - 1);
+
+   for (std::size_t group = 0, first = 0; group < groups; ++group) {
+
+       auto children = static_cast<int>(count / groups + (group < count % groups));
+
+       bool reused = spare != nullptr;
+
+       auto node = reused ? std::move(spare) : std::make_unique<Node>();
+
+       for (auto i = 0; i < children; ++i) {
+
+           auto& tree = level.trees[first + i];
+
+           if (reused && tree.attached) node->children[i] = std::move(tree.root); // saves reading a child the update never touched
+           else node->connectChild(i, tree.root);
+
+           if (i < children - 1) 
+               node->keys_values[i] = std::move(level.separators[first + i]);
+       }
+
+       node->totalItems = children - 1;
+
+       first += children;
+
+       if (group < groups - 1) 
+           run.separators.push_back(std::move(level.separators[first - 1]));
+
+       run.trees.push_back({std::move(node), height});
+   }
+
+   return run;
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> typename tree234<Key, Value, Stats, Prefetch>::batch_run tree234<Key, Value, Stats, Prefetch>::join(batch_tree lhs, __value_type<Key, Value>&& separator, batch_tree rhs)
+{
+   batch_run run;
+
+   if (lhs.height == rhs.height) {
+
+       run.trees.push_back(std::move(lhs));
+       run.separators.push_back(std::move(separator));
+       run.trees.push_back(std::move(rhs));
+
+   } else if (lhs.height > rhs.height) {
+
+       auto split = join_right(lhs.root.get(), lhs.height, separator, rhs);
+
+       run.trees.push_back(std::move(lhs));
+
+       if (split) {
+
+           run.separators.push_back(std::move(split->first));
+           run.trees.push_back({std::move(split->second), run.trees[0].height});
+       }
+
+   } else {
+
+       auto split = join_left(rhs.root.get(), rhs.height, lhs, separator);
+
+       if (split) {
+
+           run.trees.push_back({std::move(split->second), rhs.height});
+           run.separators.push_back(std::move(split->first));
+       }
+
+       run.trees.push_back(std::move(rhs));
+   }
+
+   return run;
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> typename tree234<Key, Value, Stats, Prefetch>::edge_split tree234<Key, Value, Stats, Prefetch>::join_right(Node *pnode, int height, __value_type<Key, Value>& separator, batch_tree& rhs)
+{
+   if (height == rhs.height + 1) 
+       return append_edge(pnode, std::move(separator), std::move(rhs.root));
+
+   auto split = join_right(pnode->children[pnode->getTotalItems()].get(), height - 1, separator, rhs);
+
+   return split ? append_edge(pnode, std::move(split->first), std::move(split->second)) : std::nullopt;
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> typename tree234<Key, Value, Stats, Prefetch>::edge_split tree234<Key, Value, Stats, Prefetch>::join_left(Node *pnode, int height, batch_tree& lhs, __value_type<Key, Value>& separator)
+{
+   if (height == lhs.height + 1) 
+       return prepend_edge(pnode, std::move(separator), std::move(lhs.root));
+
+   auto split = join_left(pnode->children[0].get(), height - 1, lhs, separator);
+
+   return split ? prepend_edge(pnode, std::move(split->first), std::move(split->second)) : std::nullopt;
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> typename tree234<Key, Value, Stats, Prefetch>::edge_split tree234<Key, Value, Stats, Prefetch>::append_edge(Node *pnode, __value_type<Key, Value>&& key, std::unique_ptr<Node> child)
+{
+   auto n = pnode->getTotalItems();
+
+   if (n < 3) {
+
+       pnode->keys_values[n] = std::move(key);
+       pnode->connectChild(n + 1, child);
+       ++pnode->totalItems;
+
+       return std::nullopt;
+   }
+
+   // Keys k0 k1 k2 key: pnode keeps k0 k1, k2 goes up, and key moves to a new right sibling.
+   auto right = std::make_unique<Node>();
+
+   right->keys_values[0] = std::move(key);
+   right->connectChild(0, pnode->children[3]);
+   right->connectChild(1, child);
+   right->totalItems = 1;
+
+   pnode->totalItems = 2;
+
+   return std::make_pair(std::move(pnode->keys_values[2]), std::move(right));
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> typename tree234<Key, Value, Stats, Prefetch>::edge_split tree234<Key, Value, Stats, Prefetch>::prepend_edge(Node *pnode, __value_type<Key, Value>&& key, std::unique_ptr<Node> child)
+{
+   auto n = pnode->getTotalItems();
+
+   if (n < 3) {
+
+       for (auto i = n; i > 0; --i) pnode->keys_values[i] = std::move(pnode->keys_values[i - 1]);
+       for (auto i = n + 1; i > 0; --i) pnode->children[i] = std::move(pnode->children[i - 1]);
+
+       pnode->keys_values[0] = std::move(key);
+       pnode->connectChild(0, child);
+       ++pnode->totalItems;
+
+       return std::nullopt;
+   }
+
+   // Keys key k0 k1 k2: key moves to a new left sibling, k0 goes up, and pnode keeps k1 k2.
+   auto left = std::make_unique<Node>();
+
+   left->keys_values[0] = std::move(key);
+   left->connectChild(0, child);
+   left->connectChild(1, pnode->children[0]);
+   left->totalItems = 1;
+
+   __value_type<Key, Value> up{std::move(pnode->keys_values[0])};
+
+   pnode->keys_values[0] = std::move(pnode->keys_values[1]);
+   pnode->keys_values[1] = std::move(pnode->keys_values[2]);
+
+   for (auto i = 0; i < 3; ++i) pnode->children[i] = std::move(pnode->children[i + 1]);
+
+   pnode->totalItems = 2;
+
+   return std::make_pair(std::move(up), std::move(left));
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> inline std::size_t tree234<Key, Value, Stats, Prefetch>::insert_batch(std::span<const std::pair<Key, Value>> batch)
+{
+   return insert_batch(batch, work_stealing_pool::default_pool());
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> std::size_t tree234<Key, Value, Stats, Prefetch>::insert_batch(std::span<const std::pair<Key, Value>> batch, work_stealing_pool& pool)
+{
+   std::vector<std::pair<Key, Value>> items(batch.begin(), batch.end());
+
+   auto key_less = [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; };
+
+   std::stable_sort(items.begin(), items.end(), key_less);
+
+   items.erase(std::unique(items.begin(), items.end(), [](const auto& lhs, const auto& rhs) { return lhs.first == rhs.first; }), items.end());
+
+   if (!root) {
+
+       build_from_sorted(items, pool);
+       return items.size();
+   }
+
+   std::size_t inserted = 0;
+
+   auto height = this->height();
+
+   auto run = update_subtree(root, height, std::span<std::pair<Key, Value>>(items), parallel_spawn_depth(pool, height), pool, inserted);
+
+   if (!run.trees.empty()) plant(run);
+
+   tree_size += static_cast<int>(inserted);
+
+   return inserted;
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> inline std::size_t tree234<Key, Value, Stats, Prefetch>::remove_batch(std::span<const Key> keys)
+{
+   return remove_batch(keys, work_stealing_pool::default_pool());
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> std::size_t tree234<Key, Value, Stats, Prefetch>::remove_batch(std::span<const Key> batch, work_stealing_pool& pool)
+{
+   std::vector<Key> keys(batch.begin(), batch.end());
+
+   std::sort(keys.begin(), keys.end());
+
+   keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+   if (!root) return 0;
+
+   std::size_t removed = 0;
+
+   auto height = this->height();
+
+   auto run = update_subtree(root, height, std::span<const Key>(keys), parallel_spawn_depth(pool, height), pool, removed);
+
+   if (!run.trees.empty()) plant(run);
+
+   tree_size -= static_cast<int>(removed);
+
+   return removed;
+}
+
+// Makes the run left by an update of the root the tree, adding levels above it until one tree is left.
+template<typename Key, typename Value, typename Stats, typename Prefetch> void tree234<Key, Value, Stats, Prefetch>::plant(batch_run& run)
+{
+   while (run.trees.size() > 1) 
+       run = gather_run(run, run.trees[0].height + 1, nullptr);
+
+   root = std::move(run.trees[0].root);
+
+   if (root) root->parent = nullptr;
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> std::uint64_t tree234<Key, Value, Stats, Prefetch>::count_nodes(const Node *pnode) noexcept
+{
+   if (!pnode) return 0;
+
+   std::uint64_t count = 1;
+
+   if (!pnode->isLeaf()) 
+       for (auto i = 0; i < pnode->getChildCount(); ++i)
+            count += count_nodes(pnode->children[i].get());
+
+   return count;
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> void tree234<Key, Value, Stats, Prefetch>::tally_nodes(const Node *pnode, std::size_t level, memory_report_type& report)
+{
+   if (report.levels.size() == level) report.levels.push_back({0, 0, 0});
+
+   auto& fill = report.levels[level];
+
+   switch (pnode->getTotalItems()) {
+
+      case 1: ++fill.two_nodes;   break;
+      case 2: ++fill.three_nodes; break;
+      default: ++fill.four_nodes; break;
+   }
+
+   ++report.nodes;
+
+   auto unused_keys = 3 - pnode->getTotalItems();
+
+   report.unused_bytes += unused_keys * sizeof(__value_type<Key, Value>);
+
+   if (pnode->isLeaf()) {
+
+       ++report.leaves;
+       report.unused_bytes += pnode->children.size() * sizeof(std::unique_ptr<Node>); // a leaf uses none of its children slots
+       return;
+   }
+
+   ++report.internal_nodes;
+   report.unused_bytes += unused_keys * sizeof(std::unique_ptr<Node>);
+
+   for (auto i = 0; i < pnode->getChildCount(); ++i)
+        tally_nodes(pnode->children[i].get(), level + 1, report);
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> typename tree234<Key, Value, Stats, Prefetch>::memory_report_type tree234<Key, Value, Stats, Prefetch>::memory_report() const
+{
+   memory_report_type report{};
+
+   report.size = tree_size;
+
+   if (root) tally_nodes(root.get(), 0, report);
+
+   report.node_bytes = report.nodes * sizeof(Node);
+   report.bytes_per_entry = tree_size ? double(report.node_bytes + sizeof(tree234)) / tree_size : 0.0;
+   report.fill = report.nodes ? double(tree_size) / (3.0 * report.nodes) : 0.0;
+
+   report.height = height();
+   report.log2_size = tree_size ? std::log2(double(tree_size)) : 0.0;
+
+   // n keys need at least ceil(log4(n + 1)) levels and at most floor(log2(n + 1)).
+   auto n = static_cast<std::uint64_t>(tree_size) + 1;
+
+   report.max_height = std::bit_width(n) - 1;
+   report.min_height = (std::bit_width(n - 1) + 1) / 2;
+
+   return report;
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> typename tree234<Key, Value, Stats, Prefetch>::snapshot_header tree234<Key, Value, Stats, Prefetch>::make_snapshot_header() const noexcept
+{
+   return snapshot_header{snapshot_magic, snapshot_version, sizeof(Key), sizeof(Value), static_cast<std::uint64_t>(tree_size), 
+                          count_nodes(root.get()), static_cast<std::uint32_t>(height()), 0};
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> void tree234<Key, Value, Stats, Prefetch>::check_snapshot_header(const snapshot_header& header) 
+{
+   if (header.magic != snapshot_magic || header.version != snapshot_version) 
+       throw std::runtime_error("tree234::deserialize: not a tree234 snapshot");
+
+   if (header.key_size != sizeof(Key) || header.value_size != sizeof(Value)) 
+       throw std::runtime_error("tree234::deserialize: snapshot was written for different Key or Value types");
+
+   if ((header.size == 0) != (header.height == 0) || header.height > 64 || header.nodes > header.size) 
+       throw std::runtime_error("tree234::deserialize: corrupt snapshot header");
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> template<typename Sink> void tree234<Key, Value, Stats, Prefetch>::serialize_subtree(Sink& sink, const Node *pnode) 
+{
+   sink.put(static_cast<std::uint8_t>(pnode->totalItems));
+
+   for (auto i = 0; i < pnode->getTotalItems(); ++i) 
+        sink.write(&pnode->key(i), sizeof(Key));
+
+   for (auto i = 0; i < pnode->getTotalItems(); ++i) 
+        sink.write(&pnode->get_value(i).second, sizeof(Value));
+
+   if (!pnode->isLeaf()) 
+       for (auto i = 0; i < pnode->getChildCount(); ++i) 
+            serialize_subtree(sink, pnode->children[i].get());
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> void tree234<Key, Value, Stats, Prefetch>::serialize(std::vector<char>& buffer) const
+{
+   static_assert(std::is_trivially_copyable_v<Key> && std::is_trivially_copyable_v<Value>, "tree234::serialize requires trivially copyable Key and Value");
+
+   auto header = make_snapshot_header();
+
+   buffer.reserve(buffer.size() + sizeof(header) + header.nodes + header.size * (sizeof(Key) + sizeof(Value)));
+
+   vector_sink sink{buffer};
+
+   sink.put(header);
+
+   if (root) serialize_subtree(sink, root.get());
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> void tree234<Key, Value, Stats, Prefetch>::serialize(std::ostream& ostr) const
+{
+   static_assert(std::is_trivially_copyable_v<Key> && std::is_trivially_copyable_v<Value>, "tree234::serialize requires trivially copyable Key and Value");
+
+   stream_sink sink{ostr};
+
+   sink.put(make_snapshot_header());
+
+   if (root) serialize_subtree(sink, root.get());
+
+   sink.flush();
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> template<typename Source> std::unique_ptr<typename tree234<Key, Value, Stats, Prefetch>::Node> tree234<Key, Value, Stats, Prefetch>::deserialize_subtree(Source& source, int height, std::uint64_t& keys_read)
+{
+   auto total = source.template get<std::uint8_t>();
+
+   if (total < 1 || total > 3) throw std::runtime_error("tree234::deserialize: corrupt node");
+
+   auto node = std::make_unique<Node>();
+
+   node->totalItems = total;
+
+   for (auto i = 0; i < total; ++i) 
+        source.read(&node->keys_values[i].__ref().first, sizeof(Key));
+
+   for (auto i = 0; i < total; ++i) 
+        source.read(&node->keys_values[i].__ref().second, sizeof(Value));
+
+   keys_read += total;
+
+   if (height > 1) {
+
+       for (auto i = 0; i <= total; ++i) {
+
+           auto child = deserialize_subtree(source, height - 1, keys_read);
+
+           node->connectChild(i, child);
+       }
+   }
+
+   return node;
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> template<typename Source> void tree234<Key, Value, Stats, Prefetch>::deserialize_nodes(Source& source, const snapshot_header& header)
+{
+   std::unique_ptr<Node> new_root;
+
+   std::uint64_t keys_read = 0;
+
+   if (header.height > 0) 
+       new_root = deserialize_subtree(source, static_cast<int>(header.height), keys_read);
+
+   if (keys_read != header.size) throw std::runtime_error("tree234::deserialize: key count does not match header");
+
+   release_nodes(root);
+
+   root = std::move(new_root);
+   tree_size = static_cast<int>(header.size);
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> std::size_t tree234<Key, Value, Stats, Prefetch>::deserialize(std::span<const char> buffer)
+{
+   static_assert(std::is_trivially_copyable_v<Key> && std::is_trivially_copyable_v<Value>, "tree234::deserialize requires trivially copyable Key and Value");
+
+   span_source source{buffer};
+
+   auto header = source.template get<snapshot_header>();
+
+   check_snapshot_header(header);
+
+   deserialize_nodes(source, header);
+
+   return source.consumed();
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> void tree234<Key, Value, Stats, Prefetch>::deserialize(std::istream& istr)
+{
+   static_assert(std::is_trivially_copyable_v<Key> && std::is_trivially_copyable_v<Value>, "tree234::deserialize requires trivially copyable Key and Value");
+
+   snapshot_header header;
+
+   if (!istr.read(reinterpret_cast<char *>(&header), sizeof(header))) 
+       throw std::runtime_error("tree234::deserialize: unexpected end of input");
+
+   check_snapshot_header(header);
+
+   // Read exactly the nodes' bytes, so anything that follows the snapshot in istr is left unread.
+   stream_source source{istr, header.nodes + header.size * (sizeof(Key) + sizeof(Value))};
+
+   deserialize_nodes(source, header);
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> template<typename T> inline std::uint64_t tree234<Key, Value, Stats, Prefetch>::to_ordered(T value) noexcept
+{
+   using U = std::make_unsigned_t<T>;
+
+   auto bits = static_cast<U>(value);
+
+   if constexpr (std::is_signed_v<T>) bits ^= U{1} << (8 * sizeof(T) - 1); // flip the sign bit
+
+   return bits;
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> template<typename T> inline T tree234<Key, Value, Stats, Prefetch>::from_ordered(std::uint64_t bits) noexcept
+{
+   using U = std::make_unsigned_t<T>;
+
+   auto value = static_cast<U>(bits);
+
+   if constexpr (std::is_signed_v<T>) value ^= U{1} << (8 * sizeof(T) - 1);
+
+   return static_cast<T>(value);
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> template<typename Functor> void tree234<Key, Value, Stats, Prefetch>::visit_in_order(const Node *pnode, Functor& f)
+{
+   for (auto i = 0; i < pnode->getTotalItems(); ++i) {
+
+       if (!pnode->isLeaf()) visit_in_order(pnode->children[i].get(), f);
+
+       f(pnode->get_value(i));
+   }
+
+   if (!pnode->isLeaf()) visit_in_order(pnode->children[pnode->getTotalItems()].get(), f);
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> template<typename Sink> void tree234<Key, Value, Stats, Prefetch>::write_compressed(Sink& sink) const
+{
+   static_assert(std::is_integral_v<Key>, "tree234::serialize_compressed requires an integral Key");
+   static_assert(std::is_trivially_copyable_v<Value>, "tree234::serialize_compressed requires a trivially copyable Value");
+
+   constexpr bool integral_value = std::is_integral_v<Value>;
+
+   sink.put(compressed_header{compressed_magic, compressed_version, sizeof(Key), sizeof(Value), static_cast<std::uint64_t>(tree_size),
+                              compressed_block, integral_value ? 1u : 0u});
+
+   std::array<std::uint64_t, compressed_block> keys, values, deltas;
+   std::array<Value, compressed_block> raw_values;
+   std::array<unsigned char, compressed_block * 8> packed;
+
+   std::size_t count = 0;
+   bool first_block = true;
+   std::uint64_t previous = 0; // last key of the previous block
+
+   auto bits_for = [](std::uint64_t max) { return static_cast<int>(std::bit_width(max)); };
+
+   auto flush_block = [&] {
+
+      put_varint(sink, first_block ? keys[0] : keys[0] - previous - 1);
+
+      std::uint64_t max_delta = 0;
+
+      for (std::size_t i = 1; i < count; ++i) {
+
+          deltas[i - 1] = keys[i] - keys[i - 1] - 1;
+          max_delta |= deltas[i - 1];
+      }
+
+      auto key_bits = bits_for(max_delta);
+
+      sink.template put<std::uint8_t>(key_bits);
+
+      pack_bits(deltas.data(), count - 1, key_bits, packed.data());
+      sink.write(packed.data(), packed_bytes(count - 1, key_bits));
+
+      if constexpr (integral_value) {
+
+          auto min = *std::min_element(values.begin(), values.begin() + count);
+          std::uint64_t spread = 0;
+
+          for (std::size_t i = 0; i < count; ++i) {
+
+              values[i] -= min;
+              spread |= values[i];
+          }
+
+          auto value_bits = bits_for(spread);
+
+          put_varint(sink, min);
+          sink.template put<std::uint8_t>(value_bits);
+
+          pack_bits(values.data(), count, value_bits, packed.data());
+          sink.write(packed.data(), packed_bytes(count, value_bits));
+
+      } else {
+
+          sink.write(raw_values.data(), count * sizeof(Value));
+      }
+
+      previous = keys[count - 1];
+      first_block = false;
+      count = 0;
+   };
+
+   auto add = [&](const value_type& pair) {
+
+      keys[count] = to_ordered(pair.first);
+
+      if constexpr (integral_value) values[count] = to_ordered(pair.second);
+      else raw_values[count] = pair.second;
+
+      if (++count == compressed_block) flush_block();
+   };
+
+   if (root) visit_in_order(root.get(), add);
+
+   if (count > 0) flush_block();
+}
+
+/*
+ * The pairs are decoded one block at a time into a small buffer from which build_subtree() takes them, so loading needs no memory beyond the
+ * nodes themselves.
+ */
+template<typename Key, typename Value, typename Stats, typename Prefetch> template<typename Source> void tree234<Key, Value, Stats, Prefetch>::read_compressed(Source& source)
+{
+   static_assert(std::is_integral_v<Key>, "tree234::deserialize_compressed requires an integral Key");
+   static_assert(std::is_trivially_copyable_v<Value>, "tree234::deserialize_compressed requires a trivially copyable Value");
+
+   constexpr bool integral_value = std::is_integral_v<Value>;
+
+   auto header = source.template get<compressed_header>();
+
+   if (header.magic != compressed_magic || header.version != compressed_version) 
+       throw std::runtime_error("tree234::deserialize_compressed: not a compressed tree234 snapshot");
+
+   if (header.key_size != sizeof(Key) || header.value_size != sizeof(Value) || header.value_encoding != (integral_value ? 1u : 0u)) 
+       throw std::runtime_error("tree234::deserialize_compressed: snapshot was written for different Key or Value types");
+
+   if (header.block_size != compressed_block || header.size > static_cast<std::uint64_t>(std::numeric_limits<int>::max())) 
+       throw std::runtime_error("tree234::deserialize_compressed: corrupt snapshot header");
+
+   constexpr std::uint64_t key_max = std::numeric_limits<std::make_unsigned_t<Key>>::max();
+
+   std::array<std::pair<Key, Value>, compressed_block> block;
+   std::array<std::uint64_t, compressed_block> fields;
+   std::array<unsigned char, compressed_block * 8> packed;
+
+   std::size_t position = 0, count = 0;
+   std::uint64_t remaining = header.size;
+   bool first_block = true;
+   std::uint64_t previous = 0;
+
+   auto read_packed = [&](std::size_t n, int bits, int max_bits) {
+
+      if (bits > max_bits) throw std::runtime_error("tree234::deserialize_compressed: corrupt block");
+
+      source.read(packed.data(), packed_bytes(n, bits));
+      unpack_bits(packed.data(), n, bits, fields.data());
+   };
 
-  } // end else
-}
+   auto decode_block = [&] {
 
-// copy assignment
-template<typename Key, typename Value> inline tree234<Key, Value>& tree234<Key, Value>::operator=(const tree234& lhs) noexcept 
-{
-  if (this == &lhs)  {
-      
-      return *this;
-  }
-  
-  destroy_subtree(root); // free all the nodes of the current tree 
+      count = static_cast<std::size_t>(std::min<std::uint64_t>(remaining, compressed_block));
 
-  tree_size = lhs.tree_size;
+      auto gap = get_varint(source);
 
-  copy_tree(lhs.root, root);
+      if (!first_block && (previous == key_max || gap > key_max - previous - 1)) throw std::runtime_error("tree234::deserialize_compressed: keys out of range");
 
-  return *this;
-}
+      std::uint64_t key = first_block ? gap : previous + 1 + gap;
 
+      if (key > key_max) throw std::runtime_error("tree234::deserialize_compressed: keys out of range");
 
-template<typename Key, typename Value> inline void tree234<Key, Value>::Node::printKeys(std::ostream& ostr)
-{
-  ostr << "["; 
+      block[0].first = from_ordered<Key>(key);
 
-  for(auto i = 0; i < getTotalItems(); ++i) {
+      read_packed(count - 1, source.template get<std::uint8_t>(), 8 * sizeof(Key));
 
-      ostr << keys_values[i].__get_value().first;
+      for (std::size_t i = 1; i < count; ++i) {
 
-      if (i < get_lastkey_index()) { //getTotalItems() - 1)       {
+          if (key == key_max || fields[i - 1] > key_max - key - 1) throw std::runtime_error("tree234::deserialize_compressed: keys out of range");
 
-         ostr << ", ";
-      } 
-  }
+          key += fields[i - 1] + 1;
+          block[i].first = from_ordered<Key>(key);
+      }
 
-  ostr << "]";
-}
+      if constexpr (integral_value) {
 
-template<typename Key, typename Value> inline constexpr int tree234<Key, Value>::Node::getTotalItems() const noexcept
-{
-   return totalItems; 
-}
+          auto min = get_varint(source);
 
-template<typename Key, typename Value> inline constexpr int tree234<Key, Value>::Node::getChildCount() const noexcept
-{
-   return totalItems + 1; 
-}
+          read_packed(count, source.template get<std::uint8_t>(), 8 * sizeof(Value));
 
-template<typename Key, typename Value> inline constexpr bool tree234<Key, Value>::Node::isTwoNode() const noexcept
-{
-   return (totalItems == static_cast<int>(NodeType::two_node)) ? true : false;
-}
+          for (std::size_t i = 0; i < count; ++i) block[i].second = from_ordered<Value>(min + fields[i]);
 
-template<typename Key, typename Value> inline constexpr bool tree234<Key, Value>::Node::isThreeNode() const noexcept
-{
-   return (totalItems == static_cast<int>(NodeType::three_node)) ? true : false;
-}
+      } else {
 
-template<typename Key, typename Value> inline constexpr bool tree234<Key, Value>::Node::isFourNode() const noexcept
-{
-   return (totalItems == static_cast<int>(NodeType::four_node)) ? true : false;
-}
+          for (std::size_t i = 0; i < count; ++i) source.read(&block[i].second, sizeof(Value));
+      }
 
-template<typename Key, typename Value> inline constexpr bool tree234<Key, Value>::Node::isEmpty() const noexcept
-{
-   return (totalItems == 0) ? true : false;
-}
+      previous = key;
+      first_block = false;
+      remaining -= count;
+      position = 0;
+   };
 
-template<typename Key, typename Value> inline constexpr int tree234<Key, Value>::size() const
-{
-  return tree_size;
-}
-             
-template<typename Key, typename Value> inline int tree234<Key, Value>::height() const noexcept
-{
-  int depth = 0;
+   auto next = [&]() -> std::pair<Key, Value>& {
 
-  for (auto current = root.get(); current; current = current->children[0].get()) {
+      if (position == count) decode_block();
 
-       ++depth;
-  }
+      return block[position++];
+   };
 
-  return depth;
-}
-// Move assignment operator
-template<typename Key, typename Value> inline tree234<Key, Value>& tree234<Key, Value>::operator=(tree234&& lhs) noexcept 
-{
-    tree_size = lhs.tree_size;
+   std::unique_ptr<Node> new_root;
 
-    lhs.tree_size = 0;
+   if (header.size > 0) {
 
-    root = std::move(lhs.root);
+       new_root = build_subtree(next, header.size, bulk_height(header.size));
+       new_root->parent = nullptr;
+   }
 
-    root->parent = nullptr;
+   release_nodes(root);
+
+   root = std::move(new_root);
+   tree_size = static_cast<int>(header.size);
 }
-/*
- * F is a functor whose function call operator takes a 1.) const Node * and an 2.) int, indicating the depth of the node from the root,
- * which has depth 1.
- */
-template<typename Key, typename Value> template<typename Functor> void tree234<Key, Value>::levelOrderTraverse(Functor f) const noexcept
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> void tree234<Key, Value, Stats, Prefetch>::serialize_compressed(std::vector<char>& buffer) const
 {
-   if (!root.get()) return;
-   
-   // pair of: 1. const Node * and 2. level of tree.
-   std::queue<std::pair<const Node*, int>> queue; 
+   vector_sink sink{buffer};
 
-   auto level = 1;
+   write_compressed(sink);
+}
 
-   queue.push({root.get(), level});
+template<typename Key, typename Value, typename Stats, typename Prefetch> void tree234<Key, Value, Stats, Prefetch>::serialize_compressed(std::ostream& ostr) const
+{
+   stream_sink sink{ostr};
 
-   while (!queue.empty()) {
+   write_compressed(sink);
 
-        auto& [pnode, tree_level] = queue.front(); 
+   sink.flush();
+}
 
-        f(pnode, tree_level); // Call functor 
-         
-        if (!pnode->isLeaf()) { // If it was not a leaf node, push its children onto the queue
-            
-            for(auto i = 0; i < pnode->getChildCount(); ++i) {
+template<typename Key, typename Value, typename Stats, typename Prefetch> std::size_t tree234<Key, Value, Stats, Prefetch>::deserialize_compressed(std::span<const char> buffer)
+{
+   span_source source{buffer};
 
-               queue.push({pnode->children[i].get(), tree_level + 1});  
-            }
-        }
+   read_compressed(source);
 
-        queue.pop(); // Remove the node used in the call to functor f above.
-   }
+   return source.consumed();
 }
-/*
- * This method allows the tree to be traversed in-order step-by-step
- */
-template<typename Key, typename Value> template<typename Functor> inline void tree234<Key, Value>::iterativeInOrderTraverse(Functor f) const noexcept
-{
-   const Node *current = min(root.get());
-   int key_index = 0;
 
-   while (current)  {
- 
-      f(current->pair(key_index)); 
+// Blocks have no length prefix, so the stream is read unbuffered to leave anything that follows the snapshot unread.
+template<typename Key, typename Value, typename Stats, typename Prefetch> void tree234<Key, Value, Stats, Prefetch>::deserialize_compressed(std::istream& istr)
+{
+   istream_source source{istr};
 
-      //std::pair<const Node *, int> pair = getSuccessor(current, key_index);  
-      auto &&[next_pnode, next_index] = getSuccessor(current, key_index);  
-  
-      current = next_pnode; 
-      key_index = next_index;
-  }
+   read_compressed(source);
 }
+
 /*
  * Return the node with the "smallest" key in the tree, the left most left node.
  */
-template<typename Key, typename Value> inline const typename tree234<Key, Value>::Node *tree234<Key, Value>::min(const Node *current) const noexcept
+template<typename Key, typename Value, typename Stats, typename Prefetch> inline const typename tree234<Key, Value, Stats, Prefetch>::Node *tree234<Key, Value, Stats, Prefetch>::min(const Node *current) const noexcept
 {
    while (current->children[0]) 
 
@@ -1090,7 +3081,7 @@ template<typename Key, typename Value> inline const typename tree234<Key, Value>
 /*
  * Return the node with the largest key in the tree, the right most left node.
  */
-template<typename Key, typename Value> inline const typename tree234<Key, Value>::Node *tree234<Key, Value>::max(const Node *current) const noexcept
+template<typename Key, typename Value, typename Stats, typename Prefetch> inline const typename tree234<Key, Value, Stats, Prefetch>::Node *tree234<Key, Value, Stats, Prefetch>::max(const Node *current) const noexcept
 {
    while (current->getRightMostChild()) 
 
@@ -1099,29 +3090,120 @@ template<typename Key, typename Value> inline const typename tree234<Key, Value>
    return current;
 }
 
-template<typename Key, typename Value> template<typename Functor> inline void tree234<Key, Value>::inOrderTraverse(Functor f) const noexcept
+template<typename Key, typename Value, typename Stats, typename Prefetch> template<typename Functor> inline void tree234<Key, Value, Stats, Prefetch>::inOrderTraverse(Functor f) const noexcept
 {
    DoInOrderTraverse(f, root.get());
 }
 
-template<typename Key, typename Value> template<typename Functor> inline void tree234<Key, Value>::postOrderTraverse(Functor f) const noexcept
+template<typename Key, typename Value, typename Stats, typename Prefetch> template<typename Functor> inline void tree234<Key, Value, Stats, Prefetch>::rangeTraverse(const Key& first, const Key& last, Functor f) const
+{
+   auto visit = [&f](const value_type& pair) { f(pair); return true; };
+
+   if (root && first < last) DoRangeTraverse(visit, first, last, root.get());
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> template<typename Functor> bool tree234<Key, Value, Stats, Prefetch>::DoRangeTraverse(Functor& f, const Key& first, const Key& last, const Node *pnode)
+{
+   prefetch_children(pnode);
+
+   for (auto i = 0; i <= pnode->getTotalItems(); ++i) {
+
+       bool has_key = i < pnode->getTotalItems();
+
+       // Child i holds the keys between key(i - 1) and key(i); skip it if they are all less than first.
+       if (!pnode->isLeaf() && (!has_key || first < pnode->key(i))) 
+           if (!DoRangeTraverse(f, first, last, pnode->children[i].get())) return false;
+
+       if (!has_key) break;
+
+       const auto& pair = pnode->get_value(i);
+
+       if (!(pair.first < last)) return false;
+
+       if (!(pair.first < first) && !f(pair)) return false;
+   }
+
+   return true;
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> template<typename Functor> inline void tree234<Key, Value, Stats, Prefetch>::postOrderTraverse(Functor f) const noexcept
 {
    DoPostOrderTraverse(f, root);
 }
 
-template<typename Key, typename Value> template<typename Functor> inline void tree234<Key, Value>::preOrderTraverse(Functor f) const noexcept
+template<typename Key, typename Value, typename Stats, typename Prefetch> template<typename Functor> inline void tree234<Key, Value, Stats, Prefetch>::preOrderTraverse(Functor f) const noexcept
 {
    DoPreOrderTraverse(f, root.get());
 }
 
-template<typename Key, typename Value> template<typename Functor> inline void tree234<Key, Value>::debug_dump(Functor f) noexcept
+template<typename Key, typename Value, typename Stats, typename Prefetch> template<typename Functor> inline void tree234<Key, Value, Stats, Prefetch>::debug_dump(Functor f) noexcept
 {
    DoPostOrder4Debug(f, root.get());
 }
+template<typename Key, typename Value, typename Stats, typename Prefetch> void tree234<Key, Value, Stats, Prefetch>::release_nodes(std::unique_ptr<Node>& subtree) noexcept
+{
+   if (!subtree) return;
+
+   if (deferred_destruction) {
+
+       Node *pnode = subtree.release();
+
+       if (background_reclaimer::retire([pnode] { std::unique_ptr<Node> doomed{pnode}; destroy_subtree_iterative(doomed); })) 
+           return;
+
+       subtree.reset(pnode); // The reclaimer has shut down, so free the nodes here.
+   }
+
+   destroy_subtree_iterative(subtree);
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> inline void tree234<Key, Value, Stats, Prefetch>::clear() noexcept
+{
+   release_nodes(root);
+   tree_size = 0;
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> void tree234<Key, Value, Stats, Prefetch>::clear(destroy_algorithm algorithm) noexcept
+{
+   if (algorithm == destroy_algorithm::recursive) destroy_subtree(root);
+   else destroy_subtree_iterative(root);
+
+   tree_size = 0;
+}
+
+/*
+ * A node popped from pending releases its children onto the stack before it is freed. A node pushes at most four children and pops itself,
+ * so the stack never holds more than three per level plus one.
+ */
+template<typename Key, typename Value, typename Stats, typename Prefetch> void tree234<Key, Value, Stats, Prefetch>::destroy_subtree_iterative(std::unique_ptr<Node>& subtree) noexcept
+{
+   constexpr int max_height = 32;
+
+   if (!subtree) return;
+
+   assert(subtree_height(subtree.get()) <= max_height); // pending is sized for it
+
+   std::array<Node *, 3 * max_height + 1> pending;
+   int top = 0;
+
+   pending[top++] = subtree.release();
+
+   while (top > 0) {
+
+       Node *current = pending[--top];
+
+       if (!current->isLeaf()) 
+           for (auto i = 0; i < current->getChildCount(); ++i) 
+                pending[top++] = current->children[i].release();
+
+       delete current;
+   }
+}
+
 /*
  * Calls functor on each node in post order. Uses recursion.
  */
-template<typename Key, typename Value> void tree234<Key, Value>::destroy_subtree(std::unique_ptr<Node>& current) noexcept
+template<typename Key, typename Value, typename Stats, typename Prefetch> void tree234<Key, Value, Stats, Prefetch>::destroy_subtree(std::unique_ptr<Node>& current) noexcept
 {  
    if (!current) return;
 
@@ -1162,7 +3244,7 @@ template<typename Key, typename Value> void tree234<Key, Value>::destroy_subtree
  * Calls functor on each node in post order. Uses recursion.
  */
 
-template<typename Key, typename Value> template<typename Functor> void tree234<Key, Value>::DoPostOrderTraverse(Functor f, const Node *current) const noexcept
+template<typename Key, typename Value, typename Stats, typename Prefetch> template<typename Functor> void tree234<Key, Value, Stats, Prefetch>::DoPostOrderTraverse(Functor f, const Node *current) const noexcept
 {  
    if (!current) return;
 
@@ -1210,7 +3292,7 @@ template<typename Key, typename Value> template<typename Functor> void tree234<K
 /* 
  * Calls functor on each node in pre order. Uses recursion.
  */
-template<typename Key, typename Value> template<typename Functor> void tree234<Key, Value>::DoPreOrderTraverse(Functor f, const Node *current) const noexcept
+template<typename Key, typename Value, typename Stats, typename Prefetch> template<typename Functor> void tree234<Key, Value, Stats, Prefetch>::DoPreOrderTraverse(Functor f, const Node *current) const noexcept
 {  
 
    if (!current) return;
@@ -1260,10 +3342,12 @@ template<typename Key, typename Value> template<typename Functor> void tree234<K
 /*
  * Calls functor on each node in in-order traversal. Uses recursion.
  */
-template<typename Key, typename Value> template<typename Functor> void tree234<Key, Value>::DoInOrderTraverse(Functor f, const Node *current) const noexcept
+template<typename Key, typename Value, typename Stats, typename Prefetch> template<typename Functor> void tree234<Key, Value, Stats, Prefetch>::DoInOrderTraverse(Functor f, const Node *current) const noexcept
 {     
    if (!current) return;
 
+   prefetch_children(current);
+
    switch (current->getTotalItems()) {
 
       case 1: // two node
@@ -1314,7 +3398,7 @@ template<typename Key, typename Value> template<typename Functor> void tree234<K
  *    children[childIndex]->parent = this; 
  *  
  */
-template<typename Key, typename Value> inline void  tree234<Key, Value>::Node::connectChild(int childIndex, std::unique_ptr<Node>& child)  noexcept
+template<typename Key, typename Value, typename Stats, typename Prefetch> inline void  tree234<Key, Value, Stats, Prefetch>::Node::connectChild(int childIndex, std::unique_ptr<Node>& child)  noexcept
 {
   children[childIndex] = std::move( child ); 
   
@@ -1330,7 +3414,7 @@ template<typename Key, typename Value> inline void  tree234<Key, Value>::Node::c
  * Note: disconnectChild() must always be called before removeItem(); otherwise, it will not work correctly (because totalItems
  * will have been altered).
  */
-template<typename Key, typename Value> inline std::unique_ptr<typename tree234<Key, Value>::Node> tree234<Key, Value>::Node::disconnectChild(int childIndex) noexcept // ok
+template<typename Key, typename Value, typename Stats, typename Prefetch> inline std::unique_ptr<typename tree234<Key, Value, Stats, Prefetch>::Node> tree234<Key, Value, Stats, Prefetch>::Node::disconnectChild(int childIndex) noexcept // ok
 {
   std::unique_ptr<Node> node{ std::move(children[childIndex] ) }; // invokes unique_ptr<Node> move ctor.
 
@@ -1348,7 +3432,7 @@ template<typename Key, typename Value> inline std::unique_ptr<typename tree234<K
  * If key found n this Node, we return this tuple: {true, pointer to node containing key, the index into Node::key_values of the key}.
  * If key is not found, we return this tuple: {false, pointer to next child with which to continue the downward search of the tree, 0}. 
  */
-template<class Key, class Value> inline std::tuple<bool, typename tree234<Key, Value>::Node *, int> tree234<Key, Value>::Node::find(Key lhs_key) const noexcept 
+template<class Key, class Value, class Stats, class Prefetch> inline std::tuple<bool, typename tree234<Key, Value, Stats, Prefetch>::Node *, int> tree234<Key, Value, Stats, Prefetch>::Node::find(const Key& lhs_key) const noexcept 
 {
   for(auto i = 0; i < getTotalItems(); ++i) {
 
@@ -1370,7 +3454,7 @@ template<class Key, class Value> inline std::tuple<bool, typename tree234<Key, V
 /*
  * Input: Assumes that "this" is never the root (because the parent of the root is always the nullptr).
  */
-template<class Key, class Value> int tree234<Key, Value>::Node::getChildIndex() const noexcept
+template<class Key, class Value, class Stats, class Prefetch> int tree234<Key, Value, Stats, Prefetch>::Node::getChildIndex() const noexcept
 {
   // Determine child_index such that this == this->parent->children[child_index]
   int child_index = 0;
@@ -1384,7 +3468,7 @@ template<class Key, class Value> int tree234<Key, Value>::Node::getChildIndex()
   return child_index;
 }
 
-template<typename Key, typename Value> inline constexpr  bool tree234<Key, Value>::Node::isLeaf() const  noexcept // ok
+template<typename Key, typename Value, typename Stats, typename Prefetch> inline constexpr  bool tree234<Key, Value, Stats, Prefetch>::Node::isLeaf() const  noexcept // ok
 { 
    return !children[0] ? true : false;
 }
@@ -1392,25 +3476,115 @@ template<typename Key, typename Value> inline constexpr  bool tree234<Key, Value
 /*
  * Recursive version of find
  */
-template<typename Key, typename Value> inline bool tree234<Key, Value>::find(Key key) const noexcept
+template<typename Key, typename Value, typename Stats, typename Prefetch> inline bool tree234<Key, Value, Stats, Prefetch>::find(const Key& key) const noexcept
 {
+    operation_scope scope{counters, &tree234_stats::find};
+
     return find(root.get(), key); 
 } 
+template<typename Key, typename Value, typename Stats, typename Prefetch> std::size_t tree234<Key, Value, Stats, Prefetch>::find_batch(std::span<const Key> keys, std::span<const Value *> results) const
+{
+   operation_scope scope{counters, &tree234_stats::find};
+
+   auto count = std::min(keys.size(), results.size());
+
+   if (!root) {
+
+      std::fill_n(results.begin(), count, nullptr);
+      return 0;
+   }
+
+   // A lookup in flight: the index of its key, and the node it reads on its next turn, which has been prefetched.
+   struct lookup {
+      std::size_t index;
+      const Node *pnode;
+   };
+
+   std::array<lookup, find_batch_width> group;
+
+   std::size_t next = 0, active = 0, found = 0;
+
+   for (; active < group.size() && next < count; ++active, ++next) group[active] = {next, root.get()};
+
+   while (active > 0) {
+
+      for (std::size_t slot = 0; slot < active; ) {
+
+          auto& [index, pnode] = group[slot];
+
+          counters.visit();
+
+          const Key& key = keys[index];
+
+          auto i = 0;
+          auto hit = false;
+
+          for (; i < pnode->getTotalItems(); ++i) {
+
+              if (less(key, pnode->key(i))) break;
+
+              if (equal(key, pnode->key(i))) {
+                  hit = true;
+                  break;
+              }
+          }
+
+          if (!hit && !pnode->isLeaf()) {
+
+              pnode = pnode->children[i].get();
+
+              prefetch_nodes::node(pnode, sizeof(Node)); // whatever the Prefetch policy: this is what overlaps the lookups
+
+              ++slot;
+              continue;
+          }
+
+          results[index] = hit ? &pnode->get_value(i).second : nullptr;
+          found += hit;
+
+          if (next < count) { // the slot takes the next key
+
+              group[slot] = {next++, root.get()};
+              ++slot;
+
+          } else // the last slot, which has not had its turn yet, moves into this one
+
+              group[slot] = group[--active];
+      }
+   }
+
+   return found;
+}
+
+template<typename Key, typename Value, typename Stats, typename Prefetch> inline void tree234<Key, Value, Stats, Prefetch>::prefetch_children(const Node *pnode) noexcept
+{
+   if constexpr (Prefetch::enabled) {
+
+      if (pnode->isLeaf()) return;
+
+      for (auto i = 0; i <= pnode->getTotalItems(); ++i) Prefetch::node(pnode->children[i].get(), sizeof(Node));
+   }
+}
+
 /*
  * Recursive main find method. Return true if found, false otherwise.
  */
-template<typename Key, typename Value> bool tree234<Key, Value>::find(const Node *pnode, Key key) const noexcept
+template<typename Key, typename Value, typename Stats, typename Prefetch> bool tree234<Key, Value, Stats, Prefetch>::find(const Node *pnode, const Key& key) const noexcept
 {
    if (!pnode) return false;
+
+   counters.visit();
+
+   prefetch_children(pnode);
    
    auto i = 0;
    
    for (;i < pnode->getTotalItems(); ++i) {
 
-      if (key < pnode->key(i)) 
+      if (less(key, pnode->key(i))) 
          return find(pnode->children[i].get(), key); 
     
-      else if (key == pnode->key(i)) 
+      else if (equal(key, pnode->key(i))) 
          return true;
    }
 
@@ -1421,7 +3595,7 @@ template<typename Key, typename Value> bool tree234<Key, Value>::find(const Node
  * Preconditions: node is not a four node, and key is not present in node.
  * Purpose: Shifts keys_values needed so key can be inserted in sorted position. Returns index of inserted key.
  */
-template<typename Key, typename Value> int  tree234<Key, Value>::Node::insert(const Key& lhs_key, const Value& lhs_value)  noexcept // ok. Maybe add a move version, too: insertKey(Key, Value&&)
+template<typename Key, typename Value, typename Stats, typename Prefetch> int  tree234<Key, Value, Stats, Prefetch>::Node::insert(const Key& lhs_key, const Value& lhs_value)  noexcept // ok. Maybe add a move version, too: insertKey(Key, Value&&)
 { 
    // start on right, examine items
    for(auto i = get_lastkey_index(); i >= 0 ; --i) {
@@ -1449,7 +3623,7 @@ template<typename Key, typename Value> int  tree234<Key, Value>::Node::insert(co
 /*
  * Inserts key_value pair into its sorted position in this Node and makes largerNode its right most child.
  */
-template<typename Key, typename Value> void tree234<Key, Value>::Node::insert(__value_type<Key, Value>&& vt_in, std::unique_ptr<Node>& largerNode) noexcept 
+template<typename Key, typename Value, typename Stats, typename Prefetch> void tree234<Key, Value, Stats, Prefetch>::Node::insert(__value_type<Key, Value>&& vt_in, std::unique_ptr<Node>& largerNode) noexcept 
 { 
   // start on right, examine items
   for(auto i = get_lastkey_index(); i >= 0 ; --i) {
@@ -1481,7 +3655,7 @@ template<typename Key, typename Value> void tree234<Key, Value>::Node::insert(__
 /*
  Input: A new child to insert at child index position insert_index. The current number of children currently is given by children_num.
  */
-template<typename Key, typename Value> void tree234<Key, Value>::Node::insertChild(int insert_index, std::unique_ptr<Node>& newChild) noexcept
+template<typename Key, typename Value, typename Stats, typename Prefetch> void tree234<Key, Value, Stats, Prefetch>::Node::insertChild(int insert_index, std::unique_ptr<Node>& newChild) noexcept
 {
    // While Node::totalItems reflects the correct number of keys, the number of children currently is also equal to the number of keys.
 
@@ -1519,17 +3693,21 @@ template<typename Key, typename Value> void tree234<Key, Value>::Node::insertChi
  *
  * Special case: If the root holds the key to be deleted, we meris a 2-node
  */
-template<class Key, class Value> bool tree234<Key, Value>::remove(Key key) 
+template<class Key, class Value, class Stats, class Prefetch> bool tree234<Key, Value, Stats, Prefetch>::remove(const Key& key) 
 {
+   operation_scope scope{counters, &tree234_stats::remove};
+
    if (!root) return false; 
 
    else if (root->isLeaf()) { 
+
+      counters.visit();
        
       int index = 0;
       
       for (; index < root->getTotalItems(); ++index) {
 
-          if (root->key(index) == key) {
+          if (equal(root->key(index), key)) {
 
              // Remove key from root and puts its in-order successor (if it exists) into its place. 
              root->removeKeyValue(index); 
@@ -1556,7 +3734,7 @@ template<class Key, class Value> bool tree234<Key, Value>::remove(Key key)
   }
 }
 
-template<typename Key, typename Value> inline __value_type<Key, Value> tree234<Key, Value>::Node::removeKeyValue(int index) noexcept 
+template<typename Key, typename Value, typename Stats, typename Prefetch> inline __value_type<Key, Value> tree234<Key, Value, Stats, Prefetch>::Node::removeKeyValue(int index) noexcept 
 {
   __value_type<Key, Value> key_value = std::move(keys_values[index]);  // Return value
 
@@ -1570,16 +3748,29 @@ template<typename Key, typename Value> inline __value_type<Key, Value> tree234<K
 
   return key_value;
 }
+
+template<class Key, class Value, class Stats, class Prefetch> bool tree234<Key, Value, Stats, Prefetch>::node_stores(const Node *pnode, const Key& key) noexcept
+{
+  for (auto i = 0; i < pnode->getTotalItems(); ++i)
+      if (&pnode->key(i) == &key) return true;
+
+  return false;
+}
+
 /*
  * Input: right subtree from which to remove key. 
  * Return: true if key removed. false if key not found.
  */
-template<class Key, class Value> bool tree234<Key, Value>::remove(Node *psubtree, Key key)
+template<class Key, class Value, class Stats, class Prefetch> bool tree234<Key, Value, Stats, Prefetch>::remove(Node *psubtree, const Key& key_in)
 {
-  auto [found, pdelete, delete_index] = find_delete_node(psubtree, key); 
+  std::optional<Key> key_copy;
+
+  auto [found, pdelete, delete_index] = find_delete_node(psubtree, key_in, key_copy); 
   
   if (!found) return false;
 
+  const Key& key = key_copy ? *key_copy : key_in;
+
   if (pdelete->isLeaf()) {
 
        // Remove from leaf node
@@ -1602,41 +3793,64 @@ template<class Key, class Value> bool tree234<Key, Value>::remove(Node *psubtree
   Input: Node * and its child index in parent
   Return: {bool: found/not found, Node *pFound, int key_index within pFound}
 */
-template<class Key, class Value> std::tuple<bool, typename tree234<Key, Value>::Node *, int>   tree234<Key, Value>::find_delete_node(Node *pcurrent, Key delete_key, int child_index) noexcept
+template<class Key, class Value, class Stats, class Prefetch> std::tuple<bool, typename tree234<Key, Value, Stats, Prefetch>::Node *, int>   tree234<Key, Value, Stats, Prefetch>::find_delete_node(Node *pcurrent, const Key& delete_key, std::optional<Key>& key_copy, int child_index)
 {
   if (nullptr == pcurrent)
        return {false, pcurrent, 0};
 
+  /*
+   * delete_key may be stored in the tree, as in remove(iter->first). It was not found above pcurrent, so it can only be in pcurrent or deeper,
+   * and converting pcurrent moves only pcurrent's own key among the keys there (make4Node(), at the root, also the keys of its two children).
+   * So only those are compared with it, by address, and a delete_key stored in one is copied before the conversion.
+   */
+  bool root_fusion = pcurrent == root.get() && pcurrent->isTwoNode() && root->children[0]->isTwoNode() && root->children[1]->isTwoNode();
+
+  if (!key_copy && pcurrent->isTwoNode() && (&pcurrent->key(0) == &delete_key ||
+                   (root_fusion && (node_stores(root->children[0].get(), delete_key) || node_stores(root->children[1].get(), delete_key))))) {
+
+      key_copy.emplace(delete_key);
+
+      return find_delete_node(pcurrent, *key_copy, key_copy, child_index);
+  }
+
+  counters.visit();
+
   if (pcurrent->isTwoNode()) {
 
        // Special case: root is a 2-node with two 2-node children.
-       if (pcurrent == root.get() && root->children[0]->isTwoNode() && root->children[1]->isTwoNode()) 
+       if (root_fusion) {
 
+            counters.count(&tree234_stats::root_make4Node);
             pcurrent->make4Node();
 
-       else if (pcurrent != root.get()) 
+       } else if (pcurrent != root.get()) 
 
             convert2Node(pcurrent, child_index);
   }
 
+  prefetch_children(pcurrent);
+
   // Search for it, and if found, return it.
   auto i = 0; 
   
   for(;i < pcurrent->getTotalItems(); ++i) {
 
-      if (delete_key == pcurrent->key(i)) 
+      if (equal(delete_key, pcurrent->key(i))) {
+
+          // Found delete_key to be deleted is at pcurrent->key(i). get_delete_successor() may move it, so if delete_key is that key, copy it.
+          if (!key_copy && &pcurrent->key(i) == &delete_key) key_copy.emplace(delete_key);
 
-         // Found delete_key to be deleted is at pcurrent->key(i).
           return {true, pcurrent, i}; 
+      }
 
-      if (delete_key < pcurrent->key(i)) 
+      if (less(delete_key, pcurrent->key(i))) 
 
           // Recurse with left child of pcurrent. 
-          return find_delete_node(pcurrent->children[i].get(), delete_key, i);
+          return find_delete_node(pcurrent->children[i].get(), delete_key, key_copy, i);
   }
 
   // If not found and delete_key is larger than all keys, recurse with right most child
-  return find_delete_node(pcurrent->children[i].get(), delete_key, i);
+  return find_delete_node(pcurrent->children[i].get(), delete_key, key_copy, i);
 }
 
 /*
@@ -1651,8 +3865,8 @@ template<class Key, class Value> std::tuple<bool, typename tree234<Key, Value>::
  *   - along with the index of key to be deleted,
  *   - pointer to successor.
  */
-template<class Key, class Value> std::tuple<typename tree234<Key, Value>::Node *, int, typename tree234<Key, Value>::Node *> 
-tree234<Key, Value>::get_delete_successor(Node *pdelete, Key delete_key, int delete_key_index) noexcept
+template<class Key, class Value, class Stats, class Prefetch> std::tuple<typename tree234<Key, Value, Stats, Prefetch>::Node *, int, typename tree234<Key, Value, Stats, Prefetch>::Node *> 
+tree234<Key, Value, Stats, Prefetch>::get_delete_successor(Node *pdelete, const Key& delete_key, int delete_key_index) noexcept
 {
   // Get pointer to right subtree.
   auto child_index = delete_key_index + 1;
@@ -1679,7 +3893,7 @@ tree234<Key, Value>::get_delete_successor(Node *pdelete, Key delete_key, int del
        delete_key becomes the first key of rightSubtree.
      */
      
-      if (delete_key == rightSubtree->key(0) || delete_key == rightSubtree->key(1)) {              
+      if (equal(delete_key, rightSubtree->key(0)) || equal(delete_key, rightSubtree->key(1))) {              
 
          // ...reset delete_key_index, and...
          delete_key_index = (delete_key == rightSubtree->key(0)) ? 0 : 1;
@@ -1701,7 +3915,7 @@ tree234<Key, Value>::get_delete_successor(Node *pdelete, Key delete_key, int del
   return {pdelete, delete_key_index, psuccessor};
 }
 
-template<typename Key, typename Value> inline constexpr const typename tree234<Key, Value>::Node *tree234<Key, Value>::Node::getParent() const  noexcept // ok
+template<typename Key, typename Value, typename Stats, typename Prefetch> inline constexpr const typename tree234<Key, Value, Stats, Prefetch>::Node *tree234<Key, Value, Stats, Prefetch>::Node::getParent() const  noexcept // ok
 { 
    return parent;
 }
@@ -1721,8 +3935,10 @@ template<typename Key, typename Value> inline constexpr const typename tree234<K
  * we fuse the three together into a 4-node. In either case, we shift the children as required.
  * 
  */
-template<typename Key, typename Value> int tree234<Key, Value>::convert2Node(Node *pnode, int child_index)  noexcept
+template<typename Key, typename Value, typename Stats, typename Prefetch> int tree234<Key, Value, Stats, Prefetch>::convert2Node(Node *pnode, int child_index)  noexcept
 {   
+   counters.count(&tree234_stats::convert2Node);
+
    // Determine if any adjacent sibling has a 3- or 4-node, preferring the right adjacent sibling.
    auto [has3or4NodeSibling, sibling_index] = pnode->chooseSibling(child_index);
 
@@ -1735,7 +3951,7 @@ template<typename Key, typename Value> int tree234<Key, Value>::convert2Node(Nod
  * second -- contains the child index of the sibling to be used. 
  *
  */
-template<typename Key, typename Value> inline std::pair<bool, int>  tree234<Key, Value>::Node::chooseSibling(int child_index) const noexcept
+template<typename Key, typename Value, typename Stats, typename Prefetch> inline std::pair<bool, int>  tree234<Key, Value, Stats, Prefetch>::Node::chooseSibling(int child_index) const noexcept
 {
 
    int left_adjacent = child_index - 1;
@@ -1780,7 +3996,7 @@ template<typename Key, typename Value> inline std::pair<bool, int>  tree234<Key,
  * 1. Absorbs its children's keys_values as its own. 
  * 2. Makes its grandchildren its children.
  */
-template<typename Key, typename Value> typename tree234<Key, Value>::Node *tree234<Key, Value>::Node::make4Node() noexcept
+template<typename Key, typename Value, typename Stats, typename Prefetch> typename tree234<Key, Value, Stats, Prefetch>::Node *tree234<Key, Value, Stats, Prefetch>::Node::make4Node() noexcept
 {
    // move key of 2-node 
    keys_values[1] = std::move(keys_values[0]);
@@ -1812,8 +4028,10 @@ template<typename Key, typename Value> typename tree234<Key, Value>::Node *tree2
  * child_index, which is not changed at all. 
  *
  */
-template<typename Key, typename Value> int tree234<Key, Value>::make3Node(Node *p2node, int child_index, int sibling_index) noexcept
+template<typename Key, typename Value, typename Stats, typename Prefetch> int tree234<Key, Value, Stats, Prefetch>::make3Node(Node *p2node, int child_index, int sibling_index) noexcept
 {
+  counters.count(&tree234_stats::make3Node);
+
   auto parent = p2node->getParent();
 
   Node *psibling = parent->children[sibling_index].get();
@@ -1850,16 +4068,18 @@ template<typename Key, typename Value> int tree234<Key, Value>::make3Node(Node *
 /* 
  * Requires: sibling is to the left, therefore: parent->children[sibling_id]->keys_values[0] < parent->keys_values[index] < parent->children[node2_index]->keys_values[0]
  */
-template<typename Key, typename Value> typename tree234<Key, Value>::Node *tree234<Key, Value>::rightRotation(Node *p2node, Node *psibling, Node *parent, int parent_key_index) noexcept
+template<typename Key, typename Value, typename Stats, typename Prefetch> typename tree234<Key, Value, Stats, Prefetch>::Node *tree234<Key, Value, Stats, Prefetch>::rightRotation(Node *p2node, Node *psibling, Node *parent, int parent_key_index) noexcept
 {    
+   counters.count(&tree234_stats::rightRotation);
+
    // Add the parent's key to 2-node, making it a 3-node
   
    // 1. But first shift the 2-node's sole key right one position
-   p2node->keys_values[1] = p2node->keys_values[0];      
+   p2node->keys_values[1] = std::move(p2node->keys_values[0]);      
   
-   p2node->keys_values[0] = parent->keys_values[parent_key_index];  // 2. Now bring down parent key
+   p2node->keys_values[0] = std::move(parent->keys_values[parent_key_index]);  // 2. Now bring down parent key (overwritten below)
  
-   p2node->totalItems = static_cast<int>(tree234<Key, Value>::Node::NodeType::three_node); // 3. increase total items
+   p2node->totalItems = static_cast<int>(tree234<Key, Value, Stats, Prefetch>::Node::NodeType::three_node); // 3. increase total items
  
    int total_sibling_keys_values = psibling->getTotalItems(); 
   
@@ -1877,12 +4097,14 @@ template<typename Key, typename Value> typename tree234<Key, Value>::Node *tree2
 /* Requires: sibling is to the right therefore: parent->children[node2_index]->keys_values[0]  <  parent->keys_values[index] <  parent->children[sibling_id]->keys_values[0] 
  * Do a left rotation
  */ 
-template<typename Key, typename Value> typename tree234<Key, Value>::Node *tree234<Key, Value>::leftRotation(Node *p2node, Node *psibling, Node *parent, int parent_key_index) noexcept
+template<typename Key, typename Value, typename Stats, typename Prefetch> typename tree234<Key, Value, Stats, Prefetch>::Node *tree234<Key, Value, Stats, Prefetch>::leftRotation(Node *p2node, Node *psibling, Node *parent, int parent_key_index) noexcept
 {
+   counters.count(&tree234_stats::leftRotation);
+
    // pnode2->keys_values[0] doesn't change.
-   p2node->keys_values[1] = parent->keys_values[parent_key_index];  // 1. insert parent key making 2-node a 3-node
+   p2node->keys_values[1] = std::move(parent->keys_values[parent_key_index]);  // 1. insert parent key making 2-node a 3-node (overwritten below)
  
-   p2node->totalItems = static_cast<int>(tree234<Key, Value>::Node::NodeType::three_node);// 3. increase total items
+   p2node->totalItems = static_cast<int>(tree234<Key, Value, Stats, Prefetch>::Node::NodeType::three_node);// 3. increase total items
   
    std::unique_ptr<Node> pchild_of_sibling = psibling->disconnectChild(0); // disconnect first child of sibling.
  
@@ -1914,8 +4136,10 @@ template<typename Key, typename Value> typename tree234<Key, Value>::Node *tree2
  * 
  * Returns: child_index such that parent->children[child_index] == 'the converted 2-node'.
  */
-template<typename Key, typename Value> int tree234<Key, Value>::make4Node(Node *parent, int node2_index, int sibling_index) noexcept
+template<typename Key, typename Value, typename Stats, typename Prefetch> int tree234<Key, Value, Stats, Prefetch>::make4Node(Node *parent, int node2_index, int sibling_index) noexcept
 {
+  counters.count(&tree234_stats::make4Node);
+
   Node *p2node = parent->children[node2_index].get();
 
   auto child_index = node2_index;
@@ -1939,11 +4163,11 @@ template<typename Key, typename Value> int tree234<Key, Value>::make4Node(Node *
       // Now, add both the sibling's and parent's key to 2-node
 
       // 1. But first shift the 2-node's sole key right two positions
-      p2node->keys_values[2] = p2node->keys_values[0];      
+      p2node->keys_values[2] = std::move(p2node->keys_values[0]);      
 
       p2node->keys_values[1] = std::move(parent_key_value);  // 2. bring down parent key and value, ie, its pair<Key, Value>, so a move assignment operator must be invoked. 
 
-      p2node->keys_values[0] = psibling->keys_values[0]; // 3. insert adjacent sibling's sole key. 
+      p2node->keys_values[0] = std::move(psibling->keys_values[0]); // 3. insert adjacent sibling's sole key. 
  
       p2node->totalItems = 3; // 3. increase total items
 
@@ -2012,8 +4236,10 @@ template<typename Key, typename Value> int tree234<Key, Value>::make4Node(Node *
  * this newly created 2-node is made a child of the parent. The child indexes in the parent are adjusted to properly reflect the new relationships between these nodes.
  *
  */
-template<typename Key, typename Value> void tree234<Key, Value>::insert(const Key& new_key, const Value& value) noexcept 
+template<typename Key, typename Value, typename Stats, typename Prefetch> void tree234<Key, Value, Stats, Prefetch>::insert(const Key& new_key, const Value& value) noexcept 
 { 
+   operation_scope scope{counters, &tree234_stats::insert};
+
    if (!root) {
            
       root = std::make_unique<Node>(new_key, value); 
@@ -2038,22 +4264,30 @@ template<typename Key, typename Value> void tree234<Key, Value>::insert(const Ke
  * the leaf node where the new 'new_key' should be inserted, and it returns the pair {false, pnode_leaf_where_key_should_be_inserted}. If key was found,
  * it returns the pair {true, Node *pnode_where_key_found}.
  */
-template<class Key, class Value> std::tuple<bool, typename tree234<Key, Value>::Node *, int>  tree234<Key, Value>::find_insert_node(Node *pcurrent, Key new_key) noexcept
+template<class Key, class Value, class Stats, class Prefetch> std::tuple<bool, typename tree234<Key, Value, Stats, Prefetch>::Node *, int>  tree234<Key, Value, Stats, Prefetch>::find_insert_node(Node *pcurrent, const Key& new_key) noexcept
 {
+   counters.visit();
+
    if (pcurrent->isFourNode()) { 
 
-       if (pcurrent->key(1) == new_key) // First check the middle key because split() will move it into its parent.
+       if (equal(pcurrent->key(1), new_key)) // First check the middle key because split() will move it into its parent.
             return {true, pcurrent, 1}; 
 
+       // new_key may itself be stored here, as in insert(iter->first, value); split() would move it.
+       for (auto i = 0; i < pcurrent->getTotalItems(); ++i)
+           if (&pcurrent->key(i) == &new_key) return {true, pcurrent, i};
+
        // split pcurrent into two 2-nodes and set pcurrent to the Node to examine next(int the loop below).
        pcurrent = split(pcurrent, new_key); 
    }
 
+   prefetch_children(pcurrent);
+
    auto i = 0;
 
    for(; i < pcurrent->getTotalItems(); ++i) {
 
-       if (new_key < pcurrent->key(i)) {
+       if (less(new_key, pcurrent->key(i))) {
 
            if (pcurrent->isLeaf())
                return {false, pcurrent, i};
@@ -2061,7 +4295,7 @@ template<class Key, class Value> std::tuple<bool, typename tree234<Key, Value>::
            return find_insert_node(pcurrent->children[i].get(), new_key); // Recurse left subtree of pcurrent->key(i)
        } 
 
-       if (new_key == pcurrent->key(i)) {
+       if (equal(new_key, pcurrent->key(i))) {
 
            return {true, pcurrent, i};  // key located at std::pair{pcurrent, i};  
        }
@@ -2087,9 +4321,12 @@ template<class Key, class Value> std::tuple<bool, typename tree234<Key, Value>::
  *  Special case: if pnode is the root, we special case this and create a new root above the current root.
  *
  */ 
-template<typename Key, typename Value> typename tree234<Key, Value>::Node *tree234<Key, Value>::split(Node *pnode, Key new_key) noexcept
+template<typename Key, typename Value, typename Stats, typename Prefetch> typename tree234<Key, Value, Stats, Prefetch>::Node *tree234<Key, Value, Stats, Prefetch>::split(Node *pnode, const Key& new_key) noexcept
 {
-   Key middle_key = pnode->key(1);
+   counters.count(&tree234_stats::split);
+
+   // Decide now which half new_key belongs in, as the middle key is moved below. This saves copying it.
+   bool less_than_middle = less(new_key, pnode->key(1));
    
    // 1. create a new node from largest key of pnode and adopt pnode's two right-most children
    auto largestNode = std::make_unique<Node>(std::move(pnode->keys_values[2])); 
@@ -2122,7 +4359,7 @@ template<typename Key, typename Value> typename tree234<Key, Value>::Node *tree2
 
   // Set pnext. Since we already checked 'if (new_key == middle_key)' in the caller--in find_insert_node()--we need only check if 'new_key < middle_key', in order to set pnext to the node
   // for find_insert_node() to examine next.
-  Node *pnext = (new_key < middle_key) ? pnode : pLargest;
+  Node *pnext = less_than_middle ? pnode : pLargest;
 
   return pnext;
 }
@@ -2131,8 +4368,10 @@ template<typename Key, typename Value> typename tree234<Key, Value>::Node *tree2
  *  Converts 2-nodes to 3- or 4-nodes as it descends to the left-most leaf node of the substree rooted at pnode.
  *  Returns: min leaf node in subtree rooted at pnode.
  */
-template<class Key, class Value> inline typename tree234<Key, Value>::Node *tree234<Key, Value>::get_successor_node(Node *pnode, int child_index) noexcept
+template<class Key, class Value, class Stats, class Prefetch> inline typename tree234<Key, Value, Stats, Prefetch>::Node *tree234<Key, Value, Stats, Prefetch>::get_successor_node(Node *pnode, int child_index) noexcept
 {
+  counters.visit();
+
   if (pnode->isTwoNode()) 
       convert2Node(pnode, child_index);
 
@@ -2142,7 +4381,7 @@ template<class Key, class Value> inline typename tree234<Key, Value>::Node *tree
   return get_successor_node(pnode->children[0].get(), 0);
 }
 
-template<typename Key, typename Value> inline void tree234<Key, Value>::printlevelOrder(std::ostream& ostr) const noexcept
+template<typename Key, typename Value, typename Stats, typename Prefetch> inline void tree234<Key, Value, Stats, Prefetch>::printlevelOrder(std::ostream& ostr) const noexcept
 {
   NodeLevelOrderPrinter tree_printer(height(), (&Node::print), ostr);  
   
@@ -2151,7 +4390,7 @@ template<typename Key, typename Value> inline void tree234<Key, Value>::printlev
   ostr << std::flush;
 }
 
-template<typename Key, typename Value> void tree234<Key, Value>::debug_printlevelOrder(std::ostream& ostr) const noexcept
+template<typename Key, typename Value, typename Stats, typename Prefetch> void tree234<Key, Value, Stats, Prefetch>::debug_printlevelOrder(std::ostream& ostr) const noexcept
 {
   ostr << "\n--- First: tree printed ---\n";
   
@@ -2167,13 +4406,13 @@ template<typename Key, typename Value> void tree234<Key, Value>::debug_printleve
 }
 
 
-template<typename Key, typename Value> inline void tree234<Key, Value>::printInOrder(std::ostream& ostr) const noexcept
+template<typename Key, typename Value, typename Stats, typename Prefetch> inline void tree234<Key, Value, Stats, Prefetch>::printInOrder(std::ostream& ostr) const noexcept
 {
   auto lambda = [&](const std::pair<Key, Value>& pr) { ostr << pr.first << ' '; };
   inOrderTraverse(lambda); 
 }
 	
-template<class Key, class Value> tree234<Key, Value>::iterator::iterator(tree234<Key, Value>& lhs_tree) : tree{lhs_tree} 
+template<class Key, class Value, class Stats, class Prefetch> tree234<Key, Value, Stats, Prefetch>::iterator::iterator(tree234<Key, Value, Stats, Prefetch>& lhs_tree) : tree{lhs_tree} 
 {
   current = (!tree.isEmpty()) ? get_min() : nullptr;
 
@@ -2181,7 +4420,7 @@ template<class Key, class Value> tree234<Key, Value>::iterator::iterator(tree234
   key_index = 0;  
 }
 
-template<class Key, class Value> std::ostream& tree234<Key, Value>::iterator::print(std::ostream& ostr) const noexcept
+template<class Key, class Value, class Stats, class Prefetch> std::ostream& tree234<Key, Value, Stats, Prefetch>::iterator::print(std::ostream& ostr) const noexcept
 {
    ostr << "\n-------------------------------------\niterator settings:\ncurrent = " <<\
            current << "\n" << "cursor =  " << cursor <<  '\n';
@@ -2190,39 +4429,19 @@ template<class Key, class Value> std::ostream& tree234<Key, Value>::iterator::pr
    ostr << "\nkey_index = " << key_index << '\n';
 
    ostr << "stack = { "; 
-   std::deque<int> deque;
 
-   //tree234<Key, Value>::iterator& nonconst = const_cast<iterator&>(*this);
-   tree234<int, int>::iterator& non_const = const_cast<tree234<Key, Value>::iterator&>(*this);
-   
-   while(!non_const.child_indexes.empty()) {
-
-       auto top = non_const.child_indexes.top();
-
-       ostr << top << ", ";
-
-       deque.push_back(top);
+   // From the top of the stack down
+   for (auto i = stack_size - 1; i >= 0; --i) 
 
-       non_const.child_indexes.pop(); 
-   }
+       ostr << child_indexes[i] << ", ";
 
    ostr << " } " << '\n' << std::flush;
-
-   // Push elements back onto stack in opposite order they were pop()'ed
-   while(!deque.empty()) {
-
-       int i = deque.back();
-       
-        non_const.child_indexes.push(i);
-
-        deque.pop_back();
-   }
    
    return ostr;
 }
 
 
-template<typename Key, typename Value> inline const typename tree234<Key, Value>::Node *tree234<Key, Value>::iterator::get_max() noexcept
+template<typename Key, typename Value, typename Stats, typename Prefetch> inline const typename tree234<Key, Value, Stats, Prefetch>::Node *tree234<Key, Value, Stats, Prefetch>::iterator::get_max() noexcept
 {
    const Node *pnode = tree.root.get();
 
@@ -2235,7 +4454,7 @@ template<typename Key, typename Value> inline const typename tree234<Key, Value>
    return pnode;
 }
 
-template<typename Key, typename Value> inline const typename tree234<Key, Value>::Node *tree234<Key, Value>::iterator::get_min() noexcept
+template<typename Key, typename Value, typename Stats, typename Prefetch> inline const typename tree234<Key, Value, Stats, Prefetch>::Node *tree234<Key, Value, Stats, Prefetch>::iterator::get_min() noexcept
 {
    const Node *pnode = tree.root.get();
 
@@ -2247,8 +4466,8 @@ template<typename Key, typename Value> inline const typename tree234<Key, Value>
    return pnode;
 }
 
-// non const tree234<Key, Value>& passed to ctor. Called only by end()
-template<class Key, class Value> inline tree234<Key, Value>::iterator::iterator(tree234<Key, Value>& lhs_tree, int i) :  tree{lhs_tree} 
+// non const tree234<Key, Value, Stats, Prefetch>& passed to ctor. Called only by end()
+template<class Key, class Value, class Stats, class Prefetch> inline tree234<Key, Value, Stats, Prefetch>::iterator::iterator(tree234<Key, Value, Stats, Prefetch>& lhs_tree, int i) :  tree{lhs_tree} 
 {
   // If the tree is empty, there is nothing over which to iterate...
    if (!tree.isEmpty()) {
@@ -2265,48 +4484,50 @@ template<class Key, class Value> inline tree234<Key, Value>::iterator::iterator(
   }
 }
 
-template<class Key, class Value> inline typename tree234<Key, Value>::iterator tree234<Key, Value>::begin() noexcept
+template<class Key, class Value, class Stats, class Prefetch> inline typename tree234<Key, Value, Stats, Prefetch>::iterator tree234<Key, Value, Stats, Prefetch>::begin() noexcept
 {
   return iterator{*this};
 }
 
-template<class Key, class Value> inline typename tree234<Key, Value>::const_iterator tree234<Key, Value>::begin() const noexcept
+template<class Key, class Value, class Stats, class Prefetch> inline typename tree234<Key, Value, Stats, Prefetch>::const_iterator tree234<Key, Value, Stats, Prefetch>::begin() const noexcept
 {
   return const_iterator{*this};
 }
 
-template<class Key, class Value> inline typename tree234<Key, Value>::iterator tree234<Key, Value>::end() noexcept
+template<class Key, class Value, class Stats, class Prefetch> inline typename tree234<Key, Value, Stats, Prefetch>::iterator tree234<Key, Value, Stats, Prefetch>::end() noexcept
 {
-   return iterator(const_cast<tree234<Key, Value>&>(*this), 0);
+   return iterator(const_cast<tree234<Key, Value, Stats, Prefetch>&>(*this), 0);
 }
 
-template<class Key, class Value> inline typename tree234<Key, Value>::const_iterator tree234<Key, Value>::end() const noexcept
+template<class Key, class Value, class Stats, class Prefetch> inline typename tree234<Key, Value, Stats, Prefetch>::const_iterator tree234<Key, Value, Stats, Prefetch>::end() const noexcept
 {
-   return const_iterator(const_cast<tree234<Key, Value>&>(*this), 0);
+   return const_iterator(const_cast<tree234<Key, Value, Stats, Prefetch>&>(*this), 0);
 }
 
-template<class Key, class Value> inline typename tree234<Key, Value>::reverse_iterator tree234<Key, Value>::rbegin() noexcept
+template<class Key, class Value, class Stats, class Prefetch> inline typename tree234<Key, Value, Stats, Prefetch>::reverse_iterator tree234<Key, Value, Stats, Prefetch>::rbegin() noexcept
 {
    return reverse_iterator{ end() }; 
 }
 
-template<class Key, class Value> inline typename tree234<Key, Value>::const_reverse_iterator tree234<Key, Value>::rbegin() const noexcept
+template<class Key, class Value, class Stats, class Prefetch> inline typename tree234<Key, Value, Stats, Prefetch>::const_reverse_iterator tree234<Key, Value, Stats, Prefetch>::rbegin() const noexcept
 {
     return const_reverse_iterator{ end() }; 
 }
 
-template<class Key, class Value> inline typename tree234<Key, Value>::reverse_iterator tree234<Key, Value>::rend() noexcept
+template<class Key, class Value, class Stats, class Prefetch> inline typename tree234<Key, Value, Stats, Prefetch>::reverse_iterator tree234<Key, Value, Stats, Prefetch>::rend() noexcept
 {
     return reverse_iterator{ begin() }; 
 }
 
-template<class Key, class Value> inline typename tree234<Key, Value>::const_reverse_iterator tree234<Key, Value>::rend() const noexcept
+template<class Key, class Value, class Stats, class Prefetch> inline typename tree234<Key, Value, Stats, Prefetch>::const_reverse_iterator tree234<Key, Value, Stats, Prefetch>::rend() const noexcept
 {
     return const_reverse_iterator{ begin() }; 
 }
 
-template<class Key, class Value> typename tree234<Key, Value>::iterator& tree234<Key, Value>::iterator::increment() noexcept	    
+template<class Key, class Value, class Stats, class Prefetch> typename tree234<Key, Value, Stats, Prefetch>::iterator& tree234<Key, Value, Stats, Prefetch>::iterator::increment() noexcept	    
 {
+  operation_scope scope{tree.counters, &tree234_stats::increment};
+
   if (tree.isEmpty()) {
 
      return *this;  // If tree is empty or we are at the end, do nothing.
@@ -2323,11 +4544,35 @@ template<class Key, class Value> typename tree234<Key, Value>::iterator& tree234
 
       cursor = current = successor; 
       key_index = index;
+
+      prefetch_next_subtree();
   }
   return *this;
 }
 
-template<class Key, class Value> typename tree234<Key, Value>::iterator& tree234<Key, Value>::iterator::decrement() noexcept	    
+/*
+ * Passes the Prefetch policy the root of the subtree increment() enters after the cursor leaves its node: the child right of the cursor's key
+ * in an internal node, or, when the cursor has just entered a leaf, the leaf's next sibling.
+ */
+template<class Key, class Value, class Stats, class Prefetch> inline void tree234<Key, Value, Stats, Prefetch>::iterator::prefetch_next_subtree() const noexcept
+{
+  if constexpr (Prefetch::enabled) {
+
+     if (!cursor->isLeaf()) {
+
+         Prefetch::node(cursor->children[key_index + 1].get(), sizeof(Node));
+
+     } else if (key_index == 0 && stack_size > 0) {
+
+         auto child_index = child_indexes[stack_size - 1]; // cursor == cursor->parent->children[child_index]
+
+         if (child_index < cursor->parent->getTotalItems())
+             Prefetch::node(cursor->parent->children[child_index + 1].get(), sizeof(Node));
+     }
+  }
+}
+
+template<class Key, class Value, class Stats, class Prefetch> typename tree234<Key, Value, Stats, Prefetch>::iterator& tree234<Key, Value, Stats, Prefetch>::iterator::decrement() noexcept	    
 {
   if (tree.isEmpty()) {
 
@@ -2353,16 +4598,18 @@ template<class Key, class Value> typename tree234<Key, Value>::iterator& tree234
   return *this;
 }
 
-template<class Key, class Value> inline tree234<Key, Value>::iterator::iterator(iterator&& lhs) : \
+template<class Key, class Value, class Stats, class Prefetch> inline tree234<Key, Value, Stats, Prefetch>::iterator::iterator(iterator&& lhs) : \
              tree{lhs.tree}, current{lhs.current}, cursor{lhs.cursor}, key_index{lhs.key_index}  
 {
    lhs.cursor = lhs.current = nullptr; 
-   child_indexes = std::move(lhs.child_indexes);
+   child_indexes = lhs.child_indexes;
+   stack_size = lhs.stack_size;
+   lhs.stack_size = 0;
 }
 /*
  */
 
-template<class Key, class Value> bool tree234<Key, Value>::iterator::operator==(const iterator& lhs) const
+template<class Key, class Value, class Stats, class Prefetch> bool tree234<Key, Value, Stats, Prefetch>::iterator::operator==(const iterator& lhs) const
 {
    //
    // The first if-test, checks for "at end".
@@ -2380,36 +4627,36 @@ template<class Key, class Value> bool tree234<Key, Value>::iterator::operator==(
 }
 
 /*
- tree234<Key, Value>::const_iterator constructors
+ tree234<Key, Value, Stats, Prefetch>::const_iterator constructors
  */
-template<class Key, class Value> inline tree234<Key, Value>::const_iterator::const_iterator(const tree234<Key, Value>& lhs) : iter{const_cast<tree234<Key, Value>&>(lhs)} 
+template<class Key, class Value, class Stats, class Prefetch> inline tree234<Key, Value, Stats, Prefetch>::const_iterator::const_iterator(const tree234<Key, Value, Stats, Prefetch>& lhs) : iter{const_cast<tree234<Key, Value, Stats, Prefetch>&>(lhs)} 
 {
 }
 
-template<class Key, class Value> inline tree234<Key, Value>::const_iterator::const_iterator(const tree234<Key, Value>& lhs, int i) : iter{const_cast<tree234<Key, Value>&>(lhs), i} 
+template<class Key, class Value, class Stats, class Prefetch> inline tree234<Key, Value, Stats, Prefetch>::const_iterator::const_iterator(const tree234<Key, Value, Stats, Prefetch>& lhs, int i) : iter{const_cast<tree234<Key, Value, Stats, Prefetch>&>(lhs), i} 
 {
 }
 
-template<class Key, class Value> inline tree234<Key, Value>::const_iterator::const_iterator::const_iterator(const typename tree234<Key, Value>::const_iterator& lhs) : iter{lhs.iter}
+template<class Key, class Value, class Stats, class Prefetch> inline tree234<Key, Value, Stats, Prefetch>::const_iterator::const_iterator::const_iterator(const typename tree234<Key, Value, Stats, Prefetch>::const_iterator& lhs) : iter{lhs.iter}
 {
 }
 
-template<class Key, class Value> inline tree234<Key, Value>::const_iterator::const_iterator::const_iterator(typename tree234<Key, Value>::const_iterator&& lhs) : iter{std::move(lhs.iter)}
+template<class Key, class Value, class Stats, class Prefetch> inline tree234<Key, Value, Stats, Prefetch>::const_iterator::const_iterator::const_iterator(typename tree234<Key, Value, Stats, Prefetch>::const_iterator&& lhs) : iter{std::move(lhs.iter)}
 {
 }
 /*
  * This constructor also provides implicit type conversion from a iterator to a const_iterator
  */
-template<class Key, class Value> inline tree234<Key, Value>::const_iterator::const_iterator::const_iterator(const typename tree234<Key, Value>::iterator& lhs) : iter{lhs}
+template<class Key, class Value, class Stats, class Prefetch> inline tree234<Key, Value, Stats, Prefetch>::const_iterator::const_iterator::const_iterator(const typename tree234<Key, Value, Stats, Prefetch>::iterator& lhs) : iter{lhs}
 {
 }
 
-template<class Key, class Value> inline bool tree234<Key, Value>::const_iterator::operator==(const const_iterator& lhs) const 
+template<class Key, class Value, class Stats, class Prefetch> inline bool tree234<Key, Value, Stats, Prefetch>::const_iterator::operator==(const const_iterator& lhs) const 
 { 
   return iter.operator==(lhs.iter); 
 }
 
-template<class Key, class Value> inline  bool tree234<Key, Value>::const_iterator::operator!=(const const_iterator& lhs) const
+template<class Key, class Value, class Stats, class Prefetch> inline  bool tree234<Key, Value, Stats, Prefetch>::const_iterator::operator!=(const const_iterator& lhs) const
 { 
   return iter.operator!=(lhs.iter); 
 }
@@ -2422,7 +4669,7 @@ template<class Key, class Value> inline  bool tree234<Key, Value>::const_iterato
  *          3 for level immediately below level 2
  *          etc. 
  */
-template<class Key, class Value> int tree234<Key, Value>::depth(const Node *pnode) const noexcept
+template<class Key, class Value, class Stats, class Prefetch> int tree234<Key, Value, Stats, Prefetch>::depth(const Node *pnode) const noexcept
 {
     if (!pnode) return -1;
 
@@ -2447,7 +4694,7 @@ template<class Key, class Value> int tree234<Key, Value>::depth(const Node *pnod
     return -1; // not found
 }
 
-template<class Key, class Value> int tree234<Key, Value>::height(const Node* pnode) const noexcept
+template<class Key, class Value, class Stats, class Prefetch> int tree234<Key, Value, Stats, Prefetch>::height(const Node* pnode) const noexcept
 {
    if (!pnode) {
 
@@ -2474,7 +4721,7 @@ template<class Key, class Value> int tree234<Key, Value>::height(const Node* pno
 /*
   Input: pnode must be in tree
  */
-template<class Key, class Value> bool tree234<Key, Value>::isBalanced(const Node* pnode) const noexcept
+template<class Key, class Value, class Stats, class Prefetch> bool tree234<Key, Value, Stats, Prefetch>::isBalanced(const Node* pnode) const noexcept
 {
     if (!pnode) return false; 
 
@@ -2498,7 +4745,7 @@ template<class Key, class Value> bool tree234<Key, Value>::isBalanced(const Node
 }
 
 // Visits each Node in level order, testing whether it is balanced. Returns false if any node is not balanced.
-template<class Key, class Value> bool tree234<Key, Value>::isBalanced() const noexcept
+template<class Key, class Value, class Stats, class Prefetch> bool tree234<Key, Value, Stats, Prefetch>::isBalanced() const noexcept
 {
     if (root ==nullptr) return true;
     
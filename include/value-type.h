@@ -1,5 +1,6 @@
 #ifndef __value_type_
 #define __value_type_
+#include <type_traits>
 #include <utility>
 #include <memory>
 
@@ -130,7 +131,7 @@ template <class _Key, class _Value> struct __value_type {
     {
     } 
 
-    explicit __value_type(std::pair<_Key, _Value>&& pr) : __cc(pr)
+    explicit __value_type(std::pair<_Key, _Value>&& pr) : __cc(std::move(pr.first), std::move(pr.second))
     {
     }
 
@@ -138,7 +139,12 @@ template <class _Key, class _Value> struct __value_type {
    ~__value_type()                     = default;
 
     __value_type(const __value_type&)  = default;
-    __value_type(__value_type&&)       = default;
+
+    // The defaulted move constructor would copy the const key of __cc; this one moves it, as the move assignment operator does.
+    __value_type(__value_type&& __v) noexcept(std::is_nothrow_move_constructible_v<_Key> && std::is_nothrow_move_constructible_v<_Value>)
+       : __cc(__v.__move())
+    {
+    }
 
 };
 #endif
@@ -0,0 +1,101 @@
+/*
+ * A shared_tree234 whose segment runs out of pages must stay a valid tree.
+ *
+ * Build and run: make check, or ctest after a CMake build.
+ *
+ * Fills segments of 1 to 40 pages of 128 bytes, 2-3-4 trees, with ascending and with random keys until insert() has thrown std::bad_alloc
+ * a number of times; with so many segment sizes, some run out in the middle of a root split and others further down. After every failure
+ * the tree must be balanced and hold exactly the keys whose insert() returned, and once emptied it must accept new keys. Exits with status
+ * 1 on the first check that fails.
+ */
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <set>
+#include <string>
+#include <unistd.h>
+#include "shared-tree234.h"
+
+using namespace std;
+
+using tree_type = shared_tree234<uint64_t, uint64_t, 128>;
+
+static void check(bool ok, const string& what)
+{
+   if (!ok) {
+
+       cerr << "shared-tree-full: " << what << '\n';
+       exit(1);
+   }
+}
+
+static void check_tree(const tree_type& tree, const set<uint64_t>& keys)
+{
+   check(tree.read([](const auto& t) { return t.isBalanced(); }), "tree is not balanced");
+   check(tree.size() == keys.size(), "size() is not the number of keys inserted");
+
+   for (auto key : keys) check(tree.get(key) == key, "an inserted key is missing");
+}
+
+// Inserts keys until the segment of pages pages has failed 20 inserts, then empties the tree and refills part of it.
+static int fill(const string& name, size_t pages, bool ascending)
+{
+   tree_type tree{name, shm_mode::create, pages};
+
+   set<uint64_t> keys;
+
+   mt19937_64 rng{pages};
+
+   int failures = 0;
+
+   for (uint64_t next = 0; failures < 20; ++next) {
+
+       auto key = ascending ? next : rng() % 1'000;
+
+       try {
+
+           if (tree.insert(key, key)) keys.insert(key);
+
+       } catch (const bad_alloc&) {
+
+           ++failures;
+           check_tree(tree, keys);
+       }
+   }
+
+   // The tree must still shrink, and the pages it frees must be reusable.
+   while (!keys.empty()) {
+
+       check(tree.remove(*keys.begin()), "remove() of a present key failed");
+       keys.erase(keys.begin());
+   }
+
+   check_tree(tree, keys);
+
+   for (uint64_t key = 0; key < 3; ++key) check(tree.insert(key, key), "insert() after removals failed");
+
+   return failures;
+}
+
+int main()
+{
+   string name = "/shared-tree-full-" + to_string(::getpid());
+
+   int failures = 0;
+
+   // Segments of different sizes run out at different points of the tree's growth, some of them in the middle of a root split.
+   for (size_t pages = 1; pages <= 40; ++pages) {
+
+       for (bool ascending : {true, false}) {
+
+           tree_type::unlink(name);
+           failures += fill(name, pages, ascending);
+       }
+   }
+
+   tree_type::unlink(name);
+
+   cout << "shared-tree-full: " << failures << " inserts failed, trees intact\n";
+}